@@ -147,7 +147,7 @@ void AggroBAIState::think(BattleAction *action)
 	{
 		// if we see the target, we either can shoot him, or take cover.
 		bool takeCover = true;
-		int number = RNG::generate(0,100);
+		int number = RNG::generate(0,100,RNG::AI);
 
 		// lost health, chances to take cover get bigger
 		if (_unit->getHealth() < _unit->getStats()->health)
@@ -208,7 +208,7 @@ void AggroBAIState::think(BattleAction *action)
 				}
 				else
 				{
-					if (RNG::generate(1,10) < 5)
+					if (RNG::generate(1,10,RNG::AI) < 5)
 						action->type = BA_SNAPSHOT;
 					else
 						action->type = BA_AUTOSHOT;
@@ -233,8 +233,8 @@ void AggroBAIState::think(BattleAction *action)
 			{
 				tries++;
 				action->target = _unit->getPosition();
-				action->target.x += RNG::generate(-5,5);
-				action->target.y += RNG::generate(-5,5);
+				action->target.x += RNG::generate(-5,5,RNG::AI);
+				action->target.y += RNG::generate(-5,5,RNG::AI);
 				if (tries < 20)
 
 					coverFound = !_game->getTileEngine()->visible(_aggroTarget, _game->getTile(action->target));
@@ -243,13 +243,11 @@ void AggroBAIState::think(BattleAction *action)
 
 				if (coverFound)
 				{
-					// check if we can reach this tile
-					_game->getPathfinding()->calculate(_unit, action->target);
-					if (_game->getPathfinding()->getStartDirection() == -1)
+					// check if we can reach this tile, the unit's reachability is calculated once and reused for every try
+					if (_game->getPathfinding()->getReachCost(_unit, action->target) <= 0)
 					{
 						coverFound = false;
 					}
-					_game->getPathfinding()->abortPath();
 				}
 			}
 		}
@@ -0,0 +1,374 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "BattleLog.h"
+#include "../Engine/Exception.h"
+#include "../Savegame/SavedBattleGame.h"
+#include "../Savegame/BattleUnit.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Writes a number to a file, least significant byte first,
+ * so logs can be replayed on any platform.
+ * @param out File stream.
+ * @param value Number.
+ * @param bytes Number of bytes to write.
+ */
+static void writeInt(std::ostream &out, Sint32 value, int bytes)
+{
+	for (int i = 0; i < bytes; ++i)
+	{
+		out.put((char)((Uint32)value >> (i * 8)));
+	}
+}
+
+/**
+ * Reads a number written by writeInt.
+ * @param in File stream.
+ * @param bytes Number of bytes to read.
+ * @return Number, sign-extended from its size.
+ */
+static Sint32 readInt(std::istream &in, int bytes)
+{
+	Uint32 value = 0;
+	for (int i = 0; i < bytes; ++i)
+	{
+		int c = in.get();
+		if (c == EOF)
+		{
+			throw Exception("Battle log is truncated");
+		}
+		value |= (Uint32)(c & 0xFF) << (i * 8);
+	}
+	if (bytes < 4 && (value & (1 << (bytes * 8 - 1))))
+	{
+		value |= 0xFFFFFFFF << (bytes * 8);
+	}
+	return (Sint32)value;
+}
+
+/**
+ * Creates a battle log that neither records nor replays anything yet.
+ */
+BattleLog::BattleLog() : _save(""), _next(0), _checks(0), _divergedTurn(-1)
+{
+
+}
+
+/**
+ * Closes the log file.
+ */
+BattleLog::~BattleLog()
+{
+	if (_out.is_open())
+	{
+		_out.close();
+	}
+}
+
+/**
+ * Starts recording a battle.
+ * @param filename Full path of the log file.
+ * @param save Name of the save the battle starts from.
+ */
+void BattleLog::record(const std::string &filename, const std::string &save)
+{
+	_save = save;
+	_out.open(filename.c_str(), std::ios::out | std::ios::binary);
+	if (!_out)
+	{
+		throw Exception("Failed to create " + filename);
+	}
+	_out.write("OXBL", 4);
+	writeInt(_out, VERSION, 1);
+	writeInt(_out, _save.size(), 2);
+	_out.write(_save.c_str(), _save.size());
+	_out.flush();
+}
+
+/**
+ * Loads a recorded battle log to replay.
+ * @param filename Full path of the log file.
+ */
+void BattleLog::load(const std::string &filename)
+{
+	std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!in)
+	{
+		throw Exception("Failed to load " + filename);
+	}
+	char magic[4];
+	in.read(magic, 4);
+	if (!in || std::string(magic, 4) != "OXBL")
+	{
+		throw Exception(filename + " is not a battle log");
+	}
+	if (readInt(in, 1) != VERSION)
+	{
+		throw Exception(filename + " was recorded by another version");
+	}
+	int length = readInt(in, 2);
+	std::vector<char> save(length);
+	if (length > 0)
+	{
+		in.read(&save[0], length);
+	}
+	_save = std::string(save.begin(), save.end());
+
+	_entries.clear();
+	_final = Entry();
+	_next = 0;
+	while (in.peek() != EOF)
+	{
+		Entry entry;
+		entry.type = (EntryType)readInt(in, 1);
+		entry.action = (BattleActionType)readInt(in, 1);
+		entry.turn = readInt(in, 2);
+		entry.actor = readInt(in, 4);
+		entry.weapon = readInt(in, 4);
+		entry.TU = readInt(in, 2);
+		entry.value = readInt(in, 4);
+		entry.target.x = readInt(in, 2);
+		entry.target.y = readInt(in, 2);
+		entry.target.z = readInt(in, 2);
+		int waypoints = readInt(in, 1);
+		for (int i = 0; i < waypoints; ++i)
+		{
+			Position p;
+			p.x = readInt(in, 2);
+			p.y = readInt(in, 2);
+			p.z = readInt(in, 2);
+			entry.waypoints.push_back(p);
+		}
+		if (entry.type == ENTRY_FINAL)
+		{
+			_final = entry;
+		}
+		else
+		{
+			_entries.push_back(entry);
+		}
+	}
+}
+
+/**
+ * Writes an entry to the log file. Every entry is flushed right
+ * away, so the log is still good if the game crashes.
+ * @param entry Log entry.
+ */
+void BattleLog::write(const Entry &entry)
+{
+	writeInt(_out, entry.type, 1);
+	writeInt(_out, entry.action, 1);
+	writeInt(_out, entry.turn, 2);
+	writeInt(_out, entry.actor, 4);
+	writeInt(_out, entry.weapon, 4);
+	writeInt(_out, entry.TU, 2);
+	writeInt(_out, entry.value, 4);
+	writeInt(_out, entry.target.x, 2);
+	writeInt(_out, entry.target.y, 2);
+	writeInt(_out, entry.target.z, 2);
+	writeInt(_out, entry.waypoints.size(), 1);
+	for (std::vector<Position>::const_iterator i = entry.waypoints.begin(); i != entry.waypoints.end(); ++i)
+	{
+		writeInt(_out, i->x, 2);
+		writeInt(_out, i->y, 2);
+		writeInt(_out, i->z, 2);
+	}
+	_out.flush();
+}
+
+/**
+ * Gets the name of the save the battle was recorded from.
+ * @return Save name.
+ */
+const std::string &BattleLog::getSave() const
+{
+	return _save;
+}
+
+/**
+ * Checks if the log is being recorded.
+ * @return True if recording.
+ */
+bool BattleLog::isRecording() const
+{
+	return _out.is_open();
+}
+
+/**
+ * Checks if there are still entries to be replayed.
+ * @return True if replaying.
+ */
+bool BattleLog::isReplaying() const
+{
+	return _next < _entries.size();
+}
+
+/**
+ * Records an entry, if the log is being recorded.
+ * @param entry Log entry.
+ */
+void BattleLog::add(const Entry &entry)
+{
+	if (isRecording())
+	{
+		write(entry);
+	}
+}
+
+/**
+ * Gets the next command to replay. If a turn check is up next
+ * instead, the battle ended its turn at a different point than the
+ * recording did, so the check is counted as a mismatch and skipped.
+ * @return Pointer to the entry, or 0 if there are none left.
+ */
+const BattleLog::Entry *BattleLog::next()
+{
+	while (isReplaying() && _entries[_next].type == ENTRY_CHECK)
+	{
+		if (_divergedTurn == -1)
+		{
+			_divergedTurn = _entries[_next].turn;
+		}
+		_next++;
+	}
+	if (!isReplaying())
+	{
+		return 0;
+	}
+	return &_entries[_next++];
+}
+
+/**
+ * Called at the end of every turn: records a checksum of the units,
+ * or compares it with the recorded one when replaying.
+ * @param save Pointer to the battle.
+ */
+void BattleLog::check(SavedBattleGame *save)
+{
+	Entry entry;
+	entry.type = ENTRY_CHECK;
+	entry.turn = save->getTurn();
+	entry.value = (Sint32)checksum(save);
+	if (isRecording())
+	{
+		write(entry);
+	}
+	else if (isReplaying())
+	{
+		const Entry &recorded = _entries[_next];
+		if (recorded.type == ENTRY_CHECK)
+		{
+			_next++;
+		}
+		if (recorded.type == ENTRY_CHECK && recorded.turn == entry.turn && recorded.value == entry.value)
+		{
+			_checks++;
+		}
+		else if (_divergedTurn == -1)
+		{
+			_divergedTurn = entry.turn;
+		}
+	}
+}
+
+/**
+ * Called when the battle is over: records the turn and a checksum of
+ * the units, then stops recording.
+ * @param save Pointer to the battle.
+ */
+void BattleLog::finish(SavedBattleGame *save)
+{
+	if (!isRecording())
+		return;
+
+	Entry entry;
+	entry.type = ENTRY_FINAL;
+	entry.turn = save->getTurn();
+	entry.value = (Sint32)checksum(save);
+	write(entry);
+	_out.close();
+}
+
+/**
+ * Checks if the log holds the state the recorded battle ended in;
+ * it doesn't when the game was quit in the middle of the battle.
+ * @return True if the end was recorded.
+ */
+bool BattleLog::hasFinal() const
+{
+	return _final.type == ENTRY_FINAL;
+}
+
+/**
+ * Compares a battle with the state the recorded battle ended in.
+ * @param save Pointer to the battle.
+ * @return True if the turn and the units match.
+ */
+bool BattleLog::checkFinal(SavedBattleGame *save) const
+{
+	return hasFinal() && _final.turn == save->getTurn() && _final.value == (Sint32)checksum(save);
+}
+
+/**
+ * Gets the number of turn checks that matched the recording.
+ * @return Number of checks.
+ */
+int BattleLog::getChecks() const
+{
+	return _checks;
+}
+
+/**
+ * Gets the first turn at which the replay didn't match the recording.
+ * @return Turn, or -1 if everything matched so far.
+ */
+int BattleLog::getDivergedTurn() const
+{
+	return _divergedTurn;
+}
+
+/**
+ * Gets a checksum (FNV-1a) of the state of every unit in the battle.
+ * @param save Pointer to the battle.
+ * @return Checksum.
+ */
+Uint32 BattleLog::checksum(SavedBattleGame *save)
+{
+	Uint32 hash = 2166136261u;
+	for (std::vector<BattleUnit*>::iterator i = save->getUnits()->begin(); i != save->getUnits()->end(); ++i)
+	{
+		int values[] = { (*i)->getId(), (*i)->getPosition().x, (*i)->getPosition().y, (*i)->getPosition().z,
+			(*i)->getDirection(), (*i)->getStatus(), (*i)->getTimeUnits(), (*i)->getEnergy(),
+			(*i)->getHealth(), (*i)->getStunlevel(), (*i)->getMorale() };
+		for (size_t j = 0; j < sizeof(values) / sizeof(values[0]); ++j)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				hash ^= ((Uint32)values[j] >> (k * 8)) & 0xFF;
+				hash *= 16777619u;
+			}
+		}
+	}
+	return hash;
+}
+
+}
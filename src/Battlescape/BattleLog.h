@@ -0,0 +1,105 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_BATTLELOG_H
+#define OPENXCOM_BATTLELOG_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <SDL.h>
+#include "Position.h"
+#include "BattlescapeGame.h"
+
+namespace OpenXcom
+{
+
+class SavedBattleGame;
+
+/**
+ * A record of the commands the player gave during a battle, kept
+ * in a compact binary file next to a save of the battle's start.
+ * Playing the commands back against that save reproduces the
+ * battle, since everything else comes from the saved random
+ * number streams. At the end of every turn a checksum of the
+ * units is logged, so a replay can tell where it stopped
+ * matching the original, and another one when the battle
+ * is over, to compare the state the replay ends in.
+ */
+class BattleLog
+{
+public:
+	/// Kinds of log entries.
+	enum EntryType { ENTRY_ACTION, ENTRY_KNEEL, ENTRY_RESERVE, ENTRY_END_TURN, ENTRY_CHECK, ENTRY_FINAL };
+	/// A single command, or the checksum at the end of a turn.
+	struct Entry
+	{
+		EntryType type;
+		BattleActionType action;
+		int turn, actor, weapon, TU, value;
+		Position target;
+		std::vector<Position> waypoints;
+		Entry() : type(ENTRY_ACTION), action(BA_NONE), turn(0), actor(-1), weapon(-1), TU(0), value(0), target(-1, -1, -1) {};
+	};
+private:
+	static const int VERSION = 1;
+	std::string _save;
+	std::ofstream _out;
+	std::vector<Entry> _entries;
+	Entry _final;
+	size_t _next;
+	int _checks, _divergedTurn;
+	void write(const Entry &entry);
+public:
+	/// Creates an empty battle log.
+	BattleLog();
+	/// Cleans up the battle log.
+	~BattleLog();
+	/// Starts recording to a file.
+	void record(const std::string &filename, const std::string &save);
+	/// Loads a recorded log to replay.
+	void load(const std::string &filename);
+	/// Gets the save the battle started from.
+	const std::string &getSave() const;
+	/// Is the log being recorded?
+	bool isRecording() const;
+	/// Are there entries left to replay?
+	bool isReplaying() const;
+	/// Records an entry.
+	void add(const Entry &entry);
+	/// Gets the next command to replay.
+	const Entry *next();
+	/// Records or verifies the end of a turn.
+	void check(SavedBattleGame *save);
+	/// Records the state the battle ended in.
+	void finish(SavedBattleGame *save);
+	/// Was the end of the battle recorded?
+	bool hasFinal() const;
+	/// Checks if a battle ended in the recorded state.
+	bool checkFinal(SavedBattleGame *save) const;
+	/// Gets the number of checks that matched.
+	int getChecks() const;
+	/// Gets the turn the replay stopped matching.
+	int getDivergedTurn() const;
+	/// Gets a checksum of the units in a battle.
+	static Uint32 checksum(SavedBattleGame *save);
+};
+
+}
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "BattleSimulator.h"
+#include <iomanip>
+#include <sstream>
+#include "BattlescapeGenerator.h"
+#include "BattlescapeState.h"
+#include "BattlescapeGame.h"
+#include "PatrolBAIState.h"
+#include "BattleLog.h"
+#include "../Geoscape/GeoscapeState.h"
+#include "../Engine/Game.h"
+#include "../Engine/Exception.h"
+#include "../Engine/Profiler.h"
+#include "../Engine/CrossPlatform.h"
+#include "../Engine/RNG.h"
+#include "../Savegame/SavedGame.h"
+#include "../Savegame/SavedBattleGame.h"
+#include "../Savegame/BattleUnit.h"
+#include "../Savegame/Base.h"
+#include "../Savegame/Ufo.h"
+#include "../Ruleset/Ruleset.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Sets up a battle simulator.
+ * @param game Pointer to the core game, with the resources, ruleset and a saved game loaded.
+ * @param mission Type of mission to generate.
+ * @param texture World texture the mission takes place on.
+ * @param turns Number of turns after which the battle is called off.
+ */
+BattleSimulator::BattleSimulator(Game *game, const std::string &mission, int texture, int turns) : _game(game), _mission(mission), _texture(texture), _turns(turns), _ufoType(""), _ufoLatitude(0.0), _ufo(0)
+{
+
+}
+
+/**
+ * Deletes the battle simulator.
+ */
+BattleSimulator::~BattleSimulator()
+{
+	delete _ufo;
+}
+
+/**
+ * Sets the UFO the mission takes place around, like
+ * a UFO crash recovery. Without one there is no UFO.
+ * @param type Type of UFO.
+ * @param latitude Latitude the UFO came down at, which picks the forest or jungle terrain.
+ */
+void BattleSimulator::setUfo(const std::string &type, double latitude)
+{
+	_ufoType = type;
+	_ufoLatitude = latitude;
+}
+
+/**
+ * Counts the soldiers and aliens still in the battle.
+ * @param battle Pointer to the battle.
+ * @param soldiers Pointer to the number of soldiers.
+ * @param aliens Pointer to the number of aliens.
+ */
+void BattleSimulator::countUnits(SavedBattleGame *battle, int *soldiers, int *aliens) const
+{
+	*soldiers = 0;
+	*aliens = 0;
+	for (std::vector<BattleUnit*>::iterator i = battle->getUnits()->begin(); i != battle->getUnits()->end(); ++i)
+	{
+		if (!(*i)->isOut())
+		{
+			if ((*i)->getFaction() == FACTION_HOSTILE)
+				(*aliens)++;
+			if ((*i)->getFaction() == FACTION_PLAYER)
+				(*soldiers)++;
+		}
+	}
+}
+
+/**
+ * Counts a step of the battle. A battle where something keeps going without
+ * the turn ever ending would run forever, so a turn taking more steps than any
+ * real one does fails the run instead.
+ * @param battle Pointer to the battle.
+ * @param turn Pointer to the turn the steps are counted for.
+ * @param steps Pointer to the number of steps so far this turn.
+ */
+void BattleSimulator::countStep(SavedBattleGame *battle, int *turn, int *steps) const
+{
+	if (battle->getTurn() != *turn)
+	{
+		*turn = battle->getTurn();
+		*steps = 0;
+	}
+	if (++(*steps) > MAX_TURN_STEPS)
+	{
+		std::ostringstream ss;
+		ss << "Turn " << *turn << " of " << battle->getMissionType() << " didn't end after " << MAX_TURN_STEPS << " steps, the battle is stuck";
+		throw Exception(ss.str());
+	}
+}
+
+/**
+ * Generates the mission with the first craft of the first base, or in the
+ * base itself for base defences, and attaches it to the saved game.
+ * The UFO, if there is one, is kept by the simulator.
+ * @return Pointer to the battle.
+ */
+SavedBattleGame *BattleSimulator::generate()
+{
+	SavedBattleGame *battle = new SavedBattleGame();
+	_game->getSavedGame()->setBattleGame(battle);
+	battle->setMissionType(_mission);
+	Base *base = _game->getSavedGame()->getBases()->at(0);
+	BattlescapeGenerator *bgen = new BattlescapeGenerator(_game);
+	bgen->setWorldTexture(_texture);
+	bgen->setWorldShade(0);
+	if (_mission == "STR_BASE_DEFENCE")
+	{
+		bgen->setBase(base);
+	}
+	else
+	{
+		bgen->setCraft(base->getCrafts()->at(0));
+	}
+	if (!_ufoType.empty())
+	{
+		delete _ufo;
+		_ufo = new Ufo(_game->getRuleset()->getUfo(_ufoType));
+		_ufo->setLatitude(_ufoLatitude);
+		bgen->setUfo(_ufo);
+	}
+	bgen->setAlienRace("STR_SECTOID");
+	bgen->setAlienItemlevel(0);
+	bgen->run();
+	delete bgen;
+	battle->resetUnitTiles();
+	return battle;
+}
+
+/**
+ * Generates the mission, gives every soldier to the AI and plays out turns
+ * until either side is out of units or the turn limit is reached. Nothing is drawn, and actions don't wait for
+ * animations. Afterwards the time spent in each part of the battlescape
+ * during the battle is written out. Parts can run inside each other, like
+ * pathfinding inside the AI, so their times don't add up.
+ * @param out Stream to write the report to.
+ */
+void BattleSimulator::run(std::ostream &out)
+{
+	Profiler::setEnabled(true);
+	double start = CrossPlatform::getTime();
+
+	SavedBattleGame *battle = generate();
+
+	for (std::vector<BattleUnit*>::iterator i = battle->getUnits()->begin(); i != battle->getUnits()->end(); ++i)
+	{
+		if ((*i)->getFaction() == FACTION_PLAYER)
+		{
+			(*i)->setAIState(new PatrolBAIState(battle, *i, 0));
+		}
+	}
+
+	BattlescapeState *state = new BattlescapeState(_game);
+	_game->pushState(state);
+	state->init();
+	BattlescapeGame *battleGame = state->getBattleGame();
+	battleGame->setHeadless(true);
+	double generated = CrossPlatform::getTime();
+	Profiler::reset();
+
+	int soldiers, aliens, turn = 0, steps = 0;
+	countUnits(battle, &soldiers, &aliens);
+	while (soldiers > 0 && aliens > 0 && battle->getTurn() <= _turns)
+	{
+		countStep(battle, &turn, &steps);
+		battleGame->think();
+		battleGame->handleState();
+		countUnits(battle, &soldiers, &aliens);
+	}
+	double finished = CrossPlatform::getTime();
+	Profiler::setEnabled(false);
+
+	out << "Mission: " << _mission << std::endl;
+	out << "Seed: " << RNG::getSeed() << " (battle " << battle->getSeed() << ")" << std::endl;
+	out << "Map size: " << battle->getWidth() << "x" << battle->getLength() << "x" << battle->getHeight() << std::endl;
+	out << "Turns: " << battle->getTurn() << std::endl;
+	out << "Soldiers left: " << soldiers << std::endl;
+	out << "Aliens left: " << aliens << std::endl;
+	out << std::fixed << std::setprecision(2);
+	out << "Generation (ms): " << (generated - start) * 1000.0 << std::endl;
+	out << "Battle (ms): " << (finished - generated) * 1000.0 << std::endl;
+	out << std::endl;
+	Profiler::report(out);
+}
+
+/**
+ * Replays a battle recorded by the game: loads the save the battle started
+ * from and gives the player's commands from the log, while the AI plays the
+ * other sides the same way it did, as all its randomness comes from the
+ * saved streams. Headless, the replay runs until the log runs out and the
+ * other sides are done with their turn, or either side is out of units. It
+ * then writes out whether it matched the recording turn by turn, whether it
+ * ended in the same state as the recorded battle, and the time spent, like
+ * run() does. Watched, the battle is shown on screen without animations and
+ * the player takes over afterwards.
+ * @param filename Full path of the battle log.
+ * @param watch Show the battle on screen?
+ * @param out Stream to write the report to.
+ * @return False if the headless replay stopped matching the recording.
+ */
+bool BattleSimulator::replay(const std::string &filename, bool watch, std::ostream &out)
+{
+	BattleLog *log = new BattleLog();
+	try
+	{
+		log->load(filename);
+		SavedGame *save = new SavedGame(DIFF_BEGINNER);
+		_game->setSavedGame(save);
+		save->load(log->getSave(), _game->getRuleset());
+		if (save->getBattleGame() == 0)
+		{
+			throw Exception(log->getSave() + " is not a battle");
+		}
+	}
+	catch (...)
+	{
+		delete log;
+		throw;
+	}
+	SavedBattleGame *battle = _game->getSavedGame()->getBattleGame();
+	battle->loadMapResources(_game->getResourcePack());
+
+	if (watch)
+	{
+		_game->setState(new GeoscapeState(_game));
+		BattlescapeState *state = new BattlescapeState(_game);
+		_game->pushState(state);
+		state->getBattleGame()->setLog(log);
+		_game->run();
+		return true;
+	}
+
+	BattlescapeState *state = new BattlescapeState(_game);
+	_game->pushState(state);
+	state->init();
+	BattlescapeGame *battleGame = state->getBattleGame();
+	battleGame->setLog(log);
+	battleGame->setHeadless(true);
+
+	Profiler::setEnabled(true);
+	Profiler::reset();
+	double start = CrossPlatform::getTime();
+	int soldiers, aliens, turn = 0, steps = 0;
+	countUnits(battle, &soldiers, &aliens);
+	while (soldiers > 0 && aliens > 0 && battleGame->isReplaying())
+	{
+		countStep(battle, &turn, &steps);
+		battleGame->think();
+		battleGame->handleState();
+		countUnits(battle, &soldiers, &aliens);
+	}
+	// let the last command play out, and the other sides finish their turn;
+	// the player's side is left alone, as the AI would take it over
+	while (soldiers > 0 && aliens > 0 && (battleGame->isBusy() || battle->getSide() != FACTION_PLAYER))
+	{
+		countStep(battle, &turn, &steps);
+		if (battle->getSide() != FACTION_PLAYER)
+		{
+			battleGame->think();
+		}
+		battleGame->handleState();
+		countUnits(battle, &soldiers, &aliens);
+	}
+	double finished = CrossPlatform::getTime();
+	Profiler::setEnabled(false);
+
+	out << "Replay: " << filename << std::endl;
+	out << "Save: " << log->getSave() << std::endl;
+	out << "Turns: " << battle->getTurn() << std::endl;
+	out << "Soldiers left: " << soldiers << std::endl;
+	out << "Aliens left: " << aliens << std::endl;
+	out << "Turn checks matched: " << log->getChecks() << std::endl;
+	if (log->getDivergedTurn() == -1)
+	{
+		out << "Diverged: no" << std::endl;
+	}
+	else
+	{
+		out << "Diverged: turn " << log->getDivergedTurn() << std::endl;
+	}
+	bool matched = log->getDivergedTurn() == -1;
+	if (!log->hasFinal())
+	{
+		out << "Final state: not recorded" << std::endl;
+	}
+	else if (log->checkFinal(battle))
+	{
+		out << "Final state: matches" << std::endl;
+	}
+	else
+	{
+		out << "Final state: differs" << std::endl;
+		matched = false;
+	}
+	out << std::fixed << std::setprecision(2);
+	out << "Battle (ms): " << (finished - start) * 1000.0 << std::endl;
+	out << std::endl;
+	Profiler::report(out);
+	return matched;
+}
+
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_BATTLESIMULATOR_H
+#define OPENXCOM_BATTLESIMULATOR_H
+
+#include <string>
+#include <ostream>
+
+namespace OpenXcom
+{
+
+class Game;
+class SavedBattleGame;
+class Ufo;
+
+/**
+ * Plays out a battle with the AI on both sides and nothing drawn on screen,
+ * timing the battlescape code on the way. Used by the openxcom_sim build
+ * to measure the battlescape on machines without a display, and to replay
+ * battles recorded by the game.
+ */
+class BattleSimulator
+{
+private:
+	static const int MAX_TURN_STEPS = 1000000;
+	Game *_game;
+	std::string _mission;
+	int _texture, _turns;
+	std::string _ufoType;
+	double _ufoLatitude;
+	Ufo *_ufo;
+	/// Counts the units still in the battle.
+	void countUnits(SavedBattleGame *battle, int *soldiers, int *aliens) const;
+	/// Counts a step of the battle, failing if a turn takes too many.
+	void countStep(SavedBattleGame *battle, int *turn, int *steps) const;
+public:
+	/// Creates a new battle simulator.
+	BattleSimulator(Game *game, const std::string &mission, int texture, int turns);
+	/// Cleans up the battle simulator.
+	~BattleSimulator();
+	/// Sets the UFO the mission takes place around.
+	void setUfo(const std::string &type, double latitude);
+	/// Generates the battle.
+	SavedBattleGame *generate();
+	/// Plays out the battle.
+	void run(std::ostream &out);
+	/// Replays a recorded battle.
+	bool replay(const std::string &filename, bool watch, std::ostream &out);
+};
+
+}
+
+#endif
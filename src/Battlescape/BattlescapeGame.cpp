@@ -40,6 +40,7 @@
 #include "AggroBAIState.h"
 #include "PatrolBAIState.h"
 #include "Pathfinding.h"
+#include "BattleLog.h"
 #include "../Engine/Game.h"
 #include "../Engine/Music.h"
 #include "../Engine/Language.h"
@@ -68,6 +69,7 @@
 #include "../Ruleset/RuleItem.h"
 #include "../Ruleset/Armor.h"
 #include "../Engine/Options.h"
+#include "../Engine/Profiler.h"
 #include "WarningMessage.h"
 #include "BattlescapeOptionsState.h"
 #include "DebriefingState.h"
@@ -88,6 +90,8 @@ BattlescapeGame::BattlescapeGame(SavedBattleGame *save, BattlescapeState *parent
 {
 	_tuReserved = BA_NONE;
 	_debugPlay = false;
+	_headless = false;
+	_log = 0;
 	_playerPanicHandled = true;
 	_AIActionCounter = 0;
 	_currentAction.actor = 0;
@@ -104,6 +108,7 @@ BattlescapeGame::BattlescapeGame(SavedBattleGame *save, BattlescapeState *parent
  */
 BattlescapeGame::~BattlescapeGame()
 {
+	delete _log;
 }
 
 /**
@@ -114,8 +119,8 @@ void BattlescapeGame::think()
 	// nothing is happening - see if we need some alien AI or units panicking or what have you
 	if (_states.empty())
 	{
-		// it's a non player side (ALIENS or CIVILIANS)
-		if (_save->getSide() != FACTION_PLAYER)
+		// it's a non player side (ALIENS or CIVILIANS), or the AI plays all sides
+		if (_save->getSide() != FACTION_PLAYER || aiPlaysPlayer())
 		{
 			if (!_debugPlay)
 			{
@@ -148,6 +153,10 @@ void BattlescapeGame::think()
 			{
 				_playerPanicHandled = handlePanickingPlayer();
 			}
+			else if (isReplaying())
+			{
+				replayEntry();
+			}
 
 		}
 	}
@@ -155,7 +164,7 @@ void BattlescapeGame::think()
 
 void BattlescapeGame::init()
 {
-	if (_save->getSide() == FACTION_PLAYER)
+	if (_save->getSide() == FACTION_PLAYER && !aiPlaysPlayer())
 	{
 		_playerPanicHandled = false;
 	}
@@ -168,6 +177,7 @@ void BattlescapeGame::init()
  */
 void BattlescapeGame::handleAI(BattleUnit *unit)
 {
+	Profiler::Scope profile("BattlescapeGame::handleAI");
 	BattleAIState *ai = unit->getCurrentAIState();
 	if (!ai)
 	{
@@ -184,7 +194,8 @@ void BattlescapeGame::handleAI(BattleUnit *unit)
 	unit->think(&action);
 	if (action.type == BA_WALK)
 	{
- 		_save->getPathfinding()->calculate(action.actor, action.target);
+		bool patrol = dynamic_cast<PatrolBAIState*>(unit->getCurrentAIState()) != 0;
+		_save->getPathfinding()->calculate(action.actor, action.target, patrol);
 		statePushBack(new UnitWalkBState(this, action));
 	}
 
@@ -226,12 +237,15 @@ void BattlescapeGame::handleAI(BattleUnit *unit)
  */
 void BattlescapeGame::kneel(BattleUnit *bu)
 {
+	record(BattleLog::ENTRY_KNEEL, BA_NONE, 0);
 	int tu = bu->isKneeled()?8:4;
 	if (checkReservedTU(bu, tu))
 	{
 		if (bu->spendTimeUnits(tu, _save->getDebugMode()))
 		{
 			bu->kneel(!bu->isKneeled());
+			// lines of sight from and past the unit change with its height
+			getTileEngine()->invalidateSightLines(bu->getPosition(), bu->getPosition());
 			// kneeling or standing up can reveal new terrain or units. I guess.
 			getTileEngine()->calculateFOV(bu);
 			getMap()->cacheUnits();
@@ -284,6 +298,10 @@ void BattlescapeGame::endTurn()
 	}
 
 	_save->endTurn();
+	if (_log)
+	{
+		_log->check(_save);
+	}
 	bool bBattleIsOver = checkForCasualties(0, 0, false, false);
 	if (bBattleIsOver)
 	{
@@ -323,7 +341,15 @@ void BattlescapeGame::endTurn()
 
 	if (_save->getSide() != FACTION_NEUTRAL)
 	{
-		_parentState->getGame()->pushState(new NextTurnState(_parentState->getGame(), _save, _parentState));
+		if (_headless || isReplaying())
+		{
+			// nobody to click the next turn screen away, start the turn right away
+			init();
+		}
+		else
+		{
+			_parentState->getGame()->pushState(new NextTurnState(_parentState->getGame(), _save, _parentState));
+		}
 	}
 
 }
@@ -374,7 +400,7 @@ bool BattlescapeGame::checkForCasualties(BattleItem *murderweapon, BattleUnit *m
 					{
 						int closest = 1000000;
 						BattleUnit *revenger = 0;
-						bool revenge = RNG::generate(0,100) < 50;
+						bool revenge = RNG::generate(0,100,RNG::AI) < 50;
 						for (std::vector<BattleUnit*>::iterator h = _save->getUnits()->begin(); h != _save->getUnits()->end(); ++h)
 						{
 							if ((*h)->getFaction() == FACTION_HOSTILE && !(*h)->isOut() && (*h) != victim)
@@ -466,6 +492,7 @@ void BattlescapeGame::handleNonTargetAction()
 	{
 		if (_currentAction.type == BA_PRIME && _currentAction.value > -1)
 		{
+			record(BattleLog::ENTRY_ACTION, BA_PRIME, _currentAction.value);
 			if (_currentAction.actor->spendTimeUnits(_currentAction.TU, dontSpendTUs()))
 			{
 				_currentAction.weapon->setExplodeTurn(_save->getTurn() + _currentAction.value);
@@ -542,18 +569,26 @@ void BattlescapeGame::handleState()
 {
 	if (!_states.empty())
 	{
-		// end turn request?
-		if (_states.front() == 0)
+		// a replay doesn't wait for animations, it runs a number of steps between redraws
+		int steps = isReplaying() ? 50 : 1;
+		for (int i = 0; i < steps && !_states.empty(); ++i)
 		{
-			_states.pop_front();
-			endTurn();
-			return;
+			// end turn request?
+			if (_states.front() == 0)
+			{
+				_states.pop_front();
+				endTurn();
+				return;
+			}
+			else
+			{
+				_states.front()->think();
+			}
 		}
-		else
+		if (!_headless)
 		{
-			_states.front()->think();
+			getMap()->draw(); // redraw map
 		}
-		getMap()->draw(); // redraw map
 	}
 }
 
@@ -635,7 +670,7 @@ void BattlescapeGame::popState()
 	// handle the end of this unit's actions
 	if (action.actor && noActionsPending(action.actor))
 	{
-		if (action.actor->getFaction() == FACTION_PLAYER)
+		if (action.actor->getFaction() == FACTION_PLAYER && !aiPlaysPlayer())
 		{
 			// spend TUs of "target triggered actions" (shooting, throwing) only
 			// the other actions' TUs (healing,scanning,..) are already take care of
@@ -664,7 +699,7 @@ void BattlescapeGame::popState()
 		{
 			// spend TUs
 			action.actor->spendTimeUnits(action.TU, false);
-			if (_save->getSide() != FACTION_PLAYER && !_debugPlay)
+			if ((_save->getSide() != FACTION_PLAYER || aiPlaysPlayer()) && !_debugPlay)
 			{
 				 // AI does two things per unit, before switching to the next, or it got killed before doing the second thing
 				if (_AIActionCounter > 1 || _save->getSelectedUnit() == 0 || _save->getSelectedUnit()->isOut())
@@ -751,6 +786,171 @@ void BattlescapeGame::setStateInterval(Uint32 interval)
 }
 
 
+/**
+ * Lets the AI play all sides, without drawing the map or showing the next turn
+ * screen, so battles can be played out without anyone watching.
+ * @param headless Does the AI play all sides?
+ */
+void BattlescapeGame::setHeadless(bool headless)
+{
+	_headless = headless;
+}
+
+/**
+ * Checks if the AI plays the player's side: when headless,
+ * unless the player's commands come from a replay.
+ * @return True if the AI plays the player's side.
+ */
+bool BattlescapeGame::aiPlaysPlayer() const
+{
+	return _headless && !isReplaying();
+}
+
+/**
+ * Sets the battle log the player's commands are recorded to,
+ * or replayed from. The battlescape takes care of deleting it.
+ * @param log Pointer to the battle log.
+ */
+void BattlescapeGame::setLog(BattleLog *log)
+{
+	delete _log;
+	_log = log;
+}
+
+/**
+ * Checks if the player's commands are being replayed from a battle log.
+ * @return True if replaying.
+ */
+bool BattlescapeGame::isReplaying() const
+{
+	return _log != 0 && _log->isReplaying();
+}
+
+/**
+ * Records the state the battle ended in, if a battle log is being recorded.
+ */
+void BattlescapeGame::finishLog()
+{
+	if (_log)
+	{
+		_log->finish(_save);
+	}
+}
+
+/**
+ * Records a command of the player in the battle log, if one is being recorded.
+ * Actions take their actor, weapon, time units and target from the current action.
+ * @param type Kind of log entry.
+ * @param action Type of action.
+ * @param value Extra value of the command, like the turns a grenade is primed for.
+ */
+void BattlescapeGame::record(int type, BattleActionType action, int value)
+{
+	if (_log == 0 || !_log->isRecording())
+		return;
+
+	BattleLog::Entry entry;
+	entry.type = (BattleLog::EntryType)type;
+	entry.action = action;
+	entry.turn = _save->getTurn();
+	entry.value = value;
+	if (_save->getSelectedUnit())
+	{
+		entry.actor = _save->getSelectedUnit()->getId();
+	}
+	if (type == BattleLog::ENTRY_ACTION)
+	{
+		entry.actor = _currentAction.actor ? _currentAction.actor->getId() : -1;
+		entry.weapon = _currentAction.weapon ? _currentAction.weapon->getId() : -1;
+		entry.TU = _currentAction.TU;
+		entry.target = _currentAction.target;
+		entry.waypoints.assign(_currentAction.waypoints.begin(), _currentAction.waypoints.end());
+	}
+	_log->add(entry);
+}
+
+/**
+ * Gives the next command from the battle log being replayed,
+ * going through the same steps as when the player gave it.
+ */
+void BattlescapeGame::replayEntry()
+{
+	const BattleLog::Entry *entry = _log->next();
+	if (entry == 0)
+		return;
+
+	if (entry->type == BattleLog::ENTRY_END_TURN)
+	{
+		requestEndTurn();
+		return;
+	}
+	if (entry->type == BattleLog::ENTRY_RESERVE)
+	{
+		setTUReserved((BattleActionType)entry->value);
+		return;
+	}
+
+	BattleUnit *actor = 0;
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		if ((*i)->getId() == entry->actor)
+		{
+			actor = *i;
+		}
+	}
+	if (actor == 0 || actor->isOut())
+		return;
+	_save->setSelectedUnit(actor);
+	_currentAction.actor = actor;
+	if (entry->type == BattleLog::ENTRY_KNEEL)
+	{
+		kneel(actor);
+		return;
+	}
+
+	_currentAction.type = entry->action;
+	_currentAction.weapon = 0;
+	for (std::vector<BattleItem*>::iterator i = _save->getItems()->begin(); i != _save->getItems()->end(); ++i)
+	{
+		if ((*i)->getId() == entry->weapon)
+		{
+			_currentAction.weapon = *i;
+		}
+	}
+	_currentAction.TU = entry->TU;
+	_currentAction.value = entry->value;
+	_currentAction.target = entry->target;
+	_currentAction.waypoints.assign(entry->waypoints.begin(), entry->waypoints.end());
+	_currentAction.targeting = false;
+	switch (entry->action)
+	{
+	case BA_WALK:
+		_currentAction.type = BA_NONE;
+		_save->getPathfinding()->calculate(actor, entry->target);
+		if (actor->isKneeled())
+		{
+			kneel(actor);
+		}
+		statePushBack(new UnitWalkBState(this, _currentAction));
+		break;
+	case BA_TURN:
+		_currentAction.type = BA_NONE;
+		statePushBack(new UnitTurnBState(this, _currentAction));
+		break;
+	case BA_PRIME:
+		handleNonTargetAction();
+		break;
+	case BA_LAUNCH:
+		_currentAction.targeting = true;
+		launchAction();
+		break;
+	default:
+		_currentAction.targeting = true;
+		primaryAction(entry->target);
+		break;
+	}
+}
+
 /**
  * Check against reserved time units.
  * @param bu Pointer to the unit.
@@ -816,7 +1016,7 @@ bool BattlescapeGame::handlePanickingUnit(BattleUnit *unit)
 
 	unit->abortTurn(); //makes the unit go to status STANDING :p
 
-	int flee = RNG::generate(0,100);
+	int flee = RNG::generate(0,100,RNG::COMBAT);
 	switch (status)
 	{
 	case STATUS_PANICKING: // 1/2 chance to freeze and 1/2 chance try to flee
@@ -837,7 +1037,7 @@ bool BattlescapeGame::handlePanickingUnit(BattleUnit *unit)
 			unit->setCache(0);
 			BattleAction ba;
 			ba.actor = unit;
-			ba.target = Position(unit->getPosition().x + RNG::generate(-5,5), unit->getPosition().y + RNG::generate(-5,5), unit->getPosition().z);
+			ba.target = Position(unit->getPosition().x + RNG::generate(-5,5,RNG::COMBAT), unit->getPosition().y + RNG::generate(-5,5,RNG::COMBAT), unit->getPosition().z);
 			if (_save->getTile(ba.target)) // only walk towards it when the place exists
 			{
 				_save->getPathfinding()->calculate(ba.actor, ba.target);
@@ -850,7 +1050,7 @@ bool BattlescapeGame::handlePanickingUnit(BattleUnit *unit)
 		for (int i= 0; i < 4; i++)
 		{
 			ba.actor = unit;
-			ba.target = Position(unit->getPosition().x + RNG::generate(-5,5), unit->getPosition().y + RNG::generate(-5,5), unit->getPosition().z);
+			ba.target = Position(unit->getPosition().x + RNG::generate(-5,5,RNG::COMBAT), unit->getPosition().y + RNG::generate(-5,5,RNG::COMBAT), unit->getPosition().z);
 			statePushBack(new UnitTurnBState(this, ba));
 		}
 		for (std::vector<BattleUnit*>::iterator j = unit->getVisibleUnits()->begin(); j != unit->getVisibleUnits()->end(); ++j)
@@ -974,6 +1174,7 @@ void BattlescapeGame::primaryAction(const Position &pos)
 			_currentAction.target = pos;
 			getMap()->setCursorType(CT_NONE);
 			_parentState->getGame()->getCursor()->setVisible(false);
+			record(BattleLog::ENTRY_ACTION, _currentAction.type, _currentAction.value);
 			_states.push_back(new ProjectileFlyBState(this, _currentAction));
 			statePushFront(new UnitTurnBState(this, _currentAction)); // first of all turn towards the target
 		}
@@ -1014,6 +1215,7 @@ void BattlescapeGame::primaryAction(const Position &pos)
 				{
 					kneel(_save->getSelectedUnit());
 				}
+				record(BattleLog::ENTRY_ACTION, BA_WALK, 0);
 				statePushBack(new UnitWalkBState(this, _currentAction));
 			}
 		}
@@ -1028,6 +1230,7 @@ void BattlescapeGame::secondaryAction(const Position &pos)
 {
 	//  -= turn to or open door =-
 	_currentAction.target = pos;
+	record(BattleLog::ENTRY_ACTION, BA_TURN, 0);
 	statePushBack(new UnitTurnBState(this, _currentAction));
 }
 
@@ -1039,6 +1242,7 @@ void BattlescapeGame::launchAction()
 	_parentState->showLaunchButton(false);
 	getMap()->getWaypoints()->clear();
 	_currentAction.target = _currentAction.waypoints.front();
+	record(BattleLog::ENTRY_ACTION, BA_LAUNCH, _currentAction.value);
 	getMap()->setCursorType(CT_NONE);
 	_parentState->getGame()->getCursor()->setVisible(false);
 	_states.push_back(new ProjectileFlyBState(this, _currentAction));
@@ -1068,6 +1272,7 @@ void BattlescapeGame::moveUpDown(BattleUnit *unit, int dir)
 		kneel(_save->getSelectedUnit());
 	}
 	_save->getPathfinding()->calculate(_currentAction.actor, _currentAction.target);
+	record(BattleLog::ENTRY_ACTION, BA_WALK, 0);
 	statePushBack(new UnitWalkBState(this, _currentAction));
 }
 
@@ -1076,6 +1281,7 @@ void BattlescapeGame::moveUpDown(BattleUnit *unit, int dir)
  */
 void BattlescapeGame::requestEndTurn()
 {
+	record(BattleLog::ENTRY_END_TURN, BA_NONE, 0);
 	cancelCurrentAction();
 	statePushBack(0);
 }
@@ -1086,6 +1292,7 @@ void BattlescapeGame::requestEndTurn()
  */
 void BattlescapeGame::setTUReserved(BattleActionType tur)
 {
+	record(BattleLog::ENTRY_RESERVE, BA_NONE, tur);
 	_tuReserved = tur;
 }
 
@@ -38,6 +38,7 @@ class Map;
 class TileEngine;
 class Pathfinding;
 class Ruleset;
+class BattleLog;
 
 enum BattleActionType { BA_NONE, BA_TURN, BA_WALK, BA_PRIME, BA_THROW, BA_AUTOSHOT, BA_SNAPSHOT, BA_AIMEDSHOT, BA_STUN, BA_HIT, BA_USE, BA_LAUNCH, BA_MINDCONTROL, BA_PANIC };
 
@@ -65,15 +66,19 @@ private:
 	BattlescapeState *_parentState;
 	std::list<BattleState*> _states;
 	BattleActionType _tuReserved;
-	bool _debugPlay, _playerPanicHandled;
+	bool _debugPlay, _headless, _playerPanicHandled;
 	int _AIActionCounter;
 	BattleAction _currentAction;
+	BattleLog *_log;
 
 	void selectNextPlayerUnit(bool checkReselect);
 	void endTurn();
 	bool handlePanickingPlayer();
 	bool handlePanickingUnit(BattleUnit *unit);
 	bool noActionsPending(BattleUnit *bu);
+	bool aiPlaysPlayer() const;
+	void record(int type, BattleActionType action, int value);
+	void replayEntry();
 public:
 	/// Creates the BattlescapeGame state.
 	BattlescapeGame(SavedBattleGame *save, BattlescapeState *parentState);
@@ -102,6 +107,14 @@ public:
 	bool checkForCasualties(BattleItem *murderweapon, BattleUnit *murderer, bool hiddenExplosion = false, bool terrainExplosion = false);
 	/// Checks if a unit panics.
 	void checkForPanic(BattleUnit *unit);
+	/// Let the AI play all sides.
+	void setHeadless(bool headless);
+	/// Set the log to record to or replay from.
+	void setLog(BattleLog *log);
+	/// Is a battle log being replayed?
+	bool isReplaying() const;
+	/// Record the end of the battle in the log.
+	void finishLog();
 	/// Check reserved tu.
 	bool checkReservedTU(BattleUnit *bu, int tu);
 	/// Handles unit AI.
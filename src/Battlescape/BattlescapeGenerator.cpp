@@ -18,6 +18,7 @@
  */
 #include <fstream>
 #include <sstream>
+#include <climits>
 #include "BattlescapeGenerator.h"
 #include "TileEngine.h"
 #include "../Savegame/SavedGame.h"
@@ -156,6 +157,12 @@ void BattlescapeGenerator::setBase(Base *base)
  */
 void BattlescapeGenerator::run()
 {
+	// the battle gets its own seed, unless one was picked for it
+	if (_save->getSeed() == -1)
+	{
+		_save->setSeed(RNG::generate(0, INT_MAX, RNG::GEOSCAPE));
+	}
+
 	AlienDeployment *ruleDeploy = _game->getRuleset()->getDeployment(_ufo?_ufo->getRules()->getType():_save->getMissionType());
 
 	ruleDeploy->getDimensions(&_width, &_length, &_height);
@@ -347,7 +354,7 @@ BattleUnit *BattlescapeGenerator::addXCOMUnit(BattleUnit *unit)
 		{
 			_save->setUnitPosition(unit, node->getPosition());
 		}
-		unit->setDirection(RNG::generate(0,7));
+		unit->setDirection(RNG::generate(0,7,RNG::MAP));
 	}
 	else
 	{
@@ -381,10 +388,10 @@ void BattlescapeGenerator::deployAliens(AlienRace *race, AlienDeployment *deploy
 	{
 		std::string alienName = race->getMember((*d).alienRank);
 		// TODO: make this depend on difficulty level
-		int quantity = (*d).lowQty + RNG::generate(0, (*d).dQty);
+		int quantity = (*d).lowQty + RNG::generate(0, (*d).dQty, RNG::MAP);
 		for (int i = 0; i < quantity; i++)
 		{
-			bool outside = RNG::generate(0,99) < (*d).percentageOutsideUfo;
+			bool outside = RNG::generate(0,99,RNG::MAP) < (*d).percentageOutsideUfo;
 			if (_ufo == 0)
 				outside = false;
 			BattleUnit *unit = addAlien(_game->getRuleset()->getUnit(alienName), (*d).alienRank, outside);
@@ -449,7 +456,7 @@ BattleUnit *BattlescapeGenerator::addAlien(Unit *rules, int alienRank, bool outs
 	{
 		_save->setUnitPosition(unit, node->getPosition());
 		unit->setAIState(new PatrolBAIState(_game->getSavedGame()->getBattleGame(), unit, node));
-		unit->setDirection(RNG::generate(0,7));
+		unit->setDirection(RNG::generate(0,7,RNG::MAP));
 	}
 
 
@@ -474,7 +481,7 @@ BattleUnit *BattlescapeGenerator::addCivilian(Unit *rules)
 	{
 		_save->setUnitPosition(unit, node->getPosition());
 		unit->setAIState(new PatrolBAIState(_game->getSavedGame()->getBattleGame(), unit, node));
-		unit->setDirection(RNG::generate(0,7));
+		unit->setDirection(RNG::generate(0,7,RNG::MAP));
 	}
 
 	_save->getUnits()->push_back(unit);
@@ -689,8 +696,8 @@ void BattlescapeGenerator::generateMap()
 		// pick a random ufo mapblock, can have all kinds of sizes
 		ufoMap = _ufo->getRules()->getBattlescapeTerrainData()->getRandomMapBlock(999, MT_DEFAULT);
 
-		ufoX = RNG::generate(0, (_length / 10) - ufoMap->getWidth() / 10);
-		ufoY = RNG::generate(0, (_width / 10) - ufoMap->getLength() / 10);
+		ufoX = RNG::generate(0, (_length / 10) - ufoMap->getWidth() / 10, RNG::MAP);
+		ufoY = RNG::generate(0, (_width / 10) - ufoMap->getLength() / 10, RNG::MAP);
 
 		for (int i = 0; i < ufoMap->getWidth() / 10; ++i)
 		{
@@ -708,8 +715,8 @@ void BattlescapeGenerator::generateMap()
 		craftMap = _craft->getRules()->getBattlescapeTerrainData()->getRandomMapBlock(999, MT_DEFAULT);
 		while (!placed)
 		{
-			craftX = RNG::generate(0, (_length/10)- craftMap->getWidth() / 10);
-			craftY = RNG::generate(0, (_width/10)- craftMap->getLength() / 10);
+			craftX = RNG::generate(0, (_length/10)- craftMap->getWidth() / 10, RNG::MAP);
+			craftY = RNG::generate(0, (_width/10)- craftMap->getLength() / 10, RNG::MAP);
 			placed = true;
 			// check if this place is ok
 			for (int i = 0; i < craftMap->getWidth() / 10; ++i)
@@ -735,16 +742,16 @@ void BattlescapeGenerator::generateMap()
 	/* determine positioning of the urban terrain roads */
 	if (_save->getMissionType() == "STR_TERROR_MISSION")
 	{
-		bool EWRoad = RNG::generate(0,99) < 33;
+		bool EWRoad = RNG::generate(0,99,RNG::MAP) < 33;
 		bool NSRoad = !EWRoad;
-		bool TwoRoads = RNG::generate(0,99) < 25;
+		bool TwoRoads = RNG::generate(0,99,RNG::MAP) < 25;
 		int roadX = craftX;
 		int roadY = craftY;
 		// make sure the road(s) are not crossing the craftin landing site
 		while (roadX == craftX || roadY == craftY)
 		{
-			roadX = RNG::generate(0, (_length/10)- 1);
-			roadY = RNG::generate(0, (_width/10)- 1);
+			roadX = RNG::generate(0, (_length/10)- 1, RNG::MAP);
+			roadY = RNG::generate(0, (_width/10)- 1, RNG::MAP);
 		}
 		if (TwoRoads)
 		{
@@ -872,7 +879,7 @@ void BattlescapeGenerator::generateMap()
 
 	for (std::vector<MapDataSet*>::iterator i = _terrain->getMapDataSets()->begin(); i != _terrain->getMapDataSets()->end(); ++i)
 	{
-		(*i)->loadData();
+		(*i)->loadData(_res->getVoxelData());
 		_save->getMapDataSets()->push_back(*i);
 		mapDataSetIDOffset++;
 	}
@@ -966,7 +973,7 @@ void BattlescapeGenerator::generateMap()
 	{
 		for (std::vector<MapDataSet*>::iterator i = _ufo->getRules()->getBattlescapeTerrainData()->getMapDataSets()->begin(); i != _ufo->getRules()->getBattlescapeTerrainData()->getMapDataSets()->end(); ++i)
 		{
-			(*i)->loadData();
+			(*i)->loadData(_res->getVoxelData());
 			_save->getMapDataSets()->push_back(*i);
 			craftDataSetIDOffset++;
 		}
@@ -985,7 +992,7 @@ void BattlescapeGenerator::generateMap()
 	{
 		for (std::vector<MapDataSet*>::iterator i = _craft->getRules()->getBattlescapeTerrainData()->getMapDataSets()->begin(); i != _craft->getRules()->getBattlescapeTerrainData()->getMapDataSets()->end(); ++i)
 		{
-			(*i)->loadData();
+			(*i)->loadData(_res->getVoxelData());
 			_save->getMapDataSets()->push_back(*i);
 		}
 		loadMAP(craftMap, craftX * 10, craftY * 10, _craft->getRules()->getBattlescapeTerrainData(), mapDataSetIDOffset + craftDataSetIDOffset, true);
@@ -1213,13 +1220,13 @@ void BattlescapeGenerator::explodePowerSources()
 {
 	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
 	{
-		if (_save->getTiles()[i]->getMapData(MapData::O_OBJECT) && _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getSpecialType() == UFO_POWER_SOURCE && RNG::generate(0,100) < 75)
+		if (_save->getTiles()[i]->getMapData(MapData::O_OBJECT) && _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getSpecialType() == UFO_POWER_SOURCE && RNG::generate(0,100,RNG::MAP) < 75)
 		{
 			Position pos;
 			pos.x = _save->getTiles()[i]->getPosition().x*16;
 			pos.y = _save->getTiles()[i]->getPosition().y*16;
 			pos.z = (_save->getTiles()[i]->getPosition().z*24) +12;
-			_save->getTileEngine()->explode(pos, 180+RNG::generate(0,70), DT_HE, 11);
+			_save->getTileEngine()->explode(pos, 180+RNG::generate(0,70,RNG::MAP), DT_HE, 11);
 		}
 	}
 }
@@ -1229,11 +1236,11 @@ void BattlescapeGenerator::explodePowerSources()
  */
 void BattlescapeGenerator::deployCivilians(int max)
 {
-	int number = RNG::generate(1, max);
+	int number = RNG::generate(1, max, RNG::MAP);
 
 	for (int i = 0; i < number; ++i)
 	{
-		if (RNG::generate(0,100) < 50)
+		if (RNG::generate(0,100,RNG::MAP) < 50)
 		{
 			addCivilian(_game->getRuleset()->getUnit("MALE_CIVILIAN"));
 		}
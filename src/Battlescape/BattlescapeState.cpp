@@ -73,6 +73,7 @@
 #include "../Engine/RNG.h"
 #include "InfoboxState.h"
 #include "MiniMapState.h"
+#include "BattleLog.h"
 
 namespace OpenXcom
 {
@@ -329,6 +330,15 @@ BattlescapeState::BattlescapeState(Game *game) : State(game), _popups()
 
 	_battleGame = new BattlescapeGame(_save, this);
 
+	// keep the battle's start and the player's commands, so it can be replayed
+	if (Options::getBool("battleRecord"))
+	{
+		_game->getSavedGame()->save("replay_start");
+		BattleLog *log = new BattleLog();
+		log->record(Options::getUserFolder() + "battle.log", "replay_start");
+		_battleGame->setLog(log);
+	}
+
 	firstInit = true;
 }
 
@@ -907,6 +917,15 @@ Map *BattlescapeState::getMap() const
 	return _map;
 }
 
+/**
+ * Get pointer to the battlescape game, for driving it without the screen.
+ * @return Pointer to battlescape game.
+ */
+BattlescapeGame *BattlescapeState::getBattleGame() const
+{
+	return _battleGame;
+}
+
 /**
  * Show a debug message in the topleft corner.
  * @param message Debug message.
@@ -930,6 +949,16 @@ void BattlescapeState::warning(std::string message)
  */
 void BattlescapeState::handle(Action *action)
 {
+	// the player only watches while a replay runs
+	if (_battleGame->isReplaying())
+	{
+		Uint8 type = action->getDetails()->type;
+		if (type == SDL_MOUSEBUTTONDOWN || type == SDL_MOUSEBUTTONUP || type == SDL_KEYDOWN || type == SDL_KEYUP)
+		{
+			return;
+		}
+	}
+
 	if (_game->getCursor()->getVisible() || action->getDetails()->button.button == SDL_BUTTON_RIGHT)
 	{
 		State::handle(action);
@@ -971,6 +1000,7 @@ void BattlescapeState::popup(State *state)
  */
 void BattlescapeState::finishBattle(bool abort)
 {
+	_battleGame->finishLog();
 	_game->popState();
 	_save->setAborted(abort);
 	_game->pushState(new DebriefingState(_game));
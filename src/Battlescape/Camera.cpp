@@ -187,18 +187,30 @@ void Camera::mouseOver(Action *action, State *state)
  */
 void Camera::scroll()
 {
-	_mapOffset.x += _scrollX;
-	_mapOffset.y += _scrollY;
+	scrollXY(_scrollX, _scrollY, true);
+}
+
+/**
+ * Scrolls the view a number of pixels, unless that
+ * would move its center off the map.
+ * @param x Pixels to scroll right.
+ * @param y Pixels to scroll down.
+ * @param redraw Redraw map or not.
+ */
+void Camera::scrollXY(int x, int y, bool redraw)
+{
+	_mapOffset.x += x;
+	_mapOffset.y += y;
 
 	convertScreenToMap((_screenWidth / 2), (_screenHeight / 2), &_center.x, &_center.y);
 
 	// if center goes out of map bounds, hold the scrolling (may need further tweaking)
 	if (_center.x > _mapWidth - 1 || _center.y > _mapLength - 1 || _center.x < 0 || _center.y < 0)
 	{
-		_mapOffset.x -= _scrollX;
-		_mapOffset.y -= _scrollY;
+		_mapOffset.x -= x;
+		_mapOffset.y -= y;
 	}
-	_map->draw();
+	if (redraw) _map->draw();
 }
 
 /**
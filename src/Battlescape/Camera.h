@@ -62,6 +62,8 @@ public:
 	void keyboardPress(Action *action, State *state);
 	/// Scrolls the view (eg when mouse is on the edge of the screen)
 	void scroll();
+	/// Scrolls the view a number of pixels.
+	void scrollXY(int x, int y, bool redraw);
 	/// move map layer up
 	void up();
 	/// move map layer down
@@ -19,9 +19,13 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
 #include "Map.h"
 #include "Camera.h"
-#include "UnitSprite.h"
+#include "MapDrawList.h"
+#include "UnitSpriteCache.h"
 #include "Position.h"
 #include "Pathfinding.h"
 #include "TileEngine.h"
@@ -31,6 +35,7 @@
 #include "../Resource/ResourcePack.h"
 #include "../Engine/Action.h"
 #include "../Engine/SurfaceSet.h"
+#include "../Engine/SpanSprite.h"
 #include "../Engine/Timer.h"
 #include "../Engine/Font.h"
 #include "../Engine/Language.h"
@@ -39,14 +44,17 @@
 #include "../Engine/Game.h"
 #include "../Savegame/SavedBattleGame.h"
 #include "../Savegame/Tile.h"
+#include "../Savegame/TileGrid.h"
 #include "../Savegame/BattleUnit.h"
 #include "../Ruleset/MapDataSet.h"
 #include "../Ruleset/MapData.h"
 #include "../Ruleset/Armor.h"
+#include "../Ruleset/Ruleset.h"
 #include "BattlescapeMessage.h"
 #include "../Savegame/SavedGame.h"
 #include "../Interface/Cursor.h"
 #include "../Engine/Options.h"
+#include "../Engine/Profiler.h"
 #include "../Interface/NumberText.h"
 
 
@@ -74,7 +82,7 @@ namespace OpenXcom
  * @param x X position in pixels.
  * @param y Y position in pixels.
  */
-Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight) : InteractiveSurface(width, height, x, y), _game(game), _selectorX(0), _selectorY(0), _cursorType(CT_NORMAL), _cursorSize(1), _animFrame(0), _visibleMapHeight(visibleMapHeight)
+Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight) : InteractiveSurface(width, height, x, y), _game(game), _selectorX(0), _selectorY(0), _cursorType(CT_NORMAL), _cursorSize(1), _animFrame(0), _visibleMapHeight(visibleMapHeight), _waypointNumber(0), _fullRedraw(false)
 {
 	_res = _game->getResourcePack();
 	_spriteWidth = _res->getSurfaceSet("BLANKS.PCK")->getFrame(0)->getWidth();
@@ -85,7 +93,17 @@ Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight)
 	_scrollTimer = new Timer(SCROLL_INTERVAL);
 	_scrollTimer->onTimer((SurfaceHandler)&Map::scroll);
 	_camera->setScrollTimer(_scrollTimer);
-
+	_cursorSprites = _res->getSurfaceSet("CURSOR.PCK");
+	_smokeSprites = _res->getSurfaceSet("SMOKE.PCK");
+	_explosionSprites = _res->getSurfaceSet("X1.PCK");
+	_drawList = new MapDrawList(_save, _camera, _res->getSurfaceSet("FLOOROB.PCK"), _spriteWidth, _spriteHeight);
+	_unitSprites = new UnitSpriteCache(_res, _game->getRuleset()->getInventory("STR_RIGHT_HAND"), _spriteWidth, _spriteHeight);
+	_layers.resize(_save->getHeight());
+	// units could still point at frames of an earlier map
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		(*i)->clearCache();
+	}
 }
 
 /**
@@ -96,6 +114,13 @@ Map::~Map()
 	delete _scrollTimer;
 
 	delete _arrow;
+	delete _waypointNumber;
+	delete _drawList;
+	delete _unitSprites;
+	for (std::vector<TerrainLayer>::iterator i = _layers.begin(); i != _layers.end(); ++i)
+	{
+		delete i->surface;
+	}
 
 	for (int i = 0; i < 36; ++i)
 	{
@@ -135,6 +160,10 @@ void Map::init()
 		_bullet[i]->setPalette(this->getPalette());
 	}
 
+	_waypointNumber = new NumberText(15, 15, 20, 30);
+	_waypointNumber->setPalette(getPalette());
+	_waypointNumber->setColor(Palette::blockOffset(1));
+
 	_projectile = 0;
 }
 
@@ -171,6 +200,7 @@ void Map::draw()
 void Map::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 {
 	Surface::setPalette(colors, firstcolor, ncolors);
+	_unitSprites->setPalette(colors, firstcolor, ncolors);
 	for (std::vector<MapDataSet*>::const_iterator i = _save->getMapDataSets()->begin(); i != _save->getMapDataSets()->end(); ++i)
 	{
 		(*i)->getSurfaceset()->setPalette(colors, firstcolor, ncolors);
@@ -181,38 +211,254 @@ void Map::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 	_message->setText(_game->getLanguage()->getString("STR_HIDDEN_MOVEMENT"));
 }
 
+/**
+ * Gets the area a tile and anything on it can show up in: its terrain,
+ * a unit walking off it or standing on stairs below it, with the arrow
+ * over its head, fire, smoke and the cursor.
+ * @param entry The tile in the draw list.
+ * @return Area on the map surface.
+ */
+static SDL_Rect getTileArea(const MapDrawList::Entry &entry)
+{
+	SDL_Rect area;
+	area.x = entry.x - 16;
+	area.y = entry.y - 48;
+	area.w = 64;
+	area.h = 136;
+	return area;
+}
+
+/**
+ * Checks if two areas overlap.
+ * @param a First area.
+ * @param b Second area.
+ * @return True if they overlap.
+ */
+static bool overlaps(const SDL_Rect &a, const SDL_Rect &b)
+{
+	return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+/**
+ * Grows an area to take in another one.
+ * @param a Pointer to the area to grow.
+ * @param b Area to take in.
+ */
+static void unite(SDL_Rect *a, const SDL_Rect &b)
+{
+	int x1 = std::min(a->x, b.x), y1 = std::min(a->y, b.y);
+	int x2 = std::max(a->x + a->w, b.x + b.w), y2 = std::max(a->y + a->h, b.y + b.h);
+	a->x = x1;
+	a->y = y1;
+	a->w = x2 - x1;
+	a->h = y2 - y1;
+}
+
+/**
+ * Clears the clipping rectangle of a locked surface.
+ * @param surface Pointer to the surface.
+ */
+static void clearClip(Surface *surface)
+{
+	SDL_Surface *s = surface->getSurface();
+	const SDL_Rect &clip = s->clip_rect;
+	Uint8 *row = (Uint8*)s->pixels + clip.y * s->pitch + clip.x;
+	for (int y = 0; y < clip.h; ++y, row += s->pitch)
+	{
+		memset(row, 0, clip.w);
+	}
+}
+
+/**
+ * Copies a terrain layer onto a locked surface of the same size, as is.
+ * @param layer Pointer to the layer.
+ * @param surface Pointer to the surface.
+ */
+static void copyLayer(Surface *layer, Surface *surface)
+{
+	SDL_Surface *from = layer->getSurface(), *to = surface->getSurface();
+	Uint8 *src = (Uint8*)from->pixels, *dest = (Uint8*)to->pixels;
+	for (int y = 0; y < to->h; ++y, src += from->pitch, dest += to->pitch)
+	{
+		memcpy(dest, src, to->w);
+	}
+}
+
+/**
+ * Moves the contents of a locked surface, leaving what
+ * gets uncovered as it was.
+ * @param surface Pointer to the surface.
+ * @param dx Pixels to move right.
+ * @param dy Pixels to move down.
+ */
+static void shiftSurface(Surface *surface, int dx, int dy)
+{
+	SDL_Surface *s = surface->getSurface();
+	int w = s->w - abs(dx), h = s->h - abs(dy);
+	Uint8 *src = (Uint8*)s->pixels + std::max(-dy, 0) * s->pitch + std::max(-dx, 0);
+	Uint8 *dest = (Uint8*)s->pixels + std::max(dy, 0) * s->pitch + std::max(dx, 0);
+	if (dy > 0)
+	{
+		// going down, start from the bottom so no row is overwritten before it's moved
+		for (int y = h - 1; y >= 0; --y)
+		{
+			memmove(dest + y * s->pitch, src + y * s->pitch, w);
+		}
+	}
+	else
+	{
+		for (int y = 0; y < h; ++y)
+		{
+			memmove(dest + y * s->pitch, src + y * s->pitch, w);
+		}
+	}
+}
+
+/**
+ * Gets the terrain of a view level, as it looks from where the camera
+ * is now: the floors, walls, objects and items of all the tiles in view,
+ * without anything that moves. It's kept between frames, and only the
+ * tiles that changed are drawn again. When the camera scrolls a bit, the
+ * terrain is moved along and only the strips along the edges that come
+ * into view are drawn; after a jump or a level change it's drawn anew.
+ * @param level View level.
+ * @param surface The surface the map gets drawn on.
+ * @param changed The entries of the draw list that changed.
+ * @return Pointer to the terrain layer.
+ */
+Surface *Map::getTerrainLayer(int level, Surface *surface, const std::vector<int> &changed)
+{
+	Position offset = _camera->getMapOffset();
+	TerrainLayer &layer = _layers[level];
+	if (layer.surface && (layer.surface->getWidth() != surface->getWidth() || layer.surface->getHeight() != surface->getHeight()))
+	{
+		delete layer.surface;
+		layer.surface = 0;
+	}
+	if (!layer.surface)
+	{
+		layer.surface = new Surface(surface->getWidth(), surface->getHeight());
+		layer.valid = false;
+	}
+	Position shift = offset - layer.offset;
+	int width = layer.surface->getWidth(), height = layer.surface->getHeight();
+	layer.surface->lock();
+	if (!layer.valid || shift.z != 0 || abs(shift.x) >= width / 2 || abs(shift.y) >= height / 2 || (int)changed.size() > MAX_DIRTY_RECTS)
+	{
+		clearClip(layer.surface);
+		drawTerrainLayer(layer.surface, 0);
+	}
+	else
+	{
+		std::vector<SDL_Rect> areas;
+		if (shift.x != 0 || shift.y != 0)
+		{
+			Profiler::count("Map::scrollShifts");
+			shiftSurface(layer.surface, shift.x, shift.y);
+			SDL_Rect strip;
+			if (shift.x != 0)
+			{
+				strip.x = shift.x > 0 ? 0 : width + shift.x;
+				strip.y = 0;
+				strip.w = abs(shift.x);
+				strip.h = height;
+				areas.push_back(strip);
+			}
+			if (shift.y != 0)
+			{
+				strip.x = 0;
+				strip.y = shift.y > 0 ? 0 : height + shift.y;
+				strip.w = width;
+				strip.h = abs(shift.y);
+				areas.push_back(strip);
+			}
+		}
+		const std::vector<MapDrawList::Entry> &entries = _drawList->getEntries();
+		for (std::vector<int>::const_iterator i = changed.begin(); i != changed.end(); ++i)
+		{
+			areas.push_back(getTileArea(entries[*i]));
+		}
+		for (std::vector<SDL_Rect>::iterator i = areas.begin(); i != areas.end(); ++i)
+		{
+			SDL_SetClipRect(layer.surface->getSurface(), &(*i));
+			clearClip(layer.surface);
+			drawTerrainLayer(layer.surface, &(*i));
+		}
+		SDL_SetClipRect(layer.surface->getSurface(), 0);
+	}
+	layer.surface->unlock();
+	layer.offset = offset;
+	layer.valid = true;
+	return layer.surface;
+}
+
+/**
+ * Draws a terrain sprite from the draw list. Sprites are drawn from their
+ * spans when they have them, already shaded unless they're recolored.
+ * @param sprite The sprite.
+ * @param surface The surface to draw on, locked.
+ * @param x X position of the tile on the surface.
+ * @param y Y position of the tile on the surface.
+ */
+static void drawSprite(const MapDrawList::Sprite &sprite, Surface *surface, int x, int y)
+{
+	if (!sprite.set)
+		return;
+	SpanSprite *spans = sprite.color ? 0 : sprite.set->getShadedSpans(sprite.frame, sprite.shade);
+	if (spans)
+	{
+		spans->blitNShade(surface, x + sprite.x, y + sprite.y, 0, sprite.half);
+	}
+	else if ((spans = sprite.set->getSpans(sprite.frame)) != 0)
+	{
+		spans->blitNShade(surface, x + sprite.x, y + sprite.y, sprite.shade, sprite.half, sprite.color);
+	}
+	else
+	{
+		sprite.set->getFrame(sprite.frame)->blitNShade(surface, x + sprite.x, y + sprite.y, sprite.shade, sprite.half, sprite.color);
+	}
+}
+
+/**
+ * Draws the terrain of the tiles in view, without anything that moves.
+ * @param surface The surface to draw on, locked.
+ * @param clip Only tiles that show up in this area are drawn, or all if 0.
+ */
+void Map::drawTerrainLayer(Surface *surface, const SDL_Rect *clip)
+{
+	Profiler::Scope profile("Map::drawTerrainLayer");
+	const std::vector<MapDrawList::Entry> &entries = _drawList->getEntries();
+	for (std::vector<MapDrawList::Entry>::const_iterator i = entries.begin(); i != entries.end(); ++i)
+	{
+		if (clip && !overlaps(getTileArea(*i), *clip))
+			continue;
+		for (int part = 0; part < MapDrawList::PARTS; ++part)
+		{
+			drawSprite(i->parts[part], surface, i->x, i->y);
+		}
+	}
+}
+
 /**
 * Draw the terrain.
 * Keep this function as optimised as possible. It's big to minimise overhead of function calls.
+* The terrain sprites come from the draw list, everything that moves is drawn in between.
+* The terrain without anything that moves is kept per view level (see getTerrainLayer),
+* so only the areas around what moves are drawn again, tile by tile in the right order
+* and clipped to the area, on top of a copy of it.
 * @param surface The surface to draw on.
 */
 void Map::drawTerrain(Surface *surface)
 {
+	Profiler::Scope profile("Map::drawTerrain");
 	int frameNumber = 0;
 	Surface *tmpSurface;
 	Tile *tile;
-	int beginX = 0, endX = _save->getWidth() - 1;
-    int beginY = 0, endY = _save->getLength() - 1;
-	int beginZ = 0, endZ = _camera->getViewHeight();
 	Position mapPosition, screenPosition, bulletPositionScreen;
 	int bulletLowX=16000, bulletLowY=16000, bulletLowZ=16000, bulletHighX=0, bulletHighY=0, bulletHighZ=0;
-	int dummy;
 	BattleUnit *unit = 0;
 	bool invalid;
-	int tileShade, wallShade;
-	NumberText *_numWaypid = 0;
-
-	// get corner map coordinates to give rough boundaries in which tiles to redraw are
-	_camera->convertScreenToMap(0, 0, &beginX, &dummy);
-	_camera->convertScreenToMap(surface->getWidth(), 0, &dummy, &beginY);
-	_camera->convertScreenToMap(surface->getWidth(), surface->getHeight(), &endX, &dummy);
-	_camera->convertScreenToMap(0, surface->getHeight(), &dummy, &endY);
-	beginY -= (_camera->getViewHeight() * 2);
-	beginX -= (_camera->getViewHeight() * 2);
-	if (beginX < 0)
-		beginX = 0;
-	if (beginY < 0)
-		beginY = 0;
+	int tileShade;
 
 	// if we got bullet, get the highest x and y tiles to draw it on
 	if (_projectile && !_projectile->getItem())
@@ -249,346 +495,352 @@ void Map::drawTerrain(Surface *surface)
 		}
 	}
 
-	if (_waypoints.size() > 0)
+	TileGrid *grid = _save->getTileGrid();
+	bool tilesChanged = !grid->getDrawChanges().empty();
+	std::vector<int> changed;
+	_drawList->update(surface->getWidth(), surface->getHeight(), &changed);
+	const std::vector<MapDrawList::Entry> &entries = _drawList->getEntries();
+
+	// the terrain of the other levels is only kept while nothing changes
+	int level = _camera->getViewHeight();
+	for (int i = 0; i < (int)_layers.size(); ++i)
 	{
-		_numWaypid = new NumberText(15, 15, 20, 30);
-		_numWaypid->setPalette(getPalette());
-		_numWaypid->setColor(Palette::blockOffset(1));
+		if (tilesChanged && i != level)
+			_layers[i].valid = false;
 	}
+	Surface *layer = getTerrainLayer(level, surface, changed);
 
-	surface->lock();
+	// find the tiles with waypoints on them, in drawing order
+	std::vector<std::pair<int, int> > waypoints;
+	int waypid = 1;
+	for (std::vector<Position>::const_iterator i = _waypoints.begin(); i != _waypoints.end(); ++i, ++waypid)
+	{
+		int entry = _drawList->getEntry(_save->getTileIndex(*i));
+		if (entry != -1)
+		{
+			waypoints.push_back(std::make_pair(entry, waypid));
+		}
+	}
+	std::sort(waypoints.begin(), waypoints.end());
+	std::vector<std::pair<int, int> >::const_iterator waypoint = waypoints.begin();
 
-    for (int itZ = beginZ; itZ <= endZ; itZ++)
+	// only what moves is drawn again, with the terrain around it, on a copy of the terrain
+	_dirty.clear();
+	bool full = _fullRedraw || _projectile != 0;
+	for (int n = 0; n < (int)entries.size() && !full; ++n)
 	{
-        for (int itX = beginX; itX <= endX; itX++)
+		const MapDrawList::Entry &entry = entries[n];
+		tile = entry.tile;
+		mapPosition = tile->getPosition();
+		bool moving = tile->getUnit() != 0
+			|| ((tile->getFire() || tile->getSmoke()) && tile->isDiscovered(2))
+			|| (_cursorType != CT_NONE && _selectorX > mapPosition.x - _cursorSize && _selectorY > mapPosition.y - _cursorSize && _selectorX < mapPosition.x+1 && _selectorY < mapPosition.y+1);
+		if (!moving && mapPosition.z > 0 && entry.noFloor)
+		{
+			Tile *below = _save->getTile(mapPosition - Position(0, 0, 1));
+			moving = below && below->getUnit();
+		}
+		while (waypoint != waypoints.end() && waypoint->first < n)
+			++waypoint;
+		if (waypoint != waypoints.end() && waypoint->first == n)
+			moving = true;
+		if (moving)
 		{
-            for (int itY = beginY; itY <= endY; itY++)
+			SDL_Rect area = getTileArea(entry);
+			if (!_dirty.empty() && overlaps(_dirty.back(), area))
+			{
+				unite(&_dirty.back(), area);
+			}
+			else
 			{
-				mapPosition = Position(itX, itY, itZ);
-				_camera->convertMapToScreen(mapPosition, &screenPosition);
-				screenPosition += _camera->getMapOffset();
+				_dirty.push_back(area);
+				full = (int)_dirty.size() > MAX_DIRTY_RECTS;
+			}
+		}
+	}
 
-				// only render cells that are inside the surface
-				if (screenPosition.x > -_spriteWidth && screenPosition.x < surface->getWidth() + _spriteWidth &&
-					screenPosition.y > -_spriteHeight && screenPosition.y < surface->getHeight() + _spriteHeight )
-				{
-					tile = _save->getTile(mapPosition);
+	surface->lock();
 
-					if (!tile) continue;
+	if (full)
+	{
+		_dirty.assign(1, surface->getSurface()->clip_rect);
+	}
+	else
+	{
+		copyLayer(layer, surface);
+	}
+	for (std::vector<SDL_Rect>::iterator i = _dirty.begin(); i != _dirty.end(); ++i)
+	{
+		const SDL_Rect *clip = full ? 0 : &(*i);
+		if (clip)
+		{
+			SDL_SetClipRect(surface->getSurface(), clip);
+			clearClip(surface);
+		}
+		waypoint = waypoints.begin();
 
-					if (tile->isDiscovered(2))
+		for (int n = 0; n < (int)entries.size(); ++n)
+		{
+			const MapDrawList::Entry &entry = entries[n];
+			if (clip && !overlaps(getTileArea(entry), *clip))
+				continue;
+			tile = entry.tile;
+			mapPosition = tile->getPosition();
+			const int itX = mapPosition.x, itY = mapPosition.y, itZ = mapPosition.z;
+			screenPosition = Position(entry.x, entry.y, 0);
+			tileShade = entry.shade;
+
+			// Draw floor
+			drawSprite(entry.parts[MapDrawList::PART_FLOOR], surface, screenPosition.x, screenPosition.y);
+			unit = tile->getUnit();
+
+			// Draw cursor back
+			if (_cursorType != CT_NONE && _selectorX > itX - _cursorSize && _selectorY > itY - _cursorSize && _selectorX < itX+1 && _selectorY < itY+1)
+			{
+				if (_camera->getViewHeight() == itZ)
+				{
+					if (_cursorType != CT_AIM)
 					{
-						tileShade = tile->getShade();
-					}
-					else
+						if (unit && (unit->getVisible() || _save->getDebugMode()))
+							frameNumber = (_animFrame % 2); // yellow box
+						else
+							frameNumber = 0; // red box
+					}else
 					{
-						tileShade = 16;
-						unit = 0;
+						if (unit)
+							frameNumber = 7 + (_animFrame / 2); // yellow animated crosshairs
+						else
+							frameNumber = 6; // red static crosshairs
 					}
+				}
+				else if (_camera->getViewHeight() > itZ)
+				{
+					frameNumber = 2; // blue box
+				}
+				tmpSurface = _cursorSprites->getFrame(frameNumber);
+				tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
+			}
 
-					// Draw floor
-					tmpSurface = tile->getSprite(MapData::O_FLOOR);
-					if (tmpSurface)
-						tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_FLOOR)->getYOffset(), tileShade, false, tile->getMarkerColor());
-					unit = tile->getUnit();
+			// Draw walls, object and the item on top of the floor (if any)
+			for (int part = MapDrawList::PART_WESTWALL; part < MapDrawList::PARTS; ++part)
+			{
+				drawSprite(entry.parts[part], surface, screenPosition.x, screenPosition.y);
+			}
+
+			// check if we got bullet
+			if (_projectile)
+			{
+				tmpSurface = 0;
+				if (_projectile->getItem())
+				{
+					tmpSurface = _projectile->getSprite();
 
-					// Draw cursor back
-					if (_cursorType != CT_NONE && _selectorX > itX - _cursorSize && _selectorY > itY - _cursorSize && _selectorX < itX+1 && _selectorY < itY+1)
+					if (itZ == 0)
 					{
-						if (_camera->getViewHeight() == itZ)
+						// draw shadow on the floor
+						Position voxelPos = _projectile->getPosition();
+						voxelPos.z = 0;
+						if (voxelPos.x / 16 >= mapPosition.x-1 &&
+							voxelPos.y / 16 >= mapPosition.y-1 &&
+							voxelPos.x / 16 <= mapPosition.x+1 &&
+							voxelPos.y / 16 <= mapPosition.y+1 )
 						{
-							if (_cursorType != CT_AIM)
-							{
-								if (unit && (unit->getVisible() || _save->getDebugMode()))
-									frameNumber = (_animFrame % 2); // yellow box
-								else
-									frameNumber = 0; // red box
-							}else
-							{
-								if (unit)
-									frameNumber = 7 + (_animFrame / 2); // yellow animated crosshairs
-								else
-									frameNumber = 6; // red static crosshairs
-							}
+							_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+							tmpSurface->blitNShade(surface, bulletPositionScreen.x - 16, bulletPositionScreen.y - 26, 15);
 						}
-						else if (_camera->getViewHeight() > itZ)
-						{
-							frameNumber = 2; // blue box
-						}
-						tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
-						tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
 					}
 
-					// Draw walls
-					if (!tile->isVoid())
+					Position voxelPos = _projectile->getPosition();
+					if (voxelPos.x / 16 == mapPosition.x &&
+						voxelPos.y / 16 == mapPosition.y )
 					{
-						// Draw west wall
-						tmpSurface = tile->getSprite(MapData::O_WESTWALL);
-						if (tmpSurface)
-						{
-							if ((tile->getMapData(MapData::O_WESTWALL)->isDoor() || tile->getMapData(MapData::O_WESTWALL)->isUFODoor())
-								 && (tile->isDiscovered(0) || tile->isDiscovered(1)))
-								wallShade = 0;
-							else
-								wallShade = tileShade;
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_WESTWALL)->getYOffset(), wallShade);
-						}
-						// Draw north wall
-						tmpSurface = tile->getSprite(MapData::O_NORTHWALL);
-						if (tmpSurface)
-						{
-							if ((tile->getMapData(MapData::O_NORTHWALL)->isDoor() || tile->getMapData(MapData::O_NORTHWALL)->isUFODoor())
-								 && (tile->isDiscovered(0) || tile->isDiscovered(1)))
-								wallShade = 0;
-							else
-								wallShade = tileShade;
-							if (tile->getMapData(MapData::O_WESTWALL))
-							{
-								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_NORTHWALL)->getYOffset(), wallShade, true);
-							}
-							else
-							{
-								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_NORTHWALL)->getYOffset(), wallShade);
-							}
-						}
-						// Draw object
-						if (tile->getMapData(MapData::O_OBJECT))
-						{
-							tmpSurface = tile->getSprite(MapData::O_OBJECT);
-							if (tmpSurface)
-								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_OBJECT)->getYOffset(), tileShade);
-						}
-						// draw an item on top of the floor (if any)
-						int sprite = tile->getTopItemSprite();
-						if (sprite != -1)
-						{
-							tmpSurface = _res->getSurfaceSet("FLOOROB.PCK")->getFrame(sprite);
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y + tile->getTerrainLevel(), tileShade);
-						}
-						
+						_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+						tmpSurface->blitNShade(surface, bulletPositionScreen.x - 16, bulletPositionScreen.y - 26, 0);
 					}
-
-					// check if we got bullet
-					if (_projectile)
+				}
+				else
+				{
+					// draw bullet on the correct tile
+					if (itX >= bulletLowX && itX <= bulletHighX && itY >= bulletLowY && itY <= bulletHighY)
 					{
-						tmpSurface = 0;
-						if (_projectile->getItem())
+						if (itZ == 0)
 						{
-							tmpSurface = _projectile->getSprite();
-
-							if (itZ == 0)
+							// draw shadow on the floor
+							for (int i = 1; i <= _projectile->getParticle(0); ++i)
 							{
-								// draw shadow on the floor
-								Position voxelPos = _projectile->getPosition();
-								voxelPos.z = 0;
-								if (voxelPos.x / 16 >= mapPosition.x-1 &&
-									voxelPos.y / 16 >= mapPosition.y-1 &&
-									voxelPos.x / 16 <= mapPosition.x+1 &&
-									voxelPos.y / 16 <= mapPosition.y+1 )
+								if (_projectile->getParticle(i) != 0xFF)
 								{
-									_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-									tmpSurface->blitNShade(surface, bulletPositionScreen.x - 16, bulletPositionScreen.y - 26, 15);
+									Position voxelPos = _projectile->getPosition(1-i);
+									voxelPos.z = 0;
+									if (voxelPos.x / 16 == mapPosition.x &&
+										voxelPos.y / 16 == mapPosition.y)
+									{
+										_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+										_bullet[_projectile->getParticle(i)]->blitNShade(surface, bulletPositionScreen.x, bulletPositionScreen.y, 15);
+									}
 								}
 							}
-
-							Position voxelPos = _projectile->getPosition();
-							if (voxelPos.x / 16 == mapPosition.x &&
-								voxelPos.y / 16 == mapPosition.y )
-							{
-								_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-								tmpSurface->blitNShade(surface, bulletPositionScreen.x - 16, bulletPositionScreen.y - 26, 0);
-							}
 						}
-						else
+						for (int i = 1; i <= _projectile->getParticle(0); ++i)
 						{
-							// draw bullet on the correct tile
-							if (itX >= bulletLowX && itX <= bulletHighX && itY >= bulletLowY && itY <= bulletHighY)
+							if (_projectile->getParticle(i) != 0xFF)
 							{
-								if (itZ == 0)
+								Position voxelPos = _projectile->getPosition(1-i);
+								if (voxelPos.x / 16 == mapPosition.x &&
+									voxelPos.y / 16 == mapPosition.y)
 								{
-									// draw shadow on the floor
-									for (int i = 1; i <= _projectile->getParticle(0); ++i)
-									{
-										if (_projectile->getParticle(i) != 0xFF)
-										{
-											Position voxelPos = _projectile->getPosition(1-i);
-											voxelPos.z = 0;
-											if (voxelPos.x / 16 == mapPosition.x &&
-												voxelPos.y / 16 == mapPosition.y)
-											{
-												_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-												_bullet[_projectile->getParticle(i)]->blitNShade(surface, bulletPositionScreen.x, bulletPositionScreen.y, 15);
-											}
-										}
-									}
-								}
-								for (int i = 1; i <= _projectile->getParticle(0); ++i)
-								{
-									if (_projectile->getParticle(i) != 0xFF)
-									{
-										Position voxelPos = _projectile->getPosition(1-i);
-										if (voxelPos.x / 16 == mapPosition.x &&
-											voxelPos.y / 16 == mapPosition.y)
-										{
-											_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-											_bullet[_projectile->getParticle(i)]->blitNShade(surface, bulletPositionScreen.x, bulletPositionScreen.y, 0);
-										}
-									}
+									_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+									_bullet[_projectile->getParticle(i)]->blitNShade(surface, bulletPositionScreen.x, bulletPositionScreen.y, 0);
 								}
 							}
 						}
 					}
+				}
+			}
 
-			        unit = tile->getUnit();
-					// Draw soldier
-					if (unit && (unit->getVisible() || _save->getDebugMode()))
+			unit = tile->getUnit();
+			// Draw soldier
+			if (unit && (unit->getVisible() || _save->getDebugMode()))
+			{
+				// the part is 0 for small units, large units have parts 1,2 & 3 depending on the relative x/y position of this tile vs the actual unit position.
+				int part = 0;
+				part += tile->getPosition().x - unit->getPosition().x;
+				part += (tile->getPosition().y - unit->getPosition().y)*2;
+				tmpSurface = unit->getCache(&invalid, part);
+				if (tmpSurface)
+				{
+					Position offset;
+					calculateWalkingOffset(unit, &offset);
+					tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, tileShade);
+					if (unit->getArmor()->getSize() > 1)
 					{
-						// the part is 0 for small units, large units have parts 1,2 & 3 depending on the relative x/y position of this tile vs the actual unit position.
-						int part = 0;
-						part += tile->getPosition().x - unit->getPosition().x;
-						part += (tile->getPosition().y - unit->getPosition().y)*2;
-						tmpSurface = unit->getCache(&invalid, part);
-						if (tmpSurface)
-						{
-							Position offset;
-							calculateWalkingOffset(unit, &offset);
-							tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, tileShade);
-							if (unit->getArmor()->getSize() > 1)
-							{
-								offset.y += 4;
-							}
-							if (unit == (BattleUnit*)_save->getSelectedUnit() && _save->getSide() == FACTION_PLAYER && part == 0)
-							{
-								_arrow->blitNShade(surface, screenPosition.x + offset.x + (_spriteWidth / 2) - (_arrow->getWidth() / 2), screenPosition.y + offset.y - _arrow->getHeight() + _animFrame, 0);
-							}
-							if (unit->getFire() > 0)
-							{
-								frameNumber = 4 + (_animFrame / 2);
-								tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
-								tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, 0);
-							}
-						}
+						offset.y += 4;
 					}
-					// if we can see through the floor, draw the soldier below it if it is on stairs
-					if (itZ > 0 && tile->hasNoFloor())
+					if (unit == (BattleUnit*)_save->getSelectedUnit() && _save->getSide() == FACTION_PLAYER && part == 0)
 					{
-						BattleUnit *tunit = _save->selectUnit(Position(itX, itY, itZ-1));
-						Tile *ttile = _save->getTile(Position(itX, itY, itZ-1));
-						if (tunit && ttile->getTerrainLevel() < 0 && ttile->isDiscovered(2))
-						{
-							// the part is 0 for small units, large units have parts 1,2 & 3 depending on the relative x/y position of this tile vs the actual unit position.
-							int part = 0;
-							part += ttile->getPosition().x - tunit->getPosition().x;
-							part += (ttile->getPosition().y - tunit->getPosition().y)*2;
-							tmpSurface = tunit->getCache(&invalid, part);
-							if (tmpSurface)
-							{
-								Position offset;
-								calculateWalkingOffset(tunit, &offset);
-								offset.y += 24;
-								tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, tileShade);
-								if (tunit->getArmor()->getSize() > 1)
-								{
-									offset.y += 4;
-								}
-								if (tunit == (BattleUnit*)_save->getSelectedUnit() && _save->getSide() == FACTION_PLAYER && part == 0)
-								{
-									_arrow->blitNShade(surface, screenPosition.x + offset.x + (_spriteWidth / 2) - (_arrow->getWidth() / 2), screenPosition.y + offset.y - _arrow->getHeight() + _animFrame, 0);
-								}
-								if (tunit->getFire() > 0)
-								{
-									frameNumber = 4 + (_animFrame / 2);
-									tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
-									tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, 0);
-								}
-							}
-						}
+						_arrow->blitNShade(surface, screenPosition.x + offset.x + (_spriteWidth / 2) - (_arrow->getWidth() / 2), screenPosition.y + offset.y - _arrow->getHeight() + _animFrame, 0);
 					}
-
-					// Draw cursor front
-					if (_cursorType != CT_NONE && _selectorX > itX - _cursorSize && _selectorY > itY - _cursorSize && _selectorX < itX+1 && _selectorY < itY+1)
+					if (unit->getFire() > 0)
 					{
-						if (_camera->getViewHeight() == itZ)
-						{
-							if (_cursorType != CT_AIM)
-							{
-								if (unit && (unit->getVisible() || _save->getDebugMode()))
-									frameNumber = 3 + (_animFrame % 2); // yellow box
-								else
-									frameNumber = 3; // red box
-							}else
-							{
-								if (unit)
-									frameNumber = 7 + (_animFrame / 2); // yellow animated crosshairs
-								else
-									frameNumber = 6; // red static crosshairs
-							}
-						}
-						else if (_camera->getViewHeight() > itZ)
+						frameNumber = 4 + (_animFrame / 2);
+						tmpSurface = _smokeSprites->getFrame(frameNumber);
+						tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, 0);
+					}
+				}
+			}
+			// if we can see through the floor, draw the soldier below it if it is on stairs
+			if (itZ > 0 && entry.noFloor)
+			{
+				BattleUnit *tunit = _save->selectUnit(Position(itX, itY, itZ-1));
+				Tile *ttile = _save->getTile(Position(itX, itY, itZ-1));
+				if (tunit && ttile->getTerrainLevel() < 0 && ttile->isDiscovered(2))
+				{
+					// the part is 0 for small units, large units have parts 1,2 & 3 depending on the relative x/y position of this tile vs the actual unit position.
+					int part = 0;
+					part += ttile->getPosition().x - tunit->getPosition().x;
+					part += (ttile->getPosition().y - tunit->getPosition().y)*2;
+					tmpSurface = tunit->getCache(&invalid, part);
+					if (tmpSurface)
+					{
+						Position offset;
+						calculateWalkingOffset(tunit, &offset);
+						offset.y += 24;
+						tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, tileShade);
+						if (tunit->getArmor()->getSize() > 1)
 						{
-							frameNumber = 5; // blue box
+							offset.y += 4;
 						}
-						tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
-						tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
-						if (_cursorType > 2 && _camera->getViewHeight() == itZ)
+						if (tunit == (BattleUnit*)_save->getSelectedUnit() && _save->getSide() == FACTION_PLAYER && part == 0)
 						{
-							int frame[6] = {0, 0, 0, 11, 13, 15};
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frame[_cursorType] + (_animFrame / 4));
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
+							_arrow->blitNShade(surface, screenPosition.x + offset.x + (_spriteWidth / 2) - (_arrow->getWidth() / 2), screenPosition.y + offset.y - _arrow->getHeight() + _animFrame, 0);
 						}
-					}
-
-					// Draw waypoints if any on this tile
-					int waypid = 1;
-					for (std::vector<Position>::const_iterator i = _waypoints.begin(); i != _waypoints.end(); ++i)
-					{
-						if ((*i) == mapPosition)
+						if (tunit->getFire() > 0)
 						{
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(7);
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
-							_numWaypid->setValue(waypid);
-							_numWaypid->draw();
-							_numWaypid->blitNShade(surface, screenPosition.x+2, screenPosition.y+2, 0);
+							frameNumber = 4 + (_animFrame / 2);
+							tmpSurface = _smokeSprites->getFrame(frameNumber);
+							tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, 0);
 						}
-						waypid++;
 					}
+				}
+			}
 
-
-					// Draw smoke/fire
-					if (tile->getFire() && tile->isDiscovered(2))
+			// Draw cursor front
+			if (_cursorType != CT_NONE && _selectorX > itX - _cursorSize && _selectorY > itY - _cursorSize && _selectorX < itX+1 && _selectorY < itY+1)
+			{
+				if (_camera->getViewHeight() == itZ)
+				{
+					if (_cursorType != CT_AIM)
 					{
-						frameNumber = 0; // see http://www.ufopaedia.org/images/c/cb/Smoke.gif
-						if ((_animFrame / 2) + tile->getAnimationOffset() > 3)
-						{
-							frameNumber += ((_animFrame / 2) + tile->getAnimationOffset() - 4);
-						}
+						if (unit && (unit->getVisible() || _save->getDebugMode()))
+							frameNumber = 3 + (_animFrame % 2); // yellow box
 						else
-						{
-							frameNumber += (_animFrame / 2) + tile->getAnimationOffset();
-						}
-						tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
-						tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
-					}
-					if (tile->getSmoke() && tile->isDiscovered(2))
+							frameNumber = 3; // red box
+					}else
 					{
-						frameNumber = 8 + int(floor((tile->getSmoke() / 5.0) - 0.1)); // see http://www.ufopaedia.org/images/c/cb/Smoke.gif
-						if ((_animFrame / 2) + tile->getAnimationOffset() > 3)
-						{
-							frameNumber += ((_animFrame / 2) + tile->getAnimationOffset() - 4);
-						}
+						if (unit)
+							frameNumber = 7 + (_animFrame / 2); // yellow animated crosshairs
 						else
-						{
-							frameNumber += (_animFrame / 2) + tile->getAnimationOffset();
-						}
-						tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
-						tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
+							frameNumber = 6; // red static crosshairs
 					}
 				}
+				else if (_camera->getViewHeight() > itZ)
+				{
+					frameNumber = 5; // blue box
+				}
+				tmpSurface = _cursorSprites->getFrame(frameNumber);
+				tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
+				if (_cursorType > 2 && _camera->getViewHeight() == itZ)
+				{
+					int frame[6] = {0, 0, 0, 11, 13, 15};
+					tmpSurface = _cursorSprites->getFrame(frame[_cursorType] + (_animFrame / 4));
+					tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
+				}
+			}
+
+			// Draw waypoints if any on this tile
+			while (waypoint != waypoints.end() && waypoint->first < n)
+				++waypoint;
+			for (; waypoint != waypoints.end() && waypoint->first == n; ++waypoint)
+			{
+				tmpSurface = _cursorSprites->getFrame(7);
+				tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
+				_waypointNumber->setValue(waypoint->second);
+				_waypointNumber->draw();
+				_waypointNumber->blitNShade(surface, screenPosition.x+2, screenPosition.y+2, 0);
+			}
+
+			// Draw smoke/fire
+			if (tile->getFire() && tile->isDiscovered(2))
+			{
+				frameNumber = 0; // see http://www.ufopaedia.org/images/c/cb/Smoke.gif
+				if ((_animFrame / 2) + tile->getAnimationOffset() > 3)
+				{
+					frameNumber += ((_animFrame / 2) + tile->getAnimationOffset() - 4);
+				}
+				else
+				{
+					frameNumber += (_animFrame / 2) + tile->getAnimationOffset();
+				}
+				tmpSurface = _smokeSprites->getFrame(frameNumber);
+				tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
+			}
+			if (tile->getSmoke() && tile->isDiscovered(2))
+			{
+				frameNumber = 8 + int(floor((tile->getSmoke() / 5.0) - 0.1)); // see http://www.ufopaedia.org/images/c/cb/Smoke.gif
+				if ((_animFrame / 2) + tile->getAnimationOffset() > 3)
+				{
+					frameNumber += ((_animFrame / 2) + tile->getAnimationOffset() - 4);
+				}
+				else
+				{
+					frameNumber += (_animFrame / 2) + tile->getAnimationOffset();
+				}
+				tmpSurface = _smokeSprites->getFrame(frameNumber);
+				tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
 			}
 		}
 	}
-
-	delete _numWaypid;
+	SDL_SetClipRect(surface->getSurface(), 0);
 
 	// check if we got big explosions
 	for (std::set<Explosion*>::const_iterator i = _explosions.begin(); i != _explosions.end(); ++i)
@@ -597,7 +849,7 @@ void Map::drawTerrain(Surface *surface)
 		{
 			Position voxelPos = (*i)->getPosition();
 			_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-			tmpSurface = _res->getSurfaceSet("X1.PCK")->getFrame((*i)->getCurrentFrame());
+			tmpSurface = _explosionSprites->getFrame((*i)->getCurrentFrame());
 			tmpSurface->blitNShade(surface, bulletPositionScreen.x - 64, bulletPositionScreen.y - 64, 0);
 			// if the projectile is outside the viewport - center it back on it
 			if (bulletPositionScreen.x < -_spriteWidth || bulletPositionScreen.x > surface->getWidth() ||
@@ -610,12 +862,14 @@ void Map::drawTerrain(Surface *surface)
 		{
 			Position voxelPos = (*i)->getPosition();
 			_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-			tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame((*i)->getCurrentFrame());
+			tmpSurface = _smokeSprites->getFrame((*i)->getCurrentFrame());
 			tmpSurface->blitNShade(surface, bulletPositionScreen.x - 15, bulletPositionScreen.y - 15, 0);
 		}
 	}
 
 	surface->unlock();
+	Profiler::count("Map::tilesDrawn", entries.size());
+	Profiler::count("Map::dirtyAreas", full ? 0 : _dirty.size());
 }
 
 /**
@@ -682,10 +936,11 @@ void Map::animate(bool redraw)
 	_animFrame++;
 	if (_animFrame == 8) _animFrame = 0;
 
-	// animate tiles
-	for (int i = 0; i < _save->getWidth()*_save->getHeight()*_save->getLength(); ++i)
+	// animate tiles, only the ones with something moving
+	const std::vector<int> &animated = _save->getTileGrid()->getActive(TileGrid::ACTIVE_ANIMATED);
+	for (std::vector<int>::const_iterator i = animated.begin(); i != animated.end(); ++i)
 	{
-		_save->getTiles()[i]->animate();
+		_save->getTiles()[*i]->animate();
 	}
 
 	// animate certain units (large flying units have a propultion animation)
@@ -857,12 +1112,12 @@ void Map::cacheUnits()
 
 /**
  * Check if a certain unit needs to be redrawn.
+ * Units that look the same share their frames (see UnitSpriteCache),
+ * so a frame is only composited when no unit looked like that before.
  * @param unit Pointer to battleUnit
  */
 void Map::cacheUnit(BattleUnit *unit)
 {
-	UnitSprite *unitSprite = new UnitSprite(_spriteWidth, _spriteHeight, 0, 0);
-	unitSprite->setPalette(this->getPalette());
 	bool invalid, dummy;
 	int numOfParts = unit->getArmor()->getSize() == 1?1:4;
 
@@ -872,31 +1127,15 @@ void Map::cacheUnit(BattleUnit *unit)
 		// 1 or 4 iterations, depending on unit size
 		for (int i = 0; i < numOfParts; i++)
 		{
-			Surface *cache = unit->getCache(&dummy, i);
-			if (!cache) // no cache created yet
+			Surface *cache = _unitSprites->getFrame(unit, i, _animFrame);
+			Surface *old = unit->getCache(&dummy, i);
+			if (old)
 			{
-				cache = new Surface(_spriteWidth, _spriteHeight);
-				cache->setPalette(this->getPalette());
+				_unitSprites->release(old);
 			}
-			unitSprite->setBattleUnit(unit, i);
-			BattleItem *handItem = unit->getItem("STR_RIGHT_HAND");
-			if (handItem)
-			{
-				unitSprite->setBattleItem(handItem);
-			}
-			else
-			{
-				unitSprite->setBattleItem(0);
-			}
-			unitSprite->setSurfaces(_res->getSurfaceSet(unit->getArmor()->getSpriteSheet()),
-									_res->getSurfaceSet("HANDOB.PCK"));
-			unitSprite->setAnimationFrame(_animFrame);
-			cache->clear();
-			unitSprite->blit(cache);
 			unit->setCache(cache, i);
 		}
-	}	
-	delete unitSprite;
+	}
 }
 
 /**
@@ -952,4 +1191,25 @@ std::vector<Position> *Map::getWaypoints()
 	return &_waypoints;
 }
 
+/**
+ * Sets whether every frame is drawn in full, tile by tile, instead of
+ * on a copy of the terrain layer. The terrain layers are still kept up
+ * to date either way. Used to check the terrain layers against.
+ * @param full Draw every frame in full?
+ */
+void Map::setFullRedraw(bool full)
+{
+	_fullRedraw = full;
+}
+
+/**
+ * Gets the terrain of the view level, as drawn from the draw list
+ * for the last frame. Used to check the draw list against.
+ * @return Pointer to the terrain layer, or 0 if nothing was drawn yet.
+ */
+Surface *Map::getTerrain() const
+{
+	return _layers[_camera->getViewHeight()].surface;
+}
+
 }
@@ -20,6 +20,7 @@
 #define OPENXCOM_MAP_H
 
 #include "../Engine/InteractiveSurface.h"
+#include "Position.h"
 #include <set>
 #include <vector>
 
@@ -30,7 +31,6 @@ class ResourcePack;
 class SavedBattleGame;
 class Surface;
 class MapData;
-class Position;
 class Tile;
 class BattleUnit;
 class BulletSprite;
@@ -39,6 +39,10 @@ class Explosion;
 class BattlescapeMessage;
 class Camera;
 class Timer;
+class SurfaceSet;
+class NumberText;
+class MapDrawList;
+class UnitSpriteCache;
 
 enum CursorType { CT_NONE, CT_NORMAL, CT_AIM, CT_PSI, CT_WAYPOINT, CT_THROW };
 
@@ -49,6 +53,15 @@ class Map : public InteractiveSurface
 {
 private:
 	static const int SCROLL_INTERVAL = 50;
+	static const int MAX_DIRTY_RECTS = 64;
+	/// The terrain of a view level, drawn beforehand.
+	struct TerrainLayer
+	{
+		Surface *surface;
+		Position offset;
+		bool valid;
+		TerrainLayer() : surface(0), offset(), valid(false) {};
+	};
 	Timer *_scrollTimer;
 	Game *_game;
 	SavedBattleGame *_save;
@@ -65,7 +78,16 @@ private:
 	BattlescapeMessage *_message;
 	Camera *_camera;
 	int _visibleMapHeight;
+	SurfaceSet *_cursorSprites, *_smokeSprites, *_explosionSprites;
+	NumberText *_waypointNumber;
+	MapDrawList *_drawList;
+	UnitSpriteCache *_unitSprites;
+	std::vector<TerrainLayer> _layers;
+	std::vector<SDL_Rect> _dirty;
+	bool _fullRedraw;
 	void drawTerrain(Surface *surface);
+	Surface *getTerrainLayer(int level, Surface *surface, const std::vector<int> &changed);
+	void drawTerrainLayer(Surface *surface, const SDL_Rect *clip);
 	int getTerrainLevel(Position pos, int size);
 	std::vector<Position> _waypoints;
 public:
@@ -114,6 +136,10 @@ public:
 	void scroll();
 	/// Get waypoints vector
 	std::vector<Position> *getWaypoints();
+	/// Sets whether every frame is drawn in full.
+	void setFullRedraw(bool full);
+	/// Gets the terrain of the view level.
+	Surface *getTerrain() const;
 
 };
 
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MapDrawList.h"
+#include <algorithm>
+#include "Camera.h"
+#include "../Engine/SurfaceSet.h"
+#include "../Engine/Profiler.h"
+#include "../Savegame/SavedBattleGame.h"
+#include "../Savegame/Tile.h"
+#include "../Savegame/TileGrid.h"
+#include "../Ruleset/MapData.h"
+#include "../Ruleset/MapDataSet.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Points a sprite at the current frame of a tile part, in its surface set.
+ * @param sprite The sprite.
+ * @param tile The tile.
+ * @param part The tile part.
+ */
+static void setSprite(MapDrawList::Sprite *sprite, Tile *tile, int part)
+{
+	int frame = tile->getSpriteFrame(part);
+	if (frame == -1)
+		return;
+	sprite->set = tile->getMapData(part)->getDataset()->getSurfaceset();
+	sprite->frame = frame;
+}
+
+/**
+ * Sets up an empty draw list, which gets built on the first update.
+ * @param save Pointer to the battle.
+ * @param camera Pointer to the map's camera.
+ * @param floorItems Sprites of items lying on the ground.
+ * @param spriteWidth Width of a tile sprite.
+ * @param spriteHeight Height of a tile sprite.
+ */
+MapDrawList::MapDrawList(SavedBattleGame *save, Camera *camera, SurfaceSet *floorItems, int spriteWidth, int spriteHeight) : _save(save), _camera(camera), _floorItems(floorItems), _spriteWidth(spriteWidth), _spriteHeight(spriteHeight), _entries(), _entryOf(), _offset(), _width(0), _height(0), _valid(false)
+{
+	_entryOf.assign(_save->getTileGrid()->getSize(), -1);
+}
+
+/**
+ * Deletes the draw list.
+ */
+MapDrawList::~MapDrawList()
+{
+
+}
+
+/**
+ * Works out the terrain sprites of a tile and how they're shaded.
+ * Doors are never shaded once seen, and the north wall is drawn
+ * half when there's a west wall on the same tile.
+ * @param entry Pointer to the entry of the tile.
+ */
+void MapDrawList::build(Entry *entry) const
+{
+	Tile *tile = entry->tile;
+	int tileShade = tile->isDiscovered(2) ? tile->getShade() : 16;
+	entry->shade = tileShade;
+	entry->noFloor = tile->hasNoFloor();
+	for (int i = 0; i < PARTS; ++i)
+	{
+		entry->parts[i].set = 0;
+		entry->parts[i].frame = -1;
+		entry->parts[i].x = 0;
+		entry->parts[i].y = 0;
+		entry->parts[i].shade = tileShade;
+		entry->parts[i].color = 0;
+		entry->parts[i].half = false;
+	}
+
+	Sprite *floor = &entry->parts[PART_FLOOR];
+	setSprite(floor, tile, MapData::O_FLOOR);
+	if (floor->set)
+	{
+		floor->y = -tile->getMapData(MapData::O_FLOOR)->getYOffset();
+		floor->color = tile->getMarkerColor();
+	}
+
+	if (tile->isVoid())
+		return;
+
+	const int walls[2] = { MapData::O_WESTWALL, MapData::O_NORTHWALL };
+	for (int i = 0; i < 2; ++i)
+	{
+		Sprite *wall = &entry->parts[PART_WESTWALL + i];
+		setSprite(wall, tile, walls[i]);
+		if (wall->set)
+		{
+			MapData *data = tile->getMapData(walls[i]);
+			wall->y = -data->getYOffset();
+			if ((data->isDoor() || data->isUFODoor()) && (tile->isDiscovered(0) || tile->isDiscovered(1)))
+				wall->shade = 0;
+			wall->half = (walls[i] == MapData::O_NORTHWALL && tile->getMapData(MapData::O_WESTWALL));
+		}
+	}
+
+	Sprite *object = &entry->parts[PART_OBJECT];
+	setSprite(object, tile, MapData::O_OBJECT);
+	if (object->set)
+	{
+		object->y = -tile->getMapData(MapData::O_OBJECT)->getYOffset();
+	}
+
+	int sprite = tile->getTopItemSprite();
+	if (sprite != -1)
+	{
+		Sprite *item = &entry->parts[PART_ITEM];
+		item->set = _floorItems;
+		item->frame = sprite;
+		item->y = tile->getTerrainLevel();
+	}
+}
+
+/**
+ * Builds the list of all tiles that show up on the map, in the
+ * order they're drawn: bottom level first, and back to front.
+ */
+void MapDrawList::rebuild()
+{
+	Profiler::Scope profile("MapDrawList::rebuild");
+	int beginX = 0, endX = _save->getWidth() - 1;
+	int beginY = 0, endY = _save->getLength() - 1;
+	int beginZ = 0, endZ = _camera->getViewHeight();
+	int dummy;
+	Position mapPosition, screenPosition;
+
+	for (std::vector<Entry>::const_iterator i = _entries.begin(); i != _entries.end(); ++i)
+	{
+		_entryOf[_save->getTileIndex(i->tile->getPosition())] = -1;
+	}
+	_entries.clear();
+
+	// get corner map coordinates to give rough boundaries in which tiles to redraw are
+	_camera->convertScreenToMap(0, 0, &beginX, &dummy);
+	_camera->convertScreenToMap(_width, 0, &dummy, &beginY);
+	_camera->convertScreenToMap(_width, _height, &endX, &dummy);
+	_camera->convertScreenToMap(0, _height, &dummy, &endY);
+	beginY -= (_camera->getViewHeight() * 2);
+	beginX -= (_camera->getViewHeight() * 2);
+	beginX = std::max(beginX, 0);
+	beginY = std::max(beginY, 0);
+	endX = std::min(endX, _save->getWidth() - 1);
+	endY = std::min(endY, _save->getLength() - 1);
+
+	for (int itZ = beginZ; itZ <= endZ; itZ++)
+	{
+		for (int itX = beginX; itX <= endX; itX++)
+		{
+			for (int itY = beginY; itY <= endY; itY++)
+			{
+				mapPosition = Position(itX, itY, itZ);
+				_camera->convertMapToScreen(mapPosition, &screenPosition);
+				screenPosition += _offset;
+
+				// only keep cells that are inside the surface
+				if (screenPosition.x > -_spriteWidth && screenPosition.x < _width + _spriteWidth &&
+					screenPosition.y > -_spriteHeight && screenPosition.y < _height + _spriteHeight)
+				{
+					Tile *tile = _save->getTile(mapPosition);
+					if (!tile) continue;
+
+					Entry entry;
+					entry.tile = tile;
+					entry.x = screenPosition.x;
+					entry.y = screenPosition.y;
+					build(&entry);
+					_entryOf[_save->getTileIndex(mapPosition)] = _entries.size();
+					_entries.push_back(entry);
+				}
+			}
+		}
+	}
+	_valid = true;
+}
+
+/**
+ * Brings the list up to date with the camera and the tiles. If the camera
+ * moved or the map got resized the whole list is built again, otherwise
+ * only the tiles in view that changed are. Either way the tiles in view
+ * that changed are passed back, for anything drawn from an older list.
+ * @param width Width of the map surface.
+ * @param height Height of the map surface.
+ * @param changed Pointer to a list to add the entries that changed to.
+ * @return True if the whole list was built again.
+ */
+bool MapDrawList::update(int width, int height, std::vector<int> *changed)
+{
+	TileGrid *grid = _save->getTileGrid();
+	Position offset = _camera->getMapOffset();
+	bool rebuilt = false;
+	if (!_valid || offset != _offset || width != _width || height != _height)
+	{
+		_offset = offset;
+		_width = width;
+		_height = height;
+		rebuild();
+		rebuilt = true;
+	}
+
+	const std::vector<int> &changes = grid->getDrawChanges();
+	for (std::vector<int>::const_iterator i = changes.begin(); i != changes.end(); ++i)
+	{
+		if (_entryOf[*i] != -1)
+		{
+			if (!rebuilt)
+				build(&_entries[_entryOf[*i]]);
+			changed->push_back(_entryOf[*i]);
+		}
+	}
+	grid->clearDrawChanges();
+	return rebuilt;
+}
+
+/**
+ * Makes the whole list get built again on the next update,
+ * for changes that aren't tracked by the tiles.
+ */
+void MapDrawList::invalidate()
+{
+	_valid = false;
+}
+
+/**
+ * Gets the tiles in view, in the order they're drawn.
+ * @return List of entries.
+ */
+const std::vector<MapDrawList::Entry> &MapDrawList::getEntries() const
+{
+	return _entries;
+}
+
+/**
+ * Gets where a tile is in the list.
+ * @param index Tile index.
+ * @return Index of the entry, or -1 if the tile is out of view.
+ */
+int MapDrawList::getEntry(int index) const
+{
+	if (index < 0 || index >= (int)_entryOf.size())
+		return -1;
+	return _entryOf[index];
+}
+
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_MAPDRAWLIST_H
+#define OPENXCOM_MAPDRAWLIST_H
+
+#include <vector>
+#include <SDL.h>
+#include "Position.h"
+
+namespace OpenXcom
+{
+
+class SurfaceSet;
+class SavedBattleGame;
+class Camera;
+class Tile;
+
+/**
+ * The terrain sprites of the tiles in view, worked out once and kept in the
+ * order they're drawn in, so drawing the map doesn't have to look them up
+ * again every frame. The list is rebuilt when the camera moves, and only the
+ * tiles that changed (see TileGrid::addDrawChange) are updated otherwise.
+ * Units, the cursor, projectiles, smoke and fire move too often to be kept,
+ * they are drawn by the Map in between.
+ */
+class MapDrawList
+{
+public:
+	/// Terrain sprites of a tile, in drawing order.
+	enum Part { PART_FLOOR, PART_WESTWALL, PART_NORTHWALL, PART_OBJECT, PART_ITEM, PARTS };
+	/// A sprite to draw, relative to its tile.
+	struct Sprite
+	{
+		SurfaceSet *set;
+		int frame;
+		Sint16 x, y;
+		Uint8 shade, color;
+		bool half;
+	};
+	/// A tile in view.
+	struct Entry
+	{
+		Tile *tile;
+		Sint16 x, y;
+		Uint8 shade;
+		bool noFloor;
+		Sprite parts[PARTS];
+	};
+private:
+	SavedBattleGame *_save;
+	Camera *_camera;
+	SurfaceSet *_floorItems;
+	int _spriteWidth, _spriteHeight;
+	std::vector<Entry> _entries;
+	std::vector<int> _entryOf;
+	Position _offset;
+	int _width, _height;
+	bool _valid;
+	/// Works out the sprites of a tile.
+	void build(Entry *entry) const;
+	/// Builds the whole list.
+	void rebuild();
+public:
+	/// Creates a draw list for a map.
+	MapDrawList(SavedBattleGame *save, Camera *camera, SurfaceSet *floorItems, int spriteWidth, int spriteHeight);
+	/// Cleans up the draw list.
+	~MapDrawList();
+	/// Brings the list up to date.
+	bool update(int width, int height, std::vector<int> *changed);
+	/// Makes the list rebuild on the next update.
+	void invalidate();
+	/// Gets the tiles in view.
+	const std::vector<Entry> &getEntries() const;
+	/// Gets where a tile is in the list.
+	int getEntry(int index) const;
+};
+
+}
+
+#endif
@@ -16,14 +16,16 @@
  * You should have received a copy of the GNU General Public License
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
-#include <list>
+#include <algorithm>
+#include <cstdlib>
+#include <set>
 #include "Pathfinding.h"
-#include "PathfindingNode.h"
 #include "../Savegame/SavedBattleGame.h"
 #include "../Savegame/Tile.h"
 #include "../Ruleset/MapData.h"
 #include "../Ruleset/Armor.h"
 #include "../Savegame/BattleUnit.h"
+#include "../Engine/Profiler.h"
 
 namespace OpenXcom
 {
@@ -32,16 +34,18 @@ namespace OpenXcom
  * Sets up a Pathfinding.
  * @param save pointer to SavedBattleGame object.
  */
-Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _nodes(), _unit(0), _pathPreviewed(false)
+Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _nodes(), _generation(0), _floorCostValid(false), _ignoreUnits(false), _unit(0), _pathPreviewed(false)
 {
 	_size = _save->getHeight() * _save->getLength() * _save->getWidth();
-	/* allocate the array and the objects in it */
-	_nodes = new PathfindingNode*[_size];
+	_blocksX = (_save->getWidth() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	_blocksY = (_save->getLength() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	/* allocate all nodes in one block, in the same order as the tiles */
+	_nodes.reserve(_size);
 	int x, y, z;
 	for (int i = 0; i < _size; ++i)
 	{
 		_save->getTileCoords(i, &x, &y, &z);
-		_nodes[i] = new PathfindingNode(Position(x, y, z));
+		_nodes.push_back(PathfindingNode(Position(x, y, z)));
 	}
 }
 
@@ -50,59 +54,43 @@ Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _nodes(), _unit(0
  */
 Pathfinding::~Pathfinding()
 {
-	for (int i = 0; i < _size; ++i)
-	{
-		delete _nodes[i];
-	}
-	delete[] _nodes;
 
 }
 
 /**
  * Gets the Node on a given position on the map.
+ * Nodes not yet touched by the current search are reset first.
  * @param pos position
  * @return Pointer to node.
  */
 PathfindingNode *Pathfinding::getNode(const Position& pos)
 {
-	return _nodes[_save->getTileIndex(pos)];
+	PathfindingNode *node = &_nodes[_save->getTileIndex(pos)];
+	if (node->getGeneration() != _generation)
+	{
+		node->reset(_generation);
+	}
+	return node;
 }
 
 /**
- * Calculate the shortest path using a simple A-Star algorithm.
+ * Calculate the shortest path using the A-Star algorithm. Aliens patrolling more than a map
+ * block away may plan their way over the map blocks first, see searchBlocks(); that path
+ * is not always the cheapest, so every other move gets the full search.
  * @param unit
  * @param endPosition
+ * @param patrol Is the unit just patrolling, so any reasonable path will do?
  */
 
-void Pathfinding::calculate(BattleUnit *unit, Position endPosition)
+void Pathfinding::calculate(BattleUnit *unit, Position endPosition, bool patrol)
 {
-	std::list<PathfindingNode*> openList;
-	PathfindingNode *currentNode, *nextNode;
-	Position currentPos, nextPos, startPosition = unit->getPosition();
-	int tuCost, totalTuCost = 0;
+	Profiler::Scope profile("Pathfinding::calculate");
+	Position startPosition = unit->getPosition();
 
 	_movementType = unit->getArmor()->getMovementType();
 	_unit = unit;
 
-	Tile *destinationTile = _save->getTile(endPosition);
-
-	// check if destination is not blocked
-	if (isBlocked(destinationTile, MapData::O_FLOOR) || isBlocked(destinationTile, MapData::O_OBJECT)) return;
-
-	// the following check avoids that the unit walks behind the stairs if we click behind the stairs to make it go up the stairs.
-	// it only works if the unit is on one of the 2 tiles on the stairs, or on the tile right in front of the stairs.
-	if (isOnStairs(startPosition, endPosition))
-	{
-		endPosition.z++;
-		destinationTile = _save->getTile(endPosition);
-	}
-
-	// check if we have floor, else lower destination (for non flying units only, because otherwise they never reached this place)
-	while (canFallDown(destinationTile) && 	_movementType != MT_FLY)
-	{
-		endPosition.z--;
-		destinationTile = _save->getTile(endPosition);
-	}
+	if (!adjustEndPosition(startPosition, &endPosition)) return;
 
 	_path.clear();
 
@@ -115,54 +103,565 @@ void Pathfinding::calculate(BattleUnit *unit, Position endPosition)
 
 	_path.clear();
 
-	// reset every node, so we have to check them all
-	for (int i = 0; i < _size; ++i)
-		_nodes[i]->reset();
+	// if we already know the way to every tile, just follow it back
+	std::map<BattleUnit*, Reachability>::iterator cached = _reachability.find(unit);
+	if (cached != _reachability.end() && cached->second.origin == startPosition)
+	{
+		int index = _save->getTileIndex(endPosition);
+		if (cached->second.tuCost[index] == -1) return;
+		while (cached->second.prevTile[index] != -1)
+		{
+			_path.push_back(cached->second.prevDir[index]);
+			index = cached->second.prevTile[index];
+		}
+		return;
+	}
 
-	// start position is the first one in our "open" list
-	openList.push_back(getNode(startPosition));
-	openList.front()->check(0, 0, 0, 0);
+	// long patrols don't need to search the whole map
+	if (patrol && unit->getFaction() != FACTION_PLAYER && unit->getArmor()->getSize() == 1
+		&& (abs(startPosition.x / BLOCK_SIZE - endPosition.x / BLOCK_SIZE) > 1 || abs(startPosition.y / BLOCK_SIZE - endPosition.y / BLOCK_SIZE) > 1))
+	{
+		if (searchBlocks(startPosition, endPosition)) return;
+		_path.clear();
+	}
+
+	searchPath(startPosition, endPosition, &_path);
+}
 
-	// if the open list is empty, we've reached the end
-	while(!openList.empty())
+/**
+ * Finds the cheapest path between two positions with the A-Star algorithm. The estimate of
+ * the remaining cost is the number of steps to the side times the cheapest possible step,
+ * which never overestimates, so the path found has the lowest possible TU cost.
+ * Requires the unit and movement type to be set.
+ * @param start Where the path starts.
+ * @param end Where the path ends.
+ * @param path Vector to add the directions to, last step first.
+ * @return False if there is no way to the end position.
+ */
+bool Pathfinding::searchPath(const Position &start, const Position &end, std::vector<int> *path)
+{
+	PathfindingNode *currentNode, *nextNode, *endNode;
+	Position currentPos, nextPos;
+	int tuCost, totalTuCost = 0;
+
+	resetNodes();
+	int stepCost = getMinStepCost();
+
+	// start position is the first one in our "open" list
+	currentNode = getNode(start);
+	currentNode->check(0, 0, 0, 0);
+	currentNode->setTUGuess(stepCost * std::max(abs(end.x - start.x), abs(end.y - start.y)));
+	_openSet.push(currentNode);
+	endNode = getNode(end);
+
+	// if the open list is empty, there is no way to the end position
+	while (!_openSet.empty())
 	{
-		currentPos = openList.front()->getPosition();
-		currentNode = getNode(currentPos);
+		currentNode = _openSet.pop();
+		// the cheapest estimate is the end position, so no other path can be cheaper
+		if (currentNode == endNode)
+			break;
+		currentPos = currentNode->getPosition();
 		// this algorithm expands in all directions
 		for (int direction = 0; direction < 10; direction++)
 		{
-			tuCost = getTUCost(currentPos, direction, &nextPos, unit);
+			tuCost = getTUCost(currentPos, direction, &nextPos, _unit);
 			if(tuCost < 255) // check if we can go to this node (ie is not blocked)
 			{
 				nextNode = getNode(nextPos);
 				totalTuCost = currentNode->getTUCost() + tuCost;
-				// if we haven't checked this node, or the current cost tu cost is lower than our previous path, push this node in the open list to visit later.
-				if( (!nextNode->isChecked() || nextNode->getTUCost() > totalTuCost)
-					&& // this will keep pushing back nodes, as long as we did not reach the end position or there are still possible shorter paths
-					(!getNode(endPosition)->isChecked() || getNode(endPosition)->getTUCost() > totalTuCost)
-				)
+				// if we haven't checked this node, or the current cost tu cost is lower than our previous path, (re)queue it
+				if (!nextNode->isChecked() || nextNode->getTUCost() > totalTuCost)
 				{
+					if (!nextNode->isChecked())
+					{
+						nextNode->setTUGuess(stepCost * std::max(abs(end.x - nextPos.x), abs(end.y - nextPos.y)));
+					}
 					nextNode->check(totalTuCost,
 									currentNode->getStepsNum() + 1,
 									currentNode,
 									direction);
-					openList.push_back(nextNode);
+					_openSet.push(nextNode);
 				}
 			}
 		}
-		openList.pop_front();
 	}
 
-	if(!getNode(endPosition)->isChecked()) return;
+	if(!endNode->isChecked()) return false;
 
 	//Backward tracking of the path
-	PathfindingNode* pf = getNode(endPosition);
-	for (int i = getNode(endPosition)->getStepsNum(); i > 0; i--)
+	PathfindingNode* pf = endNode;
+	for (int i = endNode->getStepsNum(); i > 0; i--)
 	{
-		_path.push_back(pf->getPrevDir());
+		path->push_back(pf->getPrevDir());
 		pf=pf->getPrevNode();
 	}
+	return true;
+}
+
+/**
+ * Applies the same corrections to the end position the unit would when walking there.
+ * Requires the unit and movement type to be set.
+ * @param startPosition Where the unit stands.
+ * @param endPosition Pointer to the end position, adjusted for stairs and falling.
+ * @return False if the end position is blocked.
+ */
+bool Pathfinding::adjustEndPosition(const Position &startPosition, Position *endPosition)
+{
+	Tile *destinationTile = _save->getTile(*endPosition);
+
+	// check if destination is not blocked
+	if (isBlocked(destinationTile, MapData::O_FLOOR) || isBlocked(destinationTile, MapData::O_OBJECT)) return false;
+
+	// the following check avoids that the unit walks behind the stairs if we click behind the stairs to make it go up the stairs.
+	// it only works if the unit is on one of the 2 tiles on the stairs, or on the tile right in front of the stairs.
+	if (isOnStairs(startPosition, *endPosition))
+	{
+		endPosition->z++;
+		destinationTile = _save->getTile(*endPosition);
+	}
+
+	// check if we have floor, else lower destination (for non flying units only, because otherwise they never reached this place)
+	while (canFallDown(destinationTile) && 	_movementType != MT_FLY)
+	{
+		endPosition->z--;
+		destinationTile = _save->getTile(*endPosition);
+	}
+	return true;
+}
+
+/**
+ * Starts a new search: every node gets reset the first time it's used.
+ */
+void Pathfinding::resetNodes()
+{
+	if (++_generation == 0)
+	{
+		for (int i = 0; i < _size; ++i)
+			_nodes[i].reset(0);
+		_generation = 1;
+	}
+	_openSet.clear();
+}
+
+/**
+ * Gets the TU cost of the cheapest way from a unit's position to every tile on the map,
+ * calculated in one pass of Dijkstra's algorithm. The result is kept until the unit moves,
+ * or reachability is invalidated because the terrain or other units changed.
+ * @param unit The unit.
+ * @return Pointer to the reachability of the unit.
+ */
+Pathfinding::Reachability *Pathfinding::getReachability(BattleUnit *unit)
+{
+	Reachability &reach = _reachability[unit];
+	if (!reach.tuCost.empty() && reach.origin == unit->getPosition())
+		return &reach;
+
+	_movementType = unit->getArmor()->getMovementType();
+	_unit = unit;
+	reach.origin = unit->getPosition();
+	reach.tuCost.assign(_size, -1);
+	reach.prevTile.assign(_size, -1);
+	reach.prevDir.assign(_size, -1);
+
+	searchArea(reach.origin, Position(0, 0, 0), Position(_save->getWidth() - 1, _save->getLength() - 1, _save->getHeight() - 1));
+
+	for (int i = 0; i < _size; ++i)
+	{
+		PathfindingNode *node = &_nodes[i];
+		if (node->getGeneration() == _generation && node->isChecked())
+		{
+			reach.tuCost[i] = node->getTUCost();
+			if (node->getPrevNode())
+			{
+				reach.prevTile[i] = node->getPrevNode() - &_nodes[0];
+				reach.prevDir[i] = node->getPrevDir();
+			}
+		}
+	}
+	return &reach;
+}
+
+/**
+ * Finds the cheapest way from a position to every tile within an area, with Dijkstra's
+ * algorithm. Afterwards the nodes of the tiles that can be reached are checked and hold
+ * their TU cost. Requires the unit and movement type to be set.
+ * @param start Where to start.
+ * @param min Lowest corner of the area.
+ * @param max Highest corner of the area.
+ */
+void Pathfinding::searchArea(const Position &start, const Position &min, const Position &max)
+{
+	resetNodes();
+	PathfindingNode *currentNode = getNode(start), *nextNode;
+	Position nextPos;
+	currentNode->check(0, 0, 0, 0);
+	currentNode->setTUGuess(0);
+	_openSet.push(currentNode);
+
+	while (!_openSet.empty())
+	{
+		currentNode = _openSet.pop();
+		for (int direction = 0; direction < 10; direction++)
+		{
+			int tuCost = getTUCost(currentNode->getPosition(), direction, &nextPos, _unit);
+			if (tuCost < 255
+				&& nextPos.x >= min.x && nextPos.x <= max.x
+				&& nextPos.y >= min.y && nextPos.y <= max.y
+				&& nextPos.z >= min.z && nextPos.z <= max.z)
+			{
+				nextNode = getNode(nextPos);
+				int totalTuCost = currentNode->getTUCost() + tuCost;
+				if (!nextNode->isChecked() || nextNode->getTUCost() > totalTuCost)
+				{
+					nextNode->setTUGuess(0);
+					nextNode->check(totalTuCost, currentNode->getStepsNum() + 1, currentNode, direction);
+					_openSet.push(nextNode);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Plans a path over the map blocks first: each block knows its entrances, the steps over
+ * its borders that other blocks can be entered by, and the TU cost of getting from one
+ * entrance to another within the block. Searching the few entrances is much cheaper than
+ * searching all tiles of a big map. Units are left out of the plan, as they keep moving;
+ * the steps between the entrances on the way are filled in afterwards, with units.
+ * The path is not always the cheapest possible, but it is close; only patrols use it.
+ * Requires the unit and movement type to be set.
+ * @param start Where the path starts.
+ * @param end Where the path ends.
+ * @return False if the plan could not be made or filled in.
+ */
+bool Pathfinding::searchBlocks(const Position &start, const Position &end)
+{
+	Graph &graph = _graphs[_movementType];
+	if (graph.blocks.empty())
+	{
+		graph.blocks.resize(_blocksX * _blocksY);
+		graph.borders.resize(_blocksX * _blocksY * 2);
+		graph.borderValid.assign(_blocksX * _blocksY * 2, false);
+	}
+	int startTile = _save->getTileIndex(start), endTile = _save->getTileIndex(end);
+	int startBlock = getBlock(startTile), endBlock = getBlock(endTile);
+
+	_ignoreUnits = true;
+	updateBlock(startBlock);
+	updateBlock(endBlock);
+	// the ways from the start to its block's entrances, and from the end block's entrances to the end
+	std::vector<int> startCosts, endCosts;
+	const Position blockSize(BLOCK_SIZE - 1, BLOCK_SIZE - 1, _save->getHeight() - 1);
+	Position startMin((startBlock % _blocksX) * BLOCK_SIZE, (startBlock / _blocksX) * BLOCK_SIZE, 0);
+	Position endMin((endBlock % _blocksX) * BLOCK_SIZE, (endBlock / _blocksX) * BLOCK_SIZE, 0);
+	searchArea(start, startMin, startMin + blockSize);
+	for (std::vector<int>::const_iterator i = graph.blocks[startBlock].entrances.begin(); i != graph.blocks[startBlock].entrances.end(); ++i)
+	{
+		PathfindingNode *node = &_nodes[*i];
+		startCosts.push_back(node->getGeneration() == _generation && node->isChecked() ? node->getTUCost() : -1);
+	}
+	for (std::vector<int>::const_iterator i = graph.blocks[endBlock].entrances.begin(); i != graph.blocks[endBlock].entrances.end(); ++i)
+	{
+		searchArea(_nodes[*i].getPosition(), endMin, endMin + blockSize);
+		PathfindingNode *node = &_nodes[endTile];
+		endCosts.push_back(node->getGeneration() == _generation && node->isChecked() ? node->getTUCost() : -1);
+	}
+
+	// A-Star over the entrances; the start and end are nodes too
+	int stepCost = getMinStepCost();
+	std::map<int, int> cost, prev;
+	std::set<std::pair<int, int> > open;
+	cost[startTile] = 0;
+	prev[startTile] = -1;
+	open.insert(std::make_pair(0, startTile));
+	bool found = false;
+	while (!open.empty())
+	{
+		int current = open.begin()->second;
+		open.erase(open.begin());
+		if (current == endTile)
+		{
+			found = true;
+			break;
+		}
+		int currentCost = cost[current];
+
+		// gather the ways out of this node
+		std::vector<std::pair<int, int> > edges;
+		if (current == startTile)
+		{
+			const std::vector<int> &entrances = graph.blocks[startBlock].entrances;
+			for (size_t i = 0; i < entrances.size(); ++i)
+			{
+				if (startCosts[i] != -1)
+					edges.push_back(std::make_pair(entrances[i], startCosts[i]));
+			}
+		}
+		// the start can be an entrance itself, when it's on the edge of its block
+		int b = getBlock(current);
+		updateBlock(b);
+		GraphBlock &block = graph.blocks[b];
+		size_t n = block.entrances.size();
+		size_t from = std::lower_bound(block.entrances.begin(), block.entrances.end(), current) - block.entrances.begin();
+		if (from < n && block.entrances[from] == current)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				if (i != from && block.costs[from * n + i] != -1)
+					edges.push_back(std::make_pair(block.entrances[i], block.costs[from * n + i]));
+			}
+			for (std::vector<Crossing>::const_iterator i = block.exits.begin(); i != block.exits.end(); ++i)
+			{
+				if (i->from == current)
+					edges.push_back(std::make_pair(i->to, i->cost));
+			}
+			if (b == endBlock && endCosts[from] != -1)
+			{
+				edges.push_back(std::make_pair(endTile, endCosts[from]));
+			}
+		}
+
+		for (std::vector<std::pair<int, int> >::const_iterator i = edges.begin(); i != edges.end(); ++i)
+		{
+			int nextCost = currentCost + i->second;
+			std::map<int, int>::iterator known = cost.find(i->first);
+			if (known != cost.end() && known->second <= nextCost)
+				continue;
+			const Position &pos = _nodes[i->first].getPosition();
+			int guess = stepCost * std::max(abs(end.x - pos.x), abs(end.y - pos.y));
+			if (known != cost.end())
+			{
+				open.erase(std::make_pair(known->second + guess, i->first));
+			}
+			cost[i->first] = nextCost;
+			prev[i->first] = current;
+			open.insert(std::make_pair(nextCost + guess, i->first));
+		}
+	}
+	_ignoreUnits = false;
+	if (!found) return false;
+
+	// fill in the steps, last part first as paths are stored in reverse order
+	for (int to = endTile, from = prev[endTile]; from != -1; to = from, from = prev[from])
+	{
+		if (from == to)
+			continue;
+		if (!searchPath(_nodes[from].getPosition(), _nodes[to].getPosition(), &_path))
+			return false;
+	}
+	return true;
+}
 
+/**
+ * Gets the map block a tile is in. Map blocks are columns of BLOCK_SIZE by BLOCK_SIZE
+ * tiles, lined up with the blocks the map was generated from.
+ * @param tile Index of the tile.
+ * @return Index of the map block.
+ */
+int Pathfinding::getBlock(int tile) const
+{
+	const Position &pos = _nodes[tile].getPosition();
+	return (pos.y / BLOCK_SIZE) * _blocksX + pos.x / BLOCK_SIZE;
+}
+
+/**
+ * Finds the crossings over the east (even numbers) or south (odd numbers) border of
+ * a map block, in both ways. Of every row of tiles next to each other that can be
+ * crossed from, only the middle one is kept, as any of them will do for a plan.
+ * Requires the unit and movement type to be set.
+ * @param border Index of the border.
+ */
+void Pathfinding::updateBorder(int border)
+{
+	Graph &graph = _graphs[_movementType];
+	if (graph.borderValid[border]) return;
+	graph.borderValid[border] = true;
+	std::vector<Crossing> &crossings = graph.borders[border];
+	crossings.clear();
+
+	int block = border / 2;
+	bool south = border % 2;
+	int bx = (block % _blocksX) * BLOCK_SIZE, by = (block / _blocksX) * BLOCK_SIZE;
+	std::vector<Crossing> row;
+	for (int z = 0; z < _save->getHeight(); ++z)
+	{
+		for (int way = 0; way < 2; ++way)
+		{
+			row.clear();
+			for (int i = 0; i <= BLOCK_SIZE; ++i)
+			{
+				Crossing crossing;
+				crossing.cost = 255;
+				if (i < BLOCK_SIZE)
+				{
+					Position inside = south ? Position(bx + i, by + BLOCK_SIZE - 1, z) : Position(bx + BLOCK_SIZE - 1, by + i, z);
+					Position outside = south ? Position(bx + i, by + BLOCK_SIZE, z) : Position(bx + BLOCK_SIZE, by + i, z);
+					Position from = way ? outside : inside, to;
+					int direction = south ? (way ? 0 : 4) : (way ? 6 : 2);
+					Tile *tile = _save->getTile(from);
+					if (tile && _save->getTile(outside)
+						&& !isBlocked(tile, MapData::O_FLOOR) && !isBlocked(tile, MapData::O_OBJECT)
+						&& (_movementType == MT_FLY || !canFallDown(tile)))
+					{
+						crossing.cost = getTUCost(from, direction, &to, _unit);
+						crossing.from = _save->getTileIndex(from);
+						if (crossing.cost < 255)
+							crossing.to = _save->getTileIndex(to);
+					}
+				}
+				if (crossing.cost < 255)
+				{
+					row.push_back(crossing);
+				}
+				else if (!row.empty())
+				{
+					crossings.push_back(row[row.size() / 2]);
+					row.clear();
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Finds the entrances of a map block, from the crossings over its four borders, and the
+ * TU cost of getting from each entrance to every other one without leaving the block.
+ * Requires the unit and movement type to be set.
+ * @param block Index of the map block.
+ */
+void Pathfinding::updateBlock(int block)
+{
+	Graph &graph = _graphs[_movementType];
+	GraphBlock &b = graph.blocks[block];
+	if (b.valid) return;
+	b.valid = true;
+	b.entrances.clear();
+	b.exits.clear();
+
+	int bx = block % _blocksX, by = block / _blocksX;
+	int borders[4] = {
+		bx < _blocksX - 1 ? block * 2 : -1,
+		by < _blocksY - 1 ? block * 2 + 1 : -1,
+		bx > 0 ? (block - 1) * 2 : -1,
+		by > 0 ? (block - _blocksX) * 2 + 1 : -1 };
+	for (int i = 0; i < 4; ++i)
+	{
+		if (borders[i] == -1) continue;
+		updateBorder(borders[i]);
+		for (std::vector<Crossing>::const_iterator c = graph.borders[borders[i]].begin(); c != graph.borders[borders[i]].end(); ++c)
+		{
+			if (getBlock(c->from) == block)
+			{
+				b.entrances.push_back(c->from);
+				b.exits.push_back(*c);
+			}
+			if (getBlock(c->to) == block)
+			{
+				b.entrances.push_back(c->to);
+			}
+		}
+	}
+	std::sort(b.entrances.begin(), b.entrances.end());
+	b.entrances.erase(std::unique(b.entrances.begin(), b.entrances.end()), b.entrances.end());
+
+	size_t n = b.entrances.size();
+	b.costs.assign(n * n, -1);
+	Position min(bx * BLOCK_SIZE, by * BLOCK_SIZE, 0);
+	Position max = min + Position(BLOCK_SIZE - 1, BLOCK_SIZE - 1, _save->getHeight() - 1);
+	for (size_t i = 0; i < n; ++i)
+	{
+		searchArea(_nodes[b.entrances[i]].getPosition(), min, max);
+		for (size_t j = 0; j < n; ++j)
+		{
+			PathfindingNode *node = &_nodes[b.entrances[j]];
+			if (node->getGeneration() == _generation && node->isChecked())
+			{
+				b.costs[i * n + j] = node->getTUCost();
+			}
+		}
+	}
+}
+
+/**
+ * Gets the TU cost for a unit to walk to a position, using the same end position
+ * corrections as calculate(). Once calculated for a unit, any number of these
+ * lookups are cheap until something moves.
+ * @param unit The unit.
+ * @param endPosition The position to reach.
+ * @return TU cost, or -1 if the position can't be reached.
+ */
+int Pathfinding::getReachCost(BattleUnit *unit, Position endPosition)
+{
+	Profiler::Scope profile("Pathfinding::getReachCost");
+	_movementType = unit->getArmor()->getMovementType();
+	_unit = unit;
+	if (!adjustEndPosition(unit->getPosition(), &endPosition))
+		return -1;
+	return getReachability(unit)->tuCost[_save->getTileIndex(endPosition)];
+}
+
+/**
+ * Gets the lowest TU cost any step to the side can have on this map, for the current
+ * movement type. Every such step ends on a floor, on a tile without floor when flying
+ * (4 TUs), or after a fall that stopped on a tile without floor (floor cost only).
+ * The terrain part is cached until the terrain changes; units can stop a fall anywhere, so
+ * the tiles above them are checked every time.
+ * @return TU cost
+ */
+int Pathfinding::getMinStepCost()
+{
+	if (!_floorCostValid)
+	{
+		MovementType types[3] = { MT_WALK, MT_FLY, MT_SLIDE };
+		for (int t = 0; t < 3; ++t)
+		{
+			_floorCost[t] = 255;
+			for (int i = 0; i < _size; ++i)
+			{
+				Tile *tile = _save->getTiles()[i];
+				Position pos = tile->getPosition();
+				int cost = 255;
+				if (!tile->hasNoFloor())
+				{
+					cost = tile->getTUCost(MapData::O_FLOOR, types[t]);
+				}
+				else
+				{
+					if (types[t] == MT_FLY)
+					{
+						cost = 4;
+					}
+					Tile *below = _save->getTile(pos + Position(0, 0, -1));
+					if (pos.z == 0
+						|| (below->getMapData(MapData::O_OBJECT) && below->getMapData(MapData::O_OBJECT)->getTerrainLevel() == 0))
+					{
+						cost = std::min(cost, tile->getTUCost(MapData::O_FLOOR, types[t]));
+					}
+				}
+				_floorCost[t] = std::min(_floorCost[t], cost);
+			}
+		}
+		_floorCostValid = true;
+	}
+
+	int stepCost = _floorCost[_movementType];
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end() && stepCost > 0; ++i)
+	{
+		int size = (*i)->getArmor()->getSize();
+		for (int x = 0; x < size; ++x)
+		{
+			for (int y = 0; y < size; ++y)
+			{
+				Tile *above = _save->getTile((*i)->getPosition() + Position(x, y, 1));
+				if (above && above->hasNoFloor())
+				{
+					stepCost = std::min(stepCost, above->getTUCost(MapData::O_FLOOR, _movementType));
+				}
+			}
+		}
+	}
+	return std::max(stepCost, 0);
 }
 
 /**
@@ -346,6 +845,72 @@ void Pathfinding::abortPath()
 	_path.clear();
 }
 
+/**
+ * Marks the terrain as changed, because something got destroyed.
+ * The cheapest step cost will be recalculated on the next search.
+ */
+void Pathfinding::invalidateTerrain()
+{
+	_floorCostValid = false;
+	invalidateReachability();
+	for (int t = 0; t < 3; ++t)
+	{
+		_graphs[t].blocks.clear();
+	}
+}
+
+/**
+ * Marks the terrain within an area as changed, because something got destroyed
+ * or a door opened or closed. Only the map blocks within the area, and the blocks
+ * next to them, have to find their entrances again.
+ * @param min Lowest corner of the area.
+ * @param max Highest corner of the area.
+ */
+void Pathfinding::invalidateTerrain(const Position &min, const Position &max)
+{
+	_floorCostValid = false;
+	invalidateReachability();
+	for (int t = 0; t < 3; ++t)
+	{
+		Graph &graph = _graphs[t];
+		if (graph.blocks.empty()) continue;
+		for (int by = std::max(min.y, 0) / BLOCK_SIZE; by <= std::min(max.y / BLOCK_SIZE, _blocksY - 1); ++by)
+		{
+			for (int bx = std::max(min.x, 0) / BLOCK_SIZE; bx <= std::min(max.x / BLOCK_SIZE, _blocksX - 1); ++bx)
+			{
+				int block = by * _blocksX + bx;
+				graph.blocks[block].valid = false;
+				graph.borderValid[block * 2] = false;
+				graph.borderValid[block * 2 + 1] = false;
+				if (bx > 0)
+				{
+					graph.blocks[block - 1].valid = false;
+					graph.borderValid[(block - 1) * 2] = false;
+				}
+				if (by > 0)
+				{
+					graph.blocks[block - _blocksX].valid = false;
+					graph.borderValid[(block - _blocksX) * 2 + 1] = false;
+				}
+				if (bx < _blocksX - 1)
+					graph.blocks[block + 1].valid = false;
+				if (by < _blocksY - 1)
+					graph.blocks[block + _blocksX].valid = false;
+			}
+		}
+	}
+}
+
+/**
+ * Drops all calculated reachability, because a door opened, terrain got destroyed
+ * or a unit moved, appeared or fell; each of these can open or block a way.
+ * A unit's own moves are noticed without this.
+ */
+void Pathfinding::invalidateReachability()
+{
+	_reachability.clear();
+}
+
 
 /*
  * Whether a certain part of a tile blocks movement.
@@ -360,7 +925,7 @@ bool Pathfinding::isBlocked(Tile *tile, const int part)
 	if (part == MapData::O_FLOOR)
 	{
 		BattleUnit *unit = tile->getUnit();
-		if (unit != 0 && unit != _unit) return true;
+		if (unit != 0 && unit != _unit && !_ignoreUnits) return true;
 	}
 
 	if (tile->getTUCost(part, _movementType) == 255) return true; // blocking part
@@ -447,7 +1012,7 @@ bool Pathfinding::canFallDown(Tile *here)
 	if (here->getPosition().z == 0)
 		return false;
 
-	if (_save->selectUnit(here->getPosition() + Position(0, 0, -1)) &&
+	if (!_ignoreUnits && _save->selectUnit(here->getPosition() + Position(0, 0, -1)) &&
 		_save->selectUnit(here->getPosition() + Position(0, 0, -1)) != _unit)
 		return false;
 
@@ -20,15 +20,17 @@
 #define OPENXCOM_PATHFINDING_H
 
 #include <vector>
+#include <map>
 #include "Position.h"
 #include "../Ruleset/MapData.h"
+#include "PathfindingNode.h"
+#include "PathfindingOpenSet.h"
 
 namespace OpenXcom
 {
 
 class Position;
 class SavedBattleGame;
-class PathfindingNode;
 class Tile;
 class BattleUnit;
 
@@ -39,10 +41,45 @@ class Pathfinding
 {
 private:
 	SavedBattleGame *_save;
-	PathfindingNode **_nodes;
+	std::vector<PathfindingNode> _nodes;
+	PathfindingOpenSet _openSet;
+	unsigned int _generation;
 	int _size;
+	int _floorCost[3];
+	bool _floorCostValid;
 	std::vector<int> _path;
 	MovementType _movementType;
+	/// The cheapest way to every tile from where a unit stands.
+	struct Reachability
+	{
+		Position origin;
+		std::vector<int> tuCost, prevTile, prevDir;
+	};
+	std::map<BattleUnit*, Reachability> _reachability;
+	static const int BLOCK_SIZE = 10;
+	/// A step from the edge of one map block into the next.
+	struct Crossing
+	{
+		int from, to, cost;
+	};
+	/// The ways into and out of a map block, with the TU cost of getting between them within the block.
+	struct GraphBlock
+	{
+		bool valid;
+		std::vector<int> entrances, costs;
+		std::vector<Crossing> exits;
+		GraphBlock() : valid(false) {};
+	};
+	/// The map blocks and the crossings between them, for one movement type.
+	struct Graph
+	{
+		std::vector<GraphBlock> blocks;
+		std::vector<std::vector<Crossing> > borders;
+		std::vector<bool> borderValid;
+	};
+	Graph _graphs[3];
+	int _blocksX, _blocksY;
+	bool _ignoreUnits;
 	/// Gets the node at certain position.
 	PathfindingNode *getNode(const Position& pos);
 	/// whether a tile blocks a certain movementType
@@ -50,6 +87,26 @@ private:
 	bool isBlocked(Tile *startTile, Tile *endTile, const int direction);
 	bool canFallDown(Tile *destinationTile);
 	bool isOnStairs(const Position &startPosition, const Position &endPosition);
+	/// Gets the lowest possible TU cost of a step to the side.
+	int getMinStepCost();
+	/// Adjusts the end position for stairs and falling.
+	bool adjustEndPosition(const Position &startPosition, Position *endPosition);
+	/// Starts a new search.
+	void resetNodes();
+	/// Gets the reachability of a unit, calculating it if needed.
+	Reachability *getReachability(BattleUnit *unit);
+	/// Finds the cheapest way to every tile within an area.
+	void searchArea(const Position &start, const Position &min, const Position &max);
+	/// Finds the cheapest path between two positions.
+	bool searchPath(const Position &start, const Position &end, std::vector<int> *path);
+	/// Plans a path over the map blocks first, then fills in the steps.
+	bool searchBlocks(const Position &start, const Position &end);
+	/// Gets the map block a tile is in.
+	int getBlock(int tile) const;
+	/// Finds the crossings over the border of a map block.
+	void updateBorder(int border);
+	/// Finds the entrances of a map block and the costs between them.
+	void updateBlock(int block);
 	BattleUnit *_unit;
 	bool _pathPreviewed;
 public:
@@ -60,7 +117,7 @@ public:
 	/// Cleans up the Pathfinding.
 	~Pathfinding();
 	/// Calculate the shortest path.
-	void calculate(BattleUnit *unit, Position endPosition);
+	void calculate(BattleUnit *unit, Position endPosition, bool patrol = false);
 	/// Converts direction to a vector.
 	static void directionToVector(const int direction, Position *vector);
 	/// Check whether a path is ready gives the first direction.
@@ -71,6 +128,14 @@ public:
 	int getTUCost(const Position &startPosition, const int direction, Position *endPosition, BattleUnit *unit);
 	/// Abort the current path.
 	void abortPath();
+	/// Marks the terrain as changed.
+	void invalidateTerrain();
+	/// Marks the terrain within an area as changed.
+	void invalidateTerrain(const Position &min, const Position &max);
+	/// Marks all reachability as outdated.
+	void invalidateReachability();
+	/// Gets the TU cost for a unit to reach a position.
+	int getReachCost(BattleUnit *unit, Position endPosition);
 	bool validateUpDown(BattleUnit *bu, Position startPosition, const int direction);
 	bool previewPath(bool bRemove = false);
 	bool removePreview();
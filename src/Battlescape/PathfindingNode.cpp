@@ -26,7 +26,7 @@ namespace OpenXcom
  * Sets up a PathfindingNode.
  * @param pos Position.
  */
-PathfindingNode::PathfindingNode(Position pos) : _pos(pos)
+PathfindingNode::PathfindingNode(Position pos) : _pos(pos), _checked(false), _tuCost(0), _stepsNum(0), _prevNode(0), _prevDir(0), _generation(0), _tuGuess(0), _openSetIndex(-1)
 {
 
 }
@@ -48,11 +48,23 @@ const Position &PathfindingNode::getPosition() const
 	return _pos;
 }
 /**
- * Reset node.
+ * Reset node. Nodes are reset lazily, the first time a search touches them.
+ * @param generation Number of the search.
  */
-void PathfindingNode::reset()
+void PathfindingNode::reset(unsigned int generation)
 {
 	_checked = false;
+	_generation = generation;
+	_openSetIndex = -1;
+}
+
+/**
+ * Get the number of the search this node was last reset for.
+ * @return generation
+ */
+unsigned int PathfindingNode::getGeneration() const
+{
+	return _generation;
 }
 /**
 * Check node. The pathfinding marks every node as checked, storing some additional info.
@@ -115,4 +127,41 @@ int PathfindingNode::getPrevDir() const
 	return _prevDir;
 }
 
+/**
+ * Get the estimated TU cost from this node to the target.
+ * @return cost
+ */
+int PathfindingNode::getTUGuess() const
+{
+	return _tuGuess;
+}
+
+/**
+ * Set the estimated TU cost from this node to the target.
+ * It must never be more than the real cost.
+ * @param tuGuess cost
+ */
+void PathfindingNode::setTUGuess(int tuGuess)
+{
+	_tuGuess = tuGuess;
+}
+
+/**
+ * Get the place of this node in the open set.
+ * @return index, -1 if it's not in there
+ */
+int PathfindingNode::getOpenSetIndex() const
+{
+	return _openSetIndex;
+}
+
+/**
+ * Set the place of this node in the open set.
+ * @param index index, -1 if it's not in there
+ */
+void PathfindingNode::setOpenSetIndex(int index)
+{
+	_openSetIndex = index;
+}
+
 }
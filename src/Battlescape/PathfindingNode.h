@@ -35,6 +35,8 @@ private:
 	int _tuCost, _stepsNum;
 	PathfindingNode* _prevNode;
 	int _prevDir;
+	unsigned int _generation;
+	int _tuGuess, _openSetIndex;
 public:
 	/// Creates a new PathfindingNode class
 	PathfindingNode(Position pos);
@@ -43,7 +45,9 @@ public:
 	/// Get the node position
 	const Position &getPosition() const;
 	/// Reset node.
-	void reset();
+	void reset(unsigned int generation);
+	/// Get the search the node was last reset for.
+	unsigned int getGeneration() const;
 	/// Check node.
 	void check(int tuCost, int stepsNum, PathfindingNode* prevNode, int prevDir);
 	/// is checked?
@@ -56,6 +60,14 @@ public:
 	PathfindingNode* getPrevNode() const;
 	/// get previous walking direction
 	int getPrevDir() const;
+	/// get estimated TU cost to the target
+	int getTUGuess() const;
+	/// set estimated TU cost to the target
+	void setTUGuess(int tuGuess);
+	/// get place in the open set
+	int getOpenSetIndex() const;
+	/// set place in the open set
+	void setOpenSetIndex(int index);
 };
 
 }
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "PathfindingOpenSet.h"
+#include "PathfindingNode.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Sets up an empty open set.
+ */
+PathfindingOpenSet::PathfindingOpenSet()
+{
+
+}
+
+/**
+ * Deletes the open set. The nodes are not owned by it.
+ */
+PathfindingOpenSet::~PathfindingOpenSet()
+{
+
+}
+
+/**
+ * Checks if there are any nodes left.
+ * @return True if the open set is empty.
+ */
+bool PathfindingOpenSet::empty() const
+{
+	return _heap.empty();
+}
+
+/**
+ * Removes all nodes from the open set.
+ */
+void PathfindingOpenSet::clear()
+{
+	for (std::vector<PathfindingNode*>::iterator i = _heap.begin(); i != _heap.end(); ++i)
+	{
+		(*i)->setOpenSetIndex(-1);
+	}
+	_heap.clear();
+}
+
+/**
+ * Adds a node to the open set. If the node is already in it,
+ * it is moved to its new place after its cost went down.
+ * @param node Pointer to the node.
+ */
+void PathfindingOpenSet::push(PathfindingNode *node)
+{
+	int index = node->getOpenSetIndex();
+	if (index == -1)
+	{
+		index = _heap.size();
+		_heap.push_back(node);
+		node->setOpenSetIndex(index);
+	}
+	siftUp(index);
+}
+
+/**
+ * Removes the node with the lowest estimated total cost from the open set.
+ * @return Pointer to the node.
+ */
+PathfindingNode *PathfindingOpenSet::pop()
+{
+	PathfindingNode *top = _heap.front();
+	PathfindingNode *last = _heap.back();
+	_heap.pop_back();
+	top->setOpenSetIndex(-1);
+	if (!_heap.empty())
+	{
+		place(last, 0);
+		siftDown(0);
+	}
+	return top;
+}
+
+/**
+ * Compares two nodes. Lower estimated total cost comes first; on equal
+ * estimates, the one closer to the target is preferred.
+ * @param a First node.
+ * @param b Second node.
+ * @return True if a should be visited before b.
+ */
+bool PathfindingOpenSet::before(PathfindingNode *a, PathfindingNode *b) const
+{
+	int fa = a->getTUCost() + a->getTUGuess();
+	int fb = b->getTUCost() + b->getTUGuess();
+	if (fa != fb)
+		return fa < fb;
+	return a->getTUGuess() < b->getTUGuess();
+}
+
+/**
+ * Puts a node in a slot of the heap.
+ * @param node Pointer to the node.
+ * @param index Slot in the heap.
+ */
+void PathfindingOpenSet::place(PathfindingNode *node, int index)
+{
+	_heap[index] = node;
+	node->setOpenSetIndex(index);
+}
+
+/**
+ * Moves a node up the heap until its parent comes before it.
+ * @param index Slot of the node.
+ */
+void PathfindingOpenSet::siftUp(int index)
+{
+	PathfindingNode *node = _heap[index];
+	while (index > 0)
+	{
+		int parent = (index - 1) / 2;
+		if (!before(node, _heap[parent]))
+			break;
+		place(_heap[parent], index);
+		index = parent;
+	}
+	place(node, index);
+}
+
+/**
+ * Moves a node down the heap until it comes before its children.
+ * @param index Slot of the node.
+ */
+void PathfindingOpenSet::siftDown(int index)
+{
+	PathfindingNode *node = _heap[index];
+	int size = _heap.size();
+	while (true)
+	{
+		int child = index * 2 + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size && before(_heap[child + 1], _heap[child]))
+			child++;
+		if (!before(_heap[child], node))
+			break;
+		place(_heap[child], index);
+		index = child;
+	}
+	place(node, index);
+}
+
+}
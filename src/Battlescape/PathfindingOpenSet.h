@@ -0,0 +1,59 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_PATHFINDINGOPENSET_H
+#define OPENXCOM_PATHFINDINGOPENSET_H
+
+#include <vector>
+
+namespace OpenXcom
+{
+
+class PathfindingNode;
+
+/**
+ * The nodes still to be visited by the pathfinding, as a binary heap ordered by
+ * the estimated total TU cost. Nodes keep track of their own place in the heap,
+ * so a node that gets a cheaper path is moved up instead of added again.
+ */
+class PathfindingOpenSet
+{
+private:
+	std::vector<PathfindingNode*> _heap;
+	bool before(PathfindingNode *a, PathfindingNode *b) const;
+	void place(PathfindingNode *node, int index);
+	void siftUp(int index);
+	void siftDown(int index);
+public:
+	/// Creates an empty open set.
+	PathfindingOpenSet();
+	/// Cleans up the open set.
+	~PathfindingOpenSet();
+	/// Is the open set empty?
+	bool empty() const;
+	/// Removes all nodes.
+	void clear();
+	/// Adds a node or updates its place.
+	void push(PathfindingNode *node);
+	/// Removes the node with the lowest estimated cost.
+	PathfindingNode *pop();
+};
+
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include "../Engine/Surface.h"
 #include "../Battlescape/Position.h"
 #include "../Resource/ResourcePack.h"
+#include "../Engine/Profiler.h"
 #include "../Ruleset/Unit.h"
 #include "../Ruleset/RuleSoldier.h"
 #include "../Ruleset/RuleItem.h"
@@ -82,6 +83,7 @@ Projectile::~Projectile()
  */
 int Projectile::calculateTrajectory(double accuracy)
 {
+	Profiler::Scope profile("Projectile::calculateTrajectory");
 	Position originVoxel, targetVoxel;
 	int direction;
 	int dirYshift[8] = {1, 4, 12, 15, 15, 15, 8, 1 };
@@ -203,6 +205,7 @@ int Projectile::calculateTrajectory(double accuracy)
  */
 bool Projectile::calculateThrow(double accuracy)
 {
+	Profiler::Scope profile("Projectile::calculateThrow");
 	Position originVoxel, targetVoxel;
 	bool foundCurve = false;
 
@@ -253,7 +256,7 @@ bool Projectile::calculateThrow(double accuracy)
 	static const double maxDeviation = 0.08;
 	static const double minDeviation = 0;
 	double baseDeviation = (maxDeviation - (maxDeviation * accuracy)) + minDeviation;
-	double deviation = RNG::boxMuller(0, baseDeviation);
+	double deviation = RNG::boxMuller(0, baseDeviation, RNG::COMBAT);
 
 	_trajectory.clear();
 	// finally do a line calculation and store this trajectory.
@@ -316,7 +319,7 @@ void Projectile::applyAccuracy(const Position& origin, Position *target, double
 	double baseDeviation = (maxDeviation - (maxDeviation * accuracy)) + minDeviation;
 	// the angle deviations are spread using a normal distribution between 0 and baseDeviation
 	// check if we hit
-	if (RNG::generate(0.0, 1.0) < accuracy)
+	if (RNG::generate(0.0, 1.0, RNG::COMBAT) < accuracy)
 	{
 		// we hit, so no deviation
 		dRot = 0;
@@ -324,8 +327,8 @@ void Projectile::applyAccuracy(const Position& origin, Position *target, double
 	}
 	else
 	{
-		dRot = RNG::boxMuller(0, baseDeviation);
-		dTilt = RNG::boxMuller(0, baseDeviation / 2.0); // tilt deviation is halved
+		dRot = RNG::boxMuller(0, baseDeviation, RNG::COMBAT);
+		dTilt = RNG::boxMuller(0, baseDeviation / 2.0, RNG::COMBAT); // tilt deviation is halved
 	}
 	rotation = atan2(double(target->y - origin.y), double(target->x - origin.x)) * 180 / M_PI;
 	tilt = atan2(double(target->z - origin.z),
@@ -350,6 +353,7 @@ void Projectile::applyAccuracy(const Position& origin, Position *target, double
  */
 bool Projectile::move()
 {
+	Profiler::Scope profile("Projectile::move");
 	_position++;
 	if (_position == _trajectory.size())
 	{
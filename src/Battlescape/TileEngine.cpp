@@ -18,16 +18,24 @@
  */
 #define _USE_MATH_DEFINES
 #include <cmath>
-#include <set>
+#include <algorithm>
+#include <iterator>
 #include "TileEngine.h"
 #include <SDL.h>
 #include "BattleAIState.h"
 #include "AggroBAIState.h"
+#include "ViewCone.h"
+#include "Pathfinding.h"
 #include "../Savegame/SavedBattleGame.h"
 #include "../Savegame/Tile.h"
+#include "../Savegame/TileGrid.h"
 #include "../Savegame/BattleUnit.h"
 #include "../Savegame/Soldier.h"
 #include "../Engine/RNG.h"
+#include "../Engine/Options.h"
+#include "../Engine/CrossPlatform.h"
+#include "../Engine/Profiler.h"
+#include "../Engine/ThreadPool.h"
 #include "../Ruleset/MapDataSet.h"
 #include "../Ruleset/MapData.h"
 #include "../Ruleset/Unit.h"
@@ -42,9 +50,21 @@ namespace OpenXcom
  * Sets up a TileEngine.
  * @param save pointer to SavedBattleGame object.
  */
-TileEngine::TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData) : _save(save), _voxelData(voxelData), _personalLighting(true)
+TileEngine::TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData) : _save(save), _voxelData(voxelData), _sightKeys(0), _sightKeysLimit(65536), _terrainVersion(1), _fovUnits(0), _explosionRayLength(0), _personalLighting(true)
 {
-
+	for (int layer = 0; layer < 3; ++layer)
+	{
+		_lightSourcesFound[layer] = false;
+	}
+	_viewCone = new ViewCone(MAX_VIEW_DISTANCE, _save->getHeight());
+	// field of view of several units is worked out in parallel, by default on all processors
+	int threads = Options::getInt("battleThreads");
+	if (threads <= 0)
+	{
+		threads = CrossPlatform::getProcessorCount();
+	}
+	_threadPool = new ThreadPool(threads - 1);
+	_coneTiles.resize(_threadPool->getWorkers());
 }
 
 /**
@@ -52,7 +72,8 @@ TileEngine::TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData) :
  */
 TileEngine::~TileEngine()
 {
-
+	delete _threadPool;
+	delete _viewCone;
 }
 
 
@@ -61,8 +82,10 @@ TileEngine::~TileEngine()
   */
 void TileEngine::calculateSunShading()
 {
+	Profiler::Scope profile("TileEngine::calculateSunShading");
 	const int layer = 0; // Ambient lighting layer.
 
+	_save->updateRoofLevels(Position(0, 0, 0), Position(_save->getWidth() - 1, _save->getLength() - 1, 0));
 	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
 	{
 		_save->getTiles()[i]->resetLight(layer);
@@ -70,8 +93,35 @@ void TileEngine::calculateSunShading()
 	}
 }
 
+/**
+  * Calculate sun shading for all tiles in the columns within an area, used when
+  * terrain got destroyed. Only tiles below the changed ones can get different shading.
+  * @param min Top left corner of the area.
+  * @param max Bottom right corner of the area.
+  */
+void TileEngine::calculateSunShading(const Position &min, const Position &max)
+{
+	Profiler::Scope profile("TileEngine::calculateSunShading");
+	const int layer = 0; // Ambient lighting layer.
+
+	_save->updateRoofLevels(min, max);
+	for (int x = std::max(min.x, 0); x <= std::min(max.x, _save->getWidth() - 1); ++x)
+	{
+		for (int y = std::max(min.y, 0); y <= std::min(max.y, _save->getLength() - 1); ++y)
+		{
+			for (int z = 0; z < _save->getHeight(); ++z)
+			{
+				Tile *tile = _save->getTile(Position(x, y, z));
+				tile->resetLight(layer);
+				calculateSunShading(tile);
+			}
+		}
+	}
+}
+
 /**
   * Calculate sun shading for 1 tile. Sun comes from above and is blocked by floors or objects.
+  * Uses the roof levels of the map, which must be up to date.
   * @param tile The tile to calculate sun shading for.
   */
 void TileEngine::calculateSunShading(Tile *tile)
@@ -83,7 +133,7 @@ void TileEngine::calculateSunShading(Tile *tile)
 	// At night/dusk sun isn't dropping shades blocked by roofs
 	if (_save->getGlobalShade() <= 4)
 	{
-		if (verticalBlockage(_save->getTile(Position(tile->getPosition().x, tile->getPosition().y, _save->getHeight() - 1)), tile, DT_NONE))
+		if (tile->getPosition().z < _save->getRoofLevel(tile->getPosition().x, tile->getPosition().y))
 		{
 			power -= 2;
 		}
@@ -94,109 +144,306 @@ void TileEngine::calculateSunShading(Tile *tile)
 
 /**
   * Recalculate lighting for the terrain: objects,items,fire.
+  * The whole map is searched for light sources only the first time; after that only
+  * the tiles that gained or lost one are looked at, and only the surroundings of those
+  * light sources are relit.
   */
 void TileEngine::calculateTerrainLighting()
 {
+	Profiler::Scope profile("TileEngine::calculateTerrainLighting");
 	const int layer = 1; // Static lighting layer.
-	const int fireLightPower = 15; // amount of light a fire generates
-
-	// reset all light to 0 first
-	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
-	{
-		_save->getTiles()[i]->resetLight(layer);
-	}
+	std::vector<LightSource> sources;
 
-	// add lighting of terrain
-	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
+	collectLightChanges();
+	if (!_lightSourcesFound[layer])
 	{
-		// only floors and objects can light up
-		if (_save->getTiles()[i]->getMapData(MapData::O_FLOOR)
-			&& _save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getLightSource())
+		for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
 		{
-			addLight(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getLightSource(), layer);
+			findTerrainLights(_save->getTiles()[i], &sources);
 		}
-		if (_save->getTiles()[i]->getMapData(MapData::O_OBJECT)
-			&& _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getLightSource())
+		_lightChanges[layer].clear();
+		_lightSourcesFound[layer] = true;
+	}
+	else
+	{
+		if (_lightChanges[layer].empty())
+			return;
+		keepUnchangedLights(layer, &sources);
+		for (std::vector<int>::iterator i = _lightChanges[layer].begin(); i != _lightChanges[layer].end(); ++i)
 		{
-			addLight(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getLightSource(), layer);
+			findTerrainLights(_save->getTiles()[*i], &sources);
 		}
+		_lightChanges[layer].clear();
+	}
+
+	updateLighting(layer, &sources);
+}
 
-		// fires
-		if (_save->getTiles()[i]->getFire())
+/**
+ * Takes the tiles that gained or lost a light source since the last time
+ * from the map, for each lighting layer to handle in its own time.
+ */
+void TileEngine::collectLightChanges()
+{
+	std::vector<int> *changes = _save->getTileGrid()->getLightChanges();
+	if (changes->empty())
+		return;
+	for (int layer = 1; layer < 3; ++layer)
+	{
+		if (_lightSourcesFound[layer])
 		{
-			addLight(_save->getTiles()[i]->getPosition(), fireLightPower, layer);
+			_lightChanges[layer].insert(_lightChanges[layer].end(), changes->begin(), changes->end());
 		}
+	}
+	changes->clear();
+}
 
-		for (std::vector<BattleItem*>::iterator it = _save->getTiles()[i]->getInventory()->begin(); it != _save->getTiles()[i]->getInventory()->end(); ++it)
+/**
+ * Copies the light sources of a layer that are not on a changed tile,
+ * and sorts out the changed tiles, which have to be searched again.
+ * @param layer Light is seperated in 3 layers: Ambient, Static and Dynamic.
+ * @param sources List to add the light sources to.
+ */
+void TileEngine::keepUnchangedLights(int layer, std::vector<LightSource> *sources)
+{
+	std::vector<int> &changes = _lightChanges[layer];
+	std::sort(changes.begin(), changes.end());
+	changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
+	for (std::vector<LightSource>::iterator i = _lightSources[layer].begin(); i != _lightSources[layer].end(); ++i)
+	{
+		if (!std::binary_search(changes.begin(), changes.end(), _save->getTileIndex(i->pos)))
 		{
-			if ((*it)->getRules()->getBattleType() == BT_FLARE)
-			{
-				addLight(_save->getTiles()[i]->getPosition(), (*it)->getRules()->getPower(), layer);
-			}
+			sources->push_back(*i);
 		}
+	}
+}
+
+/**
+  * Adds the light sources on a tile: objects, items and fire.
+  * @param tile The tile.
+  * @param sources List to add the light sources to.
+  */
+void TileEngine::findTerrainLights(Tile *tile, std::vector<LightSource> *sources)
+{
+	const int fireLightPower = 15; // amount of light a fire generates
 
+	// only floors and objects can light up
+	if (tile->getMapData(MapData::O_FLOOR)
+		&& tile->getMapData(MapData::O_FLOOR)->getLightSource())
+	{
+		sources->push_back(LightSource(tile->getPosition(), tile->getMapData(MapData::O_FLOOR)->getLightSource()));
+	}
+	if (tile->getMapData(MapData::O_OBJECT)
+		&& tile->getMapData(MapData::O_OBJECT)->getLightSource())
+	{
+		sources->push_back(LightSource(tile->getPosition(), tile->getMapData(MapData::O_OBJECT)->getLightSource()));
+	}
+
+	// fires
+	if (tile->getFire())
+	{
+		sources->push_back(LightSource(tile->getPosition(), fireLightPower));
 	}
 
+	for (std::vector<BattleItem*>::iterator it = tile->getInventory()->begin(); it != tile->getInventory()->end(); ++it)
+	{
+		if ((*it)->getRules()->getBattleType() == BT_FLARE)
+		{
+			sources->push_back(LightSource(tile->getPosition(), (*it)->getRules()->getPower()));
+		}
+	}
 }
 
 /**
   * Recalculate lighting for the units.
+  * After the first time, only the tiles units stepped onto or off are looked at,
+  * and only the surroundings of units that moved, fell or got up are relit.
   */
 void TileEngine::calculateUnitLighting()
 {
+	Profiler::Scope profile("TileEngine::calculateUnitLighting");
 	const int layer = 2; // Dynamic lighting layer.
+	std::vector<LightSource> sources;
+
+	collectLightChanges();
+	if (!_lightSourcesFound[layer])
+	{
+		for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+		{
+			if ((*i)->getTile())
+			{
+				findUnitLight((*i)->getTile(), &sources);
+			}
+		}
+		_lightChanges[layer].clear();
+		_lightSourcesFound[layer] = true;
+	}
+	else
+	{
+		if (_lightChanges[layer].empty())
+			return;
+		keepUnchangedLights(layer, &sources);
+		for (std::vector<int>::iterator i = _lightChanges[layer].begin(); i != _lightChanges[layer].end(); ++i)
+		{
+			findUnitLight(_save->getTiles()[*i], &sources);
+		}
+		_lightChanges[layer].clear();
+	}
+
+	updateLighting(layer, &sources);
+}
+
+/**
+ * Adds the personal light of the soldier standing on a tile, if any.
+ * A unit only gives off light from the tile it's positioned on.
+ * @param tile The tile.
+ * @param sources List to add the light source to.
+ */
+void TileEngine::findUnitLight(Tile *tile, std::vector<LightSource> *sources)
+{
 	const int personalLightPower = 15; // amount of light a unit generates
 
-	// reset all light to 0 first
-	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
+	BattleUnit *unit = tile->getUnit();
+	if (_personalLighting && unit && unit->getFaction() == FACTION_PLAYER && !unit->isOut()
+		&& unit->getPosition() == tile->getPosition())
 	{
-		_save->getTiles()[i]->resetLight(layer);
+		sources->push_back(LightSource(tile->getPosition(), personalLightPower));
 	}
+}
 
-	if (_personalLighting)
+/**
+ * Replaces the light sources of a layer and relights the footprints of all sources
+ * that were added or removed. A moved source counts as both.
+ * @param layer Light is seperated in 3 layers: Ambient, Static and Dynamic.
+ * @param sources The new light sources, will be sorted and swapped out.
+ */
+void TileEngine::updateLighting(int layer, std::vector<LightSource> *sources)
+{
+	std::vector<LightSource> changed;
+	std::sort(sources->begin(), sources->end());
+	std::set_symmetric_difference(_lightSources[layer].begin(), _lightSources[layer].end(), sources->begin(), sources->end(), std::back_inserter(changed));
+	_lightSources[layer].swap(*sources);
+
+	// when most of the map changes, one pass over it is cheaper than many overlapping ones
+	int area = 0;
+	for (std::vector<LightSource>::iterator i = changed.begin(); i != changed.end(); ++i)
 	{
-		// add lighting of soldiers
-		for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+		area += (i->power * 2 + 1) * (i->power * 2 + 1);
+	}
+	if (area >= _save->getWidth() * _save->getLength())
+	{
+		relight(layer, Position(0, 0, 0), Position(_save->getWidth() - 1, _save->getLength() - 1, _save->getHeight() - 1));
+		return;
+	}
+
+	for (std::vector<LightSource>::iterator i = changed.begin(); i != changed.end(); ++i)
+	{
+		relight(layer, i->pos - Position(i->power, i->power, 0), i->pos + Position(i->power, i->power, 0));
+	}
+}
+
+/**
+ * Resets the light of a layer in an area and adds back the light
+ * of every source of that layer shining into it.
+ * @param layer Light is seperated in 3 layers: Ambient, Static and Dynamic.
+ * @param min Top left corner of the area, all levels.
+ * @param max Bottom right corner of the area, all levels.
+ */
+void TileEngine::relight(int layer, Position min, Position max)
+{
+	min.x = std::max(min.x, 0);
+	min.y = std::max(min.y, 0);
+	max.x = std::min(max.x, _save->getWidth() - 1);
+	max.y = std::min(max.y, _save->getLength() - 1);
+
+	for (int x = min.x; x <= max.x; ++x)
+	{
+		for (int y = min.y; y <= max.y; ++y)
 		{
-			if ((*i)->getFaction() == FACTION_PLAYER && !(*i)->isOut())
+			for (int z = 0; z < _save->getHeight(); ++z)
 			{
-				addLight((*i)->getPosition(), personalLightPower, layer);
+				_save->getTile(Position(x, y, z))->resetLight(layer);
 			}
 		}
 	}
+
+	for (std::vector<LightSource>::iterator i = _lightSources[layer].begin(); i != _lightSources[layer].end(); ++i)
+	{
+		if (i->pos.x - i->power <= max.x && i->pos.x + i->power >= min.x
+			&& i->pos.y - i->power <= max.y && i->pos.y + i->power >= min.y)
+		{
+			addLight(i->pos, i->power, layer, min, max);
+		}
+	}
 }
 
 /**
  * Adds circular light pattern starting from center and loosing power with distance travelled.
+ * Only tiles within the given area are lit.
  * @param center
  * @param power
  * @param layer Light is seperated in 3 layers: Ambient, Static and Dynamic.
+ * @param min Top left corner of the area, all levels, within the map.
+ * @param max Bottom right corner of the area, all levels, within the map.
  */
-void TileEngine::addLight(const Position &center, int power, int layer)
+void TileEngine::addLight(const Position &center, int power, int layer, const Position &min, const Position &max)
 {
-	// only loop through the positive quadrant.
-	for (int x = 0; x <= power; ++x)
+	const std::vector<LightStep> &stamp = getLightStamp(power);
+	const int width = _save->getWidth();
+	const int levelSize = width * _save->getLength();
+	const int height = _save->getHeight();
+	Uint8 *light = _save->getTileGrid()->getLight(layer);
+
+	for (std::vector<LightStep>::const_iterator i = stamp.begin(); i != stamp.end(); ++i)
 	{
-		for (int y = 0; y <= power; ++y)
+		int x = center.x + i->x;
+		int y = center.y + i->y;
+		if (x < min.x || x > max.x || y < min.y || y > max.y)
+			continue;
+		Uint8 *current = light + y * width + x;
+		for (int z = 0; z < height; ++z, current += levelSize)
 		{
-			for (int z = 0; z < _save->getHeight(); z++)
+			if (*current < i->light)
+				*current = i->light;
+		}
+	}
+}
+
+/**
+ * Gets the light falloff pattern of a light source, built the first time
+ * a source of that power shows up: every offset that gets some light,
+ * with the light it gets.
+ * @param power Power of the light source.
+ * @return List of lit offsets.
+ */
+const std::vector<TileEngine::LightStep> &TileEngine::getLightStamp(int power)
+{
+	power = std::max(power, 0);
+	if (power >= (int)_lightStamps.size())
+	{
+		_lightStamps.resize(power + 1);
+	}
+	std::vector<LightStep> &stamp = _lightStamps[power];
+	if (stamp.empty())
+	{
+		for (int x = -power; x <= power; ++x)
+		{
+			for (int y = -power; y <= power; ++y)
 			{
 				int distance = int(floor(sqrt(float(x*x + y*y)) + 0.5));
-
-				if (_save->getTile(Position(center.x + x,center.y + y, z)))
-					_save->getTile(Position(center.x + x,center.y + y, z))->addLight(power - distance, layer);
-
-				if (_save->getTile(Position(center.x - x,center.y - y, z)))
-					_save->getTile(Position(center.x - x,center.y - y, z))->addLight(power - distance, layer);
-
-				if (_save->getTile(Position(center.x - x,center.y + y, z)))
-					_save->getTile(Position(center.x - x,center.y + y, z))->addLight(power - distance, layer);
-
-				if (_save->getTile(Position(center.x + x,center.y - y, z)))
-					_save->getTile(Position(center.x + x,center.y - y, z))->addLight(power - distance, layer);
+				// tiles never get darker than 0, so there is no point in adding those
+				if (power - distance > 0)
+				{
+					LightStep step;
+					step.x = x;
+					step.y = y;
+					step.light = power - distance;
+					stamp.push_back(step);
+				}
 			}
 		}
 	}
+	return stamp;
 }
 
 
@@ -207,13 +454,144 @@ void TileEngine::addLight(const Position &center, int power, int layer)
  */
 bool TileEngine::calculateFOV(BattleUnit *unit)
 {
-	size_t visibleUnitsChecksum = 0, oldNumVisibleUnits = 0;
+	Profiler::Scope profile("TileEngine::calculateFOV");
+	updateSight();
+	if (_fovs.empty())
+		_fovs.resize(1);
+	_fovs[0].sight = &_sight[unit];
+	findVisible(unit, &_fovs[0], 0);
+	indexSightLines(unit, _fovs[0].sight);
+	return applyFOV(unit, _fovs[0]);
+}
+
+/**
+ * Calculates line of sight of several units. Finding what each unit sees only
+ * reads the map, so the units are spread over the thread pool; the results are then
+ * applied one unit at a time in the order given, the same as calling
+ * calculateFOV on each of them in turn.
+ * @param units The units.
+ */
+void TileEngine::calculateFOV(const std::vector<BattleUnit*> &units)
+{
+	Profiler::Scope profile("TileEngine::calculateFOV");
+	findFOV(units);
+	for (size_t i = 0; i < units.size(); ++i)
+	{
+		applyFOV(i);
+	}
+}
+
+/**
+ * Finds what each of several units sees, spread over the thread pool, without
+ * applying it yet. Anything that changes the map or the units' positions, facings
+ * or factions before the results are applied makes them stale.
+ * @param units The units, which must outlive the matching applyFOV calls.
+ */
+void TileEngine::findFOV(const std::vector<BattleUnit*> &units)
+{
+	Profiler::Scope profile("TileEngine::findFOV");
+	updateSight();
+	if (_fovs.size() < units.size())
+		_fovs.resize(units.size());
+	// the jobs may not add to the map of remembered sight, so do that up front
+	for (size_t i = 0; i < units.size(); ++i)
+	{
+		_fovs[i].sight = &_sight[units[i]];
+	}
+	_fovUnits = &units;
+	_threadPool->run(findVisibleJob, this, units.size());
+	for (size_t i = 0; i < units.size(); ++i)
+	{
+		indexSightLines(units[i], _fovs[i].sight);
+	}
+}
+
+/**
+ * Applies what one of the units passed to the last findFOV saw.
+ * @param index Index of the unit in that list.
+ * @return True when new aliens were spotted.
+ */
+bool TileEngine::applyFOV(size_t index)
+{
+	return applyFOV(_fovUnits->at(index), _fovs[index]);
+}
+
+/**
+ * Finds the units and tiles in a unit's line of sight, without changing them.
+ * @param unit The unit.
+ * @param fov Lists to store what the unit sees in.
+ * @param worker Index of the thread pool worker doing this, for its scratch space.
+ */
+void TileEngine::findVisible(BattleUnit *unit, FieldOfView *fov, int worker)
+{
 	Position center = unit->getPosition();
 	Position test;
-	bool swap = (unit->getDirection()==0 || unit->getDirection()==4);
-	int signX[8] = { +1, +1, +1, +1, -1, -1, -1, -1 };
-	int signY[8] = { -1, -1, -1, +1, +1, +1, -1, -1 };
-	int y1, y2;
+
+	fov->visibleUnits.clear();
+	fov->spottedUnits.clear();
+	fov->discoveredTiles.clear();
+
+	if (unit->isOut())
+		return;
+
+	const std::vector<Position> &targets = _viewCone->getTargets(unit->getDirection());
+	for (std::vector<Position>::const_iterator i = targets.begin(); i != targets.end(); ++i)
+	{
+		for (int z = 0; z < _save->getHeight(); z++)
+		{
+			test = Position(center.x + i->x, center.y + i->y, z);
+			Tile *tile = _save->getTile(test);
+			if (tile)
+			{
+				BattleUnit *visibleUnit = tile->getUnit();
+				if (visibleUnit && !visibleUnit->isOut() && lineOfSight(unit, tile, fov->sight))
+				{
+					if ((visibleUnit->getFaction() == FACTION_HOSTILE && unit->getFaction() != FACTION_HOSTILE)
+						|| (visibleUnit->getFaction() != FACTION_HOSTILE && unit->getFaction() == FACTION_HOSTILE))
+					{
+						fov->visibleUnits.push_back(visibleUnit);
+					}
+					if (unit->getFaction() == FACTION_PLAYER)
+						fov->spottedUnits.push_back(visibleUnit);
+				}
+			}
+		}
+	}
+
+	// this sets tiles to discovered if they are in LOS - tile visibility is not calculated in voxelspace but in tilespace
+	// nothing new can be discovered unless the soldier or the terrain changed since the last time
+	UnitSight *sight = fov->sight;
+	if (unit->getFaction() == FACTION_PLAYER
+		&& (sight->position != center || sight->direction != unit->getDirection() || sight->terrain != _terrainVersion))
+	{
+		discoverTiles(unit, &_coneTiles[worker], &fov->discoveredTiles);
+		sight->position = center;
+		sight->direction = unit->getDirection();
+		sight->terrain = _terrainVersion;
+	}
+}
+
+/**
+ * Runs findVisible for one unit of a calculateFOV batch.
+ * @param engine Pointer to the TileEngine.
+ * @param job Index of the unit.
+ * @param worker Index of the thread pool worker.
+ */
+void TileEngine::findVisibleJob(void *engine, int job, int worker)
+{
+	TileEngine *self = (TileEngine*)engine;
+	self->findVisible(self->_fovUnits->at(job), &self->_fovs[job], worker);
+}
+
+/**
+ * Updates a unit, the units it sees and the tiles it discovers with what it sees.
+ * @param unit The unit.
+ * @param fov What the unit sees.
+ * @return true when new aliens spotted
+ */
+bool TileEngine::applyFOV(BattleUnit *unit, const FieldOfView &fov)
+{
+	size_t visibleUnitsChecksum = 0, oldNumVisibleUnits = 0;
 
 	// calculate a visible units checksum - if it changed during this step, the soldier stops walking
 	// the unit's Xposition * 100 + y seems a simple but unique ID for each unit
@@ -222,86 +600,311 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
 
 	oldNumVisibleUnits = unit->getVisibleUnits()->size();
 
+	// the other way around, the units seen keep track of who sees them
+	for (std::vector<BattleUnit*>::iterator i = unit->getVisibleUnits()->begin(); i != unit->getVisibleUnits()->end(); ++i)
+	{
+		std::vector<BattleUnit*> &spotters = _spotters[*i];
+		spotters.erase(std::remove(spotters.begin(), spotters.end(), unit), spotters.end());
+	}
 	unit->clearVisibleUnits();
 
 	if (unit->isOut())
 		return false;
 
-	for (int x = 0; x <= MAX_VIEW_DISTANCE; ++x)
+	for (std::vector<BattleUnit*>::const_iterator i = fov.visibleUnits.begin(); i != fov.visibleUnits.end(); ++i)
 	{
-		if (unit->getDirection()%2)
+		if (unit->addToVisibleUnits(*i))
+			_spotters[*i].push_back(unit);
+	}
+	for (std::vector<BattleUnit*>::const_iterator i = fov.spottedUnits.begin(); i != fov.spottedUnits.end(); ++i)
+		(*i)->setVisible(true);
+	for (std::vector<Tile*>::const_iterator i = fov.discoveredTiles.begin(); i != fov.discoveredTiles.end(); ++i)
+		discoverTile(*i);
+
+	int newChecksum = 0;
+	for (std::vector<BattleUnit*>::iterator i = unit->getVisibleUnits()->begin(); i != unit->getVisibleUnits()->end(); ++i)
+		newChecksum += (*i)->getPosition().x*100 + (*i)->getPosition().y;
+
+	// we only react when there are at least the same amount of visible units as before AND the checksum is different
+	// this way we stop if there are the same amount of visible units, but a different unit is seen
+	// or we stop if there are more visible units seen
+	if (visibleUnitsChecksum != newChecksum && unit->getVisibleUnits()->size() >= oldNumVisibleUnits && unit->getVisibleUnits()->size() > 0)
+	{
+		aggroOnSight(unit);
+		return true;
+	}
+
+	return false;
+
+}
+
+/**
+ * Makes a unit that sees a new unit aggro: a hostile unit, or a soldier
+ * played by the AI, will go for it and not start walking.
+ * @param unit The unit.
+ */
+void TileEngine::aggroOnSight(BattleUnit *unit)
+{
+	if (unit->getFaction() == FACTION_HOSTILE || (unit->getFaction() == FACTION_PLAYER && unit->getCurrentAIState()))
+	{
+		AggroBAIState *aggro = dynamic_cast<AggroBAIState*>(unit->getCurrentAIState());
+		if (aggro == 0)
 		{
-			y1 = 0;
-			y2 = MAX_VIEW_DISTANCE - x;
+			aggro = new AggroBAIState(_save, unit);
+			unit->setAIState(aggro);
 		}
-		else
+		aggro->setAggroTarget(unit->getVisibleUnits()->at(0)); // just pick the first one - maybe we need to prioritize on distance to unit or other parameters?
+	}
+}
+
+
+/**
+ * Finds all tiles in a soldier's line of sight. Walks the precomputed
+ * sight lines of the view cone, stopping each line at the first blocked step,
+ * which gives the same result as tracing calculateLine to every tile in view.
+ * @param unit The soldier.
+ * @param coneTiles Scratch space for the tiles along the sight lines.
+ * @param discovered List to store the tiles to set discovered in.
+ */
+void TileEngine::discoverTiles(BattleUnit *unit, std::vector<Tile*> *coneTiles, std::vector<Tile*> *discovered)
+{
+	const Position center = unit->getPosition();
+	const Position mapSize(_save->getWidth(), _save->getLength(), _save->getHeight());
+	const int direction = unit->getDirection();
+	const std::vector<ViewCone::Node> &lines = _viewCone->getLines(direction);
+	std::vector<Tile*> &tiles = *coneTiles;
+
+	tiles.resize(lines.size());
+	tiles[0] = _save->getTile(center);
+	discovered->push_back(tiles[0]);
+
+	for (int i = 1; i < (int)lines.size();)
+	{
+		const ViewCone::Node &node = lines[i];
+		Tile *tile = _save->getTile(Position(center.x + node.x, center.y + node.y, center.z + node.z));
+		// lines leaving the map never come back, so the whole subtree can be skipped
+		if (!tile
+			|| horizontalBlockage(tiles[node.parent], tile, DT_NONE) + verticalBlockage(tiles[node.parent], tile, DT_NONE) != 0)
+		{
+			i = node.end;
+			continue;
+		}
+		if (_viewCone->reachesMap(direction, i, center, mapSize))
 		{
-			y1 = -x;
-			y2 = x;
+			discovered->push_back(tile);
 		}
-		for (int y = y1; y <= y2; ++y)
+		tiles[i] = tile;
+		++i;
+	}
+}
+
+/**
+ * Forgets the lines of sight of units stepping onto or off tiles since the
+ * last time, and of lines passing through those tiles, as units block sight.
+ */
+void TileEngine::updateSight()
+{
+	std::vector<int> *changes = _save->getTileGrid()->getUnitChanges();
+	if (changes->empty())
+		return;
+	for (std::vector<int>::iterator i = changes->begin(); i != changes->end(); ++i)
+	{
+		const Position &pos = _save->getTiles()[*i]->getPosition();
+		invalidateSightLines(pos, pos);
+	}
+	changes->clear();
+}
+
+/**
+ * Forgets the lines of sight passing through an area, because something
+ * that blocks sight changed there: terrain, smoke or a unit. Only the lines
+ * indexed under the tiles of the area are visited. The units and tiles they
+ * lead to are remembered, for updateSpotters to look at again.
+ * @param min Lowest corner of the area, in tiles.
+ * @param max Highest corner of the area, in tiles.
+ */
+void TileEngine::invalidateSightLines(const Position &min, const Position &max)
+{
+	if (_sightTiles.empty())
+		return;
+	Position from(std::max(min.x, 0), std::max(min.y, 0), std::max(min.z, 0));
+	Position to(std::min(max.x, _save->getWidth() - 1), std::min(max.y, _save->getLength() - 1), std::min(max.z, _save->getHeight() - 1));
+	for (int z = from.z; z <= to.z; ++z)
+	{
+		for (int y = from.y; y <= to.y; ++y)
 		{
-			for (int z = 0; z < _save->getHeight(); z++)
+			for (int x = from.x; x <= to.x; ++x)
 			{
-				int distance = int(floor(sqrt(float(x*x + y*y)) + 0.5));
-				test.z = z;
-				if (distance <= MAX_VIEW_DISTANCE)
+				std::vector<SightKey> &keys = _sightTiles[_save->getTileIndex(Position(x, y, z))];
+				for (std::vector<SightKey>::const_iterator i = keys.begin(); i != keys.end(); ++i)
 				{
-					test.x = center.x + signX[unit->getDirection()]*(swap?y:x);
-					test.y = center.y + signY[unit->getDirection()]*(swap?x:y);
-					if (_save->getTile(test))
+					std::map<BattleUnit*, UnitSight>::iterator sight = _sight.find(i->unit);
+					if (sight == _sight.end())
+						continue;
+					std::map<int, SightLine>::iterator line = sight->second.lines.find(i->target);
+					// keys of lines traced again since, or already forgotten, are left over
+					if (line != sight->second.lines.end() && line->second.stamp == i->stamp)
 					{
-						BattleUnit *visibleUnit = _save->getTile(test)->getUnit();
-						if (visibleUnit && !visibleUnit->isOut() && visible(unit, _save->getTile(test)))
-						{
-							if ((visibleUnit->getFaction() == FACTION_HOSTILE && unit->getFaction() != FACTION_HOSTILE)
-								|| (visibleUnit->getFaction() != FACTION_HOSTILE && unit->getFaction() == FACTION_HOSTILE))
-							{
-								unit->addToVisibleUnits(visibleUnit);
-							}
-							if (unit->getFaction() == FACTION_PLAYER)
-								visibleUnit->setVisible(true);
-						}
-
-						if (unit->getFaction() == FACTION_PLAYER)
-						{
-							// this sets tiles to discovered if they are in LOS - tile visibility is not calculated in voxelspace but in tilespace
-							calculateLine(unit->getPosition(), test, false, 0, unit, false);
-						}
+						sight->second.lines.erase(line);
+						_changedSight.push_back(std::make_pair(i->unit, i->target));
 					}
 				}
+				_sightKeys -= keys.size();
+				keys.clear();
 			}
 		}
 	}
+}
 
-	int newChecksum = 0;
-	for (std::vector<BattleUnit*>::iterator i = unit->getVisibleUnits()->begin(); i != unit->getVisibleUnits()->end(); ++i)
-		newChecksum += (*i)->getPosition().x*100 + (*i)->getPosition().y;
+/**
+ * Forgets all lines of sight, and makes soldiers discover tiles again
+ * (for changes all over the map, like smoke drifting at a new turn).
+ * Who sees whom is kept; that only changes when the units' views are
+ * calculated again.
+ */
+void TileEngine::invalidateSight()
+{
+	_save->getTileGrid()->getUnitChanges()->clear();
+	_sight.clear();
+	for (std::vector<std::vector<SightKey> >::iterator i = _sightTiles.begin(); i != _sightTiles.end(); ++i)
+	{
+		i->clear();
+	}
+	_sightKeys = 0;
+	_changedSight.clear();
+	++_terrainVersion;
+}
 
-	// we only react when there are at least the same amount of visible units as before AND the checksum is different
-	// this way we stop if there are the same amount of visible units, but a different unit is seen
-	// or we stop if there are more visible units seen
-	if (visibleUnitsChecksum != newChecksum && unit->getVisibleUnits()->size() >= oldNumVisibleUnits && unit->getVisibleUnits()->size() > 0)
+/**
+ * Finds the tiles something blocking sight could be in for a line of sight
+ * to matter. Every ray runs between the centers of the two tiles in x and y,
+ * straying a voxel at most; in height they reach into the level above the eyes
+ * and the level below, where a unit may stick out.
+ * @param origin Position of the unit's eyes, in tiles.
+ * @param target Position of the tile seen.
+ * @param tiles List to store the tile indices in.
+ */
+void TileEngine::findSightLineTiles(const Position &origin, const Position &target, std::vector<int> *tiles)
+{
+	const int margin = 2;
+	int x0 = origin.x * 16 + 8, y0 = origin.y * 16 + 8;
+	int dx = (target.x - origin.x) * 16, dy = (target.y - origin.y) * 16;
+	int steps = std::max(std::max(abs(dx), abs(dy)), 1);
+	int width = _save->getWidth(), length = _save->getLength();
+	std::vector<int> columns;
+	for (int i = 0; i <= steps; ++i)
 	{
-		// a hostile unit will aggro on the new unit if it sees one - it will not start walking
-		if (unit->getFaction() == FACTION_HOSTILE)
+		int x = x0 + (int)floor(dx * i / (double)steps + 0.5);
+		int y = y0 + (int)floor(dy * i / (double)steps + 0.5);
+		// tiles are wider than the margin, so the corners cover every tile it touches
+		for (int c = 0; c < 4; ++c)
 		{
-			AggroBAIState *aggro = dynamic_cast<AggroBAIState*>(unit->getCurrentAIState());
-			if (aggro == 0)
-			{
-				aggro = new AggroBAIState(_save, unit);
-				unit->setAIState(aggro);
-			}
-			aggro->setAggroTarget(unit->getVisibleUnits()->at(0)); // just pick the first one - maybe we need to prioritize on distance to unit or other parameters?
+			int cx = (x + (c & 1 ? margin : -margin)) / 16;
+			int cy = (y + (c & 2 ? margin : -margin)) / 16;
+			if (cx >= width || cy >= length)
+				continue;
+			int column = cy * width + cx;
+			if (columns.empty() || columns.back() != column)
+				columns.push_back(column);
 		}
+	}
+	std::sort(columns.begin(), columns.end());
+	columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
 
-		return true;
+	tiles->clear();
+	int minZ = std::max(std::min(origin.z, target.z) - 1, 0);
+	int maxZ = std::min(std::max(origin.z, target.z) + 1, _save->getHeight() - 1);
+	for (std::vector<int>::const_iterator i = columns.begin(); i != columns.end(); ++i)
+	{
+		for (int z = minZ; z <= maxZ; ++z)
+		{
+			tiles->push_back(_save->getTileIndex(Position(*i % width, *i / width, z)));
+		}
 	}
+}
 
-	return false;
+/**
+ * Adds the lines a unit traced since the last time to the tile index,
+ * under every tile that can change them. Only done between the batches
+ * of units, as the units' lines are traced at the same time.
+ * @param unit The unit.
+ * @param sight What is remembered of the unit's view.
+ */
+void TileEngine::indexSightLines(BattleUnit *unit, UnitSight *sight)
+{
+	if (sight->traced.empty())
+		return;
+	if (_sightTiles.empty())
+		_sightTiles.resize(_save->getTileGrid()->getSize());
+	for (std::vector<int>::const_iterator i = sight->traced.begin(); i != sight->traced.end(); ++i)
+	{
+		std::map<int, SightLine>::const_iterator line = sight->lines.find(*i);
+		if (line == sight->lines.end())
+			continue;
+		SightKey key = { unit, *i, line->second.stamp };
+		findSightLineTiles(line->second.origin, _save->getTiles()[*i]->getPosition(), &_sightLineTiles);
+		for (std::vector<int>::const_iterator t = _sightLineTiles.begin(); t != _sightLineTiles.end(); ++t)
+		{
+			_sightTiles[*t].push_back(key);
+		}
+		_sightKeys += _sightLineTiles.size();
+	}
+	sight->traced.clear();
+	if (_sightKeys > _sightKeysLimit)
+		reindexSightLines();
+}
 
+/**
+ * Builds the tile index of the lines of sight anew, to get rid of the keys
+ * left over by lines traced again, which pile up under tiles nothing changes in.
+ */
+void TileEngine::reindexSightLines()
+{
+	for (std::vector<std::vector<SightKey> >::iterator i = _sightTiles.begin(); i != _sightTiles.end(); ++i)
+	{
+		i->clear();
+	}
+	_sightKeys = 0;
+	for (std::map<BattleUnit*, UnitSight>::iterator i = _sight.begin(); i != _sight.end(); ++i)
+	{
+		std::vector<int> &traced = i->second.traced;
+		traced.clear();
+		for (std::map<int, SightLine>::const_iterator j = i->second.lines.begin(); j != i->second.lines.end(); ++j)
+		{
+			traced.push_back(j->first);
+		}
+		indexSightLines(i->first, &i->second);
+	}
+	// twice what's in use, so building it again costs no more than the keys added since
+	_sightKeysLimit = std::max(_sightKeys * 2, (size_t)65536);
 }
 
+/**
+ * Forgets what was seen through an area where terrain changed,
+ * so soldiers discover tiles again.
+ * @param min Lowest corner of the area, in tiles.
+ * @param max Highest corner of the area, in tiles.
+ */
+void TileEngine::terrainChanged(const Position &min, const Position &max)
+{
+	invalidateSightLines(min, max);
+	++_terrainVersion;
+}
+
+/**
+ * Sets a tile in line of sight to discovered.
+ * @param tile The tile.
+ */
+void TileEngine::discoverTile(Tile *tile)
+{
+	const Position &pos = tile->getPosition();
+	tile->setDiscovered(true, 2);
+	// walls to the east or south of a visible tile, we see that too
+	Tile* t = _save->getTile(Position(pos.x + 1, pos.y, pos.z));
+	if (t) t->setDiscovered(true, 0);
+	t = _save->getTile(Position(pos.x, pos.y + 1, pos.z));
+	if (t) t->setDiscovered(true, 1);
+}
 
 /**
  * Check for an opposing unit on this tile
@@ -309,6 +912,24 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
  * @param tile the tile to check for
  */
 bool TileEngine::visible(BattleUnit *currentUnit, Tile *tile)
+{
+	updateSight();
+	UnitSight *sight = &_sight[currentUnit];
+	bool seen = lineOfSight(currentUnit, tile, sight);
+	indexSightLines(currentUnit, sight);
+	return seen;
+}
+
+/**
+ * Checks if a unit can see a tile, using the remembered line of sight if nothing
+ * changed along it. Only the unit's own remembered sight is changed, so this is
+ * safe to run for different units at once.
+ * @param unit The watcher.
+ * @param tile The tile to check for.
+ * @param sight What is remembered of the unit's view.
+ * @return True if the tile is in sight.
+ */
+bool TileEngine::lineOfSight(BattleUnit *unit, Tile *tile, UnitSight *sight)
 {
 	// if the tile is too dark, we can't see it
 	if (!tile || tile->getShade() > MAX_DARKNESS_TO_SEE_UNITS)
@@ -316,6 +937,32 @@ bool TileEngine::visible(BattleUnit *currentUnit, Tile *tile)
 		return false;
 	}
 
+	const Position &origin = unit->getPosition();
+	const Position &target = tile->getPosition();
+	int index = _save->getTileIndex(target);
+	std::map<int, SightLine>::iterator i = sight->lines.find(index);
+	if (i != sight->lines.end() && i->second.origin == origin)
+	{
+		return i->second.seen;
+	}
+
+	SightLine &line = sight->lines[index];
+	line.origin = origin;
+	line.stamp = ++sight->stamp;
+	line.seen = traceLineOfSight(unit, tile);
+	sight->traced.push_back(index);
+	return line.seen;
+}
+
+/**
+ * Traces the rays from a unit's eyes to a tile, to see if the unit on it
+ * (or a unit that would stand there) can be seen.
+ * @param currentUnit the watcher
+ * @param tile the tile to check for
+ * @return True if the tile is in sight.
+ */
+bool TileEngine::traceLineOfSight(BattleUnit *currentUnit, Tile *tile)
+{
 	// determine the origin and target voxels for the raytrace
 	Position originVoxel, targetVoxel;
 	std::vector<Position> _trajectory;
@@ -396,13 +1043,151 @@ bool TileEngine::visible(BattleUnit *currentUnit, Tile *tile)
  */
 void TileEngine::calculateFOV(const Position &position)
 {
+	Profiler::Scope profile("TileEngine::calculateFOV");
+	calculateFOV(position, position);
+}
+
+/**
+ * Calculates line of sight of the soldiers within range of an area
+ * (used when terrain has changed, which can reveal new parts of terrain or units)
+ * @param min Lowest corner of the changed area.
+ * @param max Highest corner of the changed area.
+ */
+void TileEngine::calculateFOV(const Position &min, const Position &max)
+{
+	Profiler::Scope profile("TileEngine::calculateFOV");
+	std::vector<BattleUnit*> units;
 	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
 	{
-		if (distance(position, (*i)->getPosition()) < 20 && (*i)->getFaction() == _save->getSide())
+		// the distance to the closest point of the area
+		const Position &pos = (*i)->getPosition();
+		Position closest(std::min(std::max(pos.x, min.x), max.x), std::min(std::max(pos.y, min.y), max.y), pos.z);
+		if (distance(closest, pos) < 20 && (*i)->getFaction() == _save->getSide())
+		{
+			units.push_back(*i);
+		}
+	}
+	calculateFOV(units);
+}
+
+/**
+ * Orders lines of sight by unit and tile, the same way every run.
+ * @param a A unit and the tile its line leads to.
+ * @param b Another.
+ * @return True if a comes first.
+ */
+static bool compareSightLines(const std::pair<BattleUnit*, int> &a, const std::pair<BattleUnit*, int> &b)
+{
+	if (a.first->getId() != b.first->getId())
+		return a.first->getId() < b.first->getId();
+	return a.second < b.second;
+}
+
+/**
+ * Checks if a unit sees another unit, the same way finding everything
+ * in its view does for each tile the other unit stands on.
+ * @param spotter The watcher.
+ * @param unit The unit to check for.
+ * @return True if any part of the unit is in sight.
+ */
+bool TileEngine::seesUnit(BattleUnit *spotter, BattleUnit *unit)
+{
+	if (spotter->isOut() || unit->isOut())
+		return false;
+	UnitSight *sight = &_sight[spotter];
+	const Position &center = spotter->getPosition();
+	int size = unit->getArmor()->getSize();
+	bool seen = false;
+	for (int x = 0; x < size && !seen; ++x)
+	{
+		for (int y = 0; y < size && !seen; ++y)
 		{
-			calculateFOV(*i);
+			Position pos = unit->getPosition() + Position(x, y, 0);
+			Tile *tile = _save->getTile(pos);
+			if (tile && tile->getUnit() == unit && _viewCone->inView(spotter->getDirection(), pos.x - center.x, pos.y - center.y))
+			{
+				seen = lineOfSight(spotter, tile, sight);
+			}
 		}
 	}
+	indexSightLines(spotter, sight);
+	return seen;
+}
+
+/**
+ * Updates whether one unit sees another, on both sides of who sees whom,
+ * without going over everything else in its view.
+ * @param spotter The watcher.
+ * @param unit The unit to check for.
+ */
+void TileEngine::updateSpotter(BattleUnit *spotter, BattleUnit *unit)
+{
+	// only units of factions against each other keep track of seeing each other,
+	// but soldiers make everything they see visible
+	bool opposed = (spotter->getFaction() == FACTION_HOSTILE) != (unit->getFaction() == FACTION_HOSTILE);
+	if (!opposed && spotter->getFaction() != FACTION_PLAYER)
+		return;
+	bool seen = seesUnit(spotter, unit);
+	if (seen && spotter->getFaction() == FACTION_PLAYER)
+		unit->setVisible(true);
+	if (!opposed)
+		return;
+	std::vector<BattleUnit*> *visibleUnits = spotter->getVisibleUnits();
+	std::vector<BattleUnit*> &spotters = _spotters[unit];
+	std::vector<BattleUnit*>::iterator i = std::find(visibleUnits->begin(), visibleUnits->end(), unit);
+	if (seen && i == visibleUnits->end())
+	{
+		visibleUnits->push_back(unit);
+		spotters.push_back(spotter);
+		aggroOnSight(spotter);
+	}
+	else if (!seen && i != visibleUnits->end())
+	{
+		visibleUnits->erase(i);
+		spotters.erase(std::remove(spotters.begin(), spotters.end(), spotter), spotters.end());
+	}
+}
+
+/**
+ * Updates who sees a unit that moved: every unit that could see it checks
+ * again, mostly along lines it already knows, and units seen along the lines
+ * the move crossed are checked again by the units at the other end.
+ * Nothing else in anyone's view can have changed.
+ * @param unit The unit.
+ */
+void TileEngine::updateSpotters(BattleUnit *unit)
+{
+	Profiler::Scope profile("TileEngine::updateSpotters");
+	updateSight();
+	std::vector<std::pair<BattleUnit*, int> > changed;
+	changed.swap(_changedSight);
+	std::sort(changed.begin(), changed.end(), compareSightLines);
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+	for (std::vector<std::pair<BattleUnit*, int> >::const_iterator i = changed.begin(); i != changed.end(); ++i)
+	{
+		BattleUnit *seen = _save->getTiles()[i->second]->getUnit();
+		if (seen && seen != unit && seen != i->first)
+		{
+			updateSpotter(i->first, seen);
+		}
+	}
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		if (*i != unit && !(*i)->isOut())
+		{
+			updateSpotter(*i, unit);
+		}
+	}
+}
+
+/**
+ * Gets the units that have a unit in their list of visible units.
+ * @param unit The unit.
+ * @return List of units, some of which may be out by now.
+ */
+const std::vector<BattleUnit*> &TileEngine::getSpotters(BattleUnit *unit)
+{
+	return _spotters[unit];
 }
 
 /**
@@ -411,7 +1196,7 @@ void TileEngine::calculateFOV(const Position &position)
  * @param unit
  * @param action
  * @param potentialVictim The unit that is targeted when shot.
- * @param recalculateFOV Whether to recalculate first the FOV of the units within range.
+ * @param recalculateFOV Whether to update first who sees the unit.
  */
 bool TileEngine::checkReactionFire(BattleUnit *unit, BattleAction *action, BattleUnit *potentialVictim, bool recalculateFOV)
 {
@@ -424,13 +1209,17 @@ bool TileEngine::checkReactionFire(BattleUnit *unit, BattleAction *action, Battl
 		return false;
 	}
 
-	if (potentialVictim && RNG::generate(0, 4) == 1 && potentialVictim->getFaction() == FACTION_HOSTILE)
+	if (potentialVictim && RNG::generate(0, 4, RNG::COMBAT) == 1 && potentialVictim->getFaction() == FACTION_HOSTILE)
 	{
 		potentialVictim->lookAt(unit->getPosition());
-		while (potentialVictim->getStatus() == STATUS_TURNING)
+		if (potentialVictim->getStatus() == STATUS_TURNING)
 		{
+			while (potentialVictim->getStatus() == STATUS_TURNING)
+			{
+				potentialVictim->turn();
+			}
+			calculateFOV(potentialVictim);
 			recalculateFOV = true;
-			potentialVictim->turn();
 		}
 		// if the potentialVictim is hostile, he will aggro if he wasn't already or at least change aggro target
 		if (potentialVictim->getFaction() == FACTION_HOSTILE)
@@ -449,23 +1238,21 @@ bool TileEngine::checkReactionFire(BattleUnit *unit, BattleAction *action, Battl
 	// we reset the unit to false here - if it is seen by any unit in range below the unit becomes visible again
 	//unit->setVisible(false);
 
-	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	// only the pairs the unit is in, and the lines of sight it moved through, are looked at again
+	if (recalculateFOV)
+	{
+		updateSpotters(unit);
+	}
+
+	const std::vector<BattleUnit*> &spotters = getSpotters(unit);
+	for (std::vector<BattleUnit*>::const_iterator i = spotters.begin(); i != spotters.end(); ++i)
 	{
-		if (distance(unit->getPosition(), (*i)->getPosition()) < 19 && (*i)->getFaction() != _save->getSide() && !(*i)->isOut())
+		if (distance(unit->getPosition(), (*i)->getPosition()) < 19 && (*i)->getFaction() != _save->getSide() && !(*i)->isOut()
+			&& (*i)->getReactionScore() > highestReactionScore)
 		{
-			if (recalculateFOV)
-			{
-				calculateFOV(*i);
-			}
-			for (std::vector<BattleUnit*>::iterator j = (*i)->getVisibleUnits()->begin(); j != (*i)->getVisibleUnits()->end(); ++j)
-			{
-				if ((*j) == unit && (*i)->getReactionScore() > highestReactionScore)
-				{
-					// I see you!
-					highestReactionScore = (*i)->getReactionScore();
-					action->actor = (*i);
-				}
-			}
+			// I see you!
+			highestReactionScore = (*i)->getReactionScore();
+			action->actor = (*i);
 		}
 	}
 
@@ -513,13 +1300,13 @@ void TileEngine::hit(const Position &center, int power, ItemDamageType type, Bat
 	if (part >= 0 && part <= 3)
 	{
 		// power 25% to 75%
-		int rndPower = RNG::generate(power/4, (power*3)/4); //RNG::boxMuller(power, power/6)
+		int rndPower = RNG::generate(power/4, (power*3)/4, RNG::COMBAT); //RNG::boxMuller(power, power/6)
 		tile->damage(part, rndPower);
 	}
 	else if (part == 4)
 	{
 		// power 0 - 200%
-		int rndPower = RNG::generate(0, power*2); // RNG::boxMuller(power, power/3)
+		int rndPower = RNG::generate(0, power*2, RNG::COMBAT); // RNG::boxMuller(power, power/3)
 		BattleUnit *bu = tile->getUnit();
 		if (bu)
 		{
@@ -542,14 +1329,18 @@ void TileEngine::hit(const Position &center, int power, ItemDamageType type, Bat
 		// conventional weapons can cause additional stun damage
 		if (type == DT_AP && bu)
 		{
-			bu->damage(Position(center.x%16, center.y%16, center.z%24), RNG::generate(0, rndPower/4), DT_STUN, true);
+			bu->damage(Position(center.x%16, center.y%16, center.z%24), RNG::generate(0, rndPower/4, RNG::COMBAT), DT_STUN, true);
 		}
 
 		unit->addFiringExp();
 	}
-	calculateSunShading(); // roofs could have been destroyed
+	Position column(center.x/16, center.y/16, 0);
+	calculateSunShading(column, column); // roofs could have been destroyed
+	Position hitTile(center.x/16, center.y/16, center.z/24);
+	terrainChanged(hitTile, hitTile);
 	calculateFOV(center);
 	calculateTerrainLighting(); // fires could have been started
+	_save->getPathfinding()->invalidateTerrain(hitTile, hitTile);
 }
 
 /**
@@ -563,106 +1354,153 @@ void TileEngine::hit(const Position &center, int power, ItemDamageType type, Bat
  */
 void TileEngine::explode(const Position &center, int power, ItemDamageType type, int maxRadius)
 {
-	double centerZ = (int)(center.z / 24) + 0.5;
-	double centerX = (int)(center.x / 16) + 0.5;
-	double centerY = (int)(center.y / 16) + 0.5;
+	const Position centerTile(center.x / 16, center.y / 16, center.z / 24);
 	int power_;
-	std::set<Tile*> tilesAffected;
-	std::pair<std::set<Tile*>::iterator,bool> ret;
+	std::vector<Tile*> tilesAffected;
+	Position areaMin(_save->getWidth(), _save->getLength(), 0), areaMax(-1, -1, 0);
 
 	if (type == DT_IN)
 	{
 		power /= 2;
 	}
 
-	for (int fi = -90; fi <= 90; fi += 10)
+	// every ray has left the map by then, so the table doesn't need to be longer
+	maxRadius = std::min(maxRadius, 2 * std::max(_save->getWidth(), _save->getLength()));
+	if (_explosionRayLength <= maxRadius)
 	{
-		// raytrace every 3 degrees makes sure we cover all tiles in a circle.
-		for (int te = 0; te <= 360; te += 3)
-		{
-			double cos_te = cos(te * M_PI / 180.0);
-			double sin_te = sin(te * M_PI / 180.0);
-			double sin_fi = sin(fi * M_PI / 180.0);
+		buildExplosionRays(maxRadius + 1);
+	}
+	_explosionVisited.resize(_save->getWidth() * _save->getLength() * _save->getHeight(), 0);
 
-			Tile *origin = _save->getTile(center);
-			double l = 0;
-			double vx, vy, vz;
-			int tileX, tileY, tileZ;
-			power_ = power + 1;
+	// rays every 10 degrees up and down and every 3 degrees around make sure we cover all tiles in a circle.
+	for (int ray = 0; ray < EXPLOSION_RAYS; ++ray)
+	{
+		const RayStep *step = &_explosionRays[ray * _explosionRayLength];
+		Tile *origin = _save->getTile(center);
+		int l = 0;
+		power_ = power + 1;
 
-			while (power_ > 0 && l <= maxRadius)
-			{
-				vx = centerX + l * cos_te;
-				vy = centerY + l * sin_te;
-				vz = centerZ + (l / 2.0) * sin_fi;
+		while (power_ > 0 && l <= maxRadius)
+		{
+			int tileX = centerTile.x + step[l].x;
+			int tileY = centerTile.y + step[l].y;
+			int tileZ = centerTile.z + step[l].z;
 
-				tileZ = int(floor(vz));
-				tileX = int(floor(vx));
-				tileY = int(floor(vy));
+			Tile *dest = _save->getTile(Position(tileX, tileY, tileZ));
+			if (!dest) break; // out of map!
 
-				Tile *dest = _save->getTile(Position(tileX, tileY, tileZ));
-				if (!dest) break; // out of map!
+			// horizontal blockage by walls
+			power_ -= (horizontalBlockage(origin, dest, type) + verticalBlockage(origin, dest, type));
 
-				// horizontal blockage by walls
-				power_ -= (horizontalBlockage(origin, dest, type) + verticalBlockage(origin, dest, type));
+			if (power_ > 0)
+			{
+				if (type == DT_HE)
+				{
+					// explosives do 1/2 damage to terrain and 1/2 up to 3/2 random damage to units
+					dest->setExplosive(power_ / 2);
+				}
 
-				if (power_ > 0)
+				int index = _save->getTileIndex(dest->getPosition());
+				if (!_explosionVisited[index]) // check if we had this tile already
 				{
+					_explosionVisited[index] = 1;
+					tilesAffected.push_back(dest);
+					areaMin.x = std::min(areaMin.x, tileX);
+					areaMin.y = std::min(areaMin.y, tileY);
+					areaMax.x = std::max(areaMax.x, tileX);
+					areaMax.y = std::max(areaMax.y, tileY);
 					if (type == DT_HE)
 					{
-						// explosives do 1/2 damage to terrain and 1/2 up to 3/2 random damage to units
-						dest->setExplosive(power_ / 2);
+						// power 50 - 150%
+						if (dest->getUnit())
+							dest->getUnit()->damage(Position(0, 0, 0), (int)(RNG::generate(power_/2.0, power_*1.5, RNG::COMBAT)), type);
 					}
-
-					ret = tilesAffected.insert(dest); // check if we had this tile already
-					if (ret.second)
+					if (type == DT_SMOKE)
 					{
-						if (type == DT_HE)
+						// smoke from explosions always stay 6 to 14 turns - power of a smoke grenade is 60
+						if (dest->getSmoke() < 10)
 						{
-							// power 50 - 150%
-							if (dest->getUnit())
-								dest->getUnit()->damage(Position(0, 0, 0), (int)(RNG::generate(power_/2.0, power_*1.5)), type);
+							dest->addSmoke(RNG::generate(power_/10, 14, RNG::COMBAT));
 						}
-						if (type == DT_SMOKE)
+					}
+					if (type == DT_IN && !dest->isVoid())
+					{
+						if (dest->getFire() == 0)
 						{
-							// smoke from explosions always stay 6 to 14 turns - power of a smoke grenade is 60
-							if (dest->getSmoke() < 10)
-							{
-								dest->addSmoke(RNG::generate(power_/10, 14));
-							}
+							dest->ignite();
 						}
-						if (type == DT_IN && !dest->isVoid())
+						if (dest->getUnit())
 						{
-							if (dest->getFire() == 0)
-							{
-								dest->ignite();
-							}
-							if (dest->getUnit())
-							{
-								dest->getUnit()->damage(Position(0, 0, 0), RNG::generate(0, power_/3), type); // immediate IN damage
-								dest->getUnit()->setFire(RNG::generate(1, 5)); // catch fire and burn for 1-5 rounds
-							}
+							dest->getUnit()->damage(Position(0, 0, 0), RNG::generate(0, power_/3, RNG::COMBAT), type); // immediate IN damage
+							dest->getUnit()->setFire(RNG::generate(1, 5, RNG::COMBAT)); // catch fire and burn for 1-5 rounds
 						}
 					}
 				}
-				power_ -= 10; // explosive damage decreases by 10
-				origin = dest;
-				l++;
 			}
+			power_ -= 10; // explosive damage decreases by 10
+			origin = dest;
+			l++;
 		}
 	}
+
+	if (tilesAffected.empty())
+	{
+		return;
+	}
+
+	// the tiles sit in one block in map order, so sorting the pointers gives map order
+	std::sort(tilesAffected.begin(), tilesAffected.end());
+	for (std::vector<Tile*>::iterator i = tilesAffected.begin(); i != tilesAffected.end(); ++i)
+	{
+		_explosionVisited[_save->getTileIndex((*i)->getPosition())] = 0;
+	}
+
 	// now detonate the tiles affected with HE
 	if (type == DT_HE)
 	{
-		for (std::set<Tile*>::iterator i = tilesAffected.begin(); i != tilesAffected.end(); ++i)
+		for (std::vector<Tile*>::iterator i = tilesAffected.begin(); i != tilesAffected.end(); ++i)
 		{
 			(*i)->detonate();
 		}
 	}
 
-	calculateSunShading(); // roofs could have been destroyed
-	calculateFOV(center);
+	// only what is within the blast's area could have changed
+	areaMax.z = _save->getHeight() - 1;
+	calculateSunShading(areaMin, areaMax); // roofs could have been destroyed
+	terrainChanged(areaMin, areaMax);
+	calculateFOV(areaMin, areaMax);
 	calculateTerrainLighting(); // fires could have been started
+	_save->getPathfinding()->invalidateTerrain(areaMin, areaMax);
+}
+
+/**
+ * Builds the steps of all explosion rays, as offsets from the tile the explosion
+ * starts in. Rays go out from the center of that tile, every 3 degrees around and
+ * every 10 degrees up and down, rising or falling at half the speed they spread.
+ * @param length Number of steps per ray.
+ */
+void TileEngine::buildExplosionRays(int length)
+{
+	_explosionRayLength = length;
+	_explosionRays.resize(EXPLOSION_RAYS * length);
+	int ray = 0;
+	for (int fi = -90; fi <= 90; fi += 10)
+	{
+		double sin_fi = sin(fi * M_PI / 180.0);
+		for (int te = 0; te <= 360; te += 3)
+		{
+			double cos_te = cos(te * M_PI / 180.0);
+			double sin_te = sin(te * M_PI / 180.0);
+			for (int l = 0; l < length; ++l)
+			{
+				RayStep &step = _explosionRays[ray * length + l];
+				step.x = (Sint16)floor(0.5 + l * cos_te);
+				step.y = (Sint16)floor(0.5 + l * sin_te);
+				step.z = (Sint16)floor(0.5 + (l / 2.0) * sin_fi);
+			}
+			++ray;
+		}
+	}
 }
 
 /**
@@ -673,12 +1511,10 @@ void TileEngine::explode(const Position &center, int power, ItemDamageType type,
 Tile *TileEngine::checkForTerrainExplosions()
 {
 
-	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
+	const std::vector<int> &explosive = _save->getTileGrid()->getActive(TileGrid::ACTIVE_EXPLOSIVE);
+	if (!explosive.empty())
 	{
-		if (_save->getTiles()[i]->getExplosive())
-		{
-			return _save->getTiles()[i];
-		}
+		return _save->getTiles()[explosive.front()];
 	}
 	return 0;
 }
@@ -947,7 +1783,10 @@ int TileEngine::unitOpensDoor(BattleUnit *unit)
 
 	if (door == 0 || door == 1)
 	{
+		// adjacent doors open up to 2 tiles away from the unit
+		terrainChanged(unit->getPosition() - Position(3, 3, 0), unit->getPosition() + Position(size + 2, size + 2, 0));
 		calculateFOV(unit->getPosition());
+		_save->getPathfinding()->invalidateTerrain(unit->getPosition() - Position(3, 3, 0), unit->getPosition() + Position(size + 2, size + 2, 0));
 	}
 
 	return door;
@@ -964,7 +1803,16 @@ int TileEngine::closeUfoDoors()
 	// prepare a list of tiles on fire/smoke & close any ufo doors
 	for (int i = 0; i < _save->getWidth() * _save->getLength() * _save->getHeight(); ++i)
 	{
-		doorsclosed += _save->getTiles()[i]->closeUfoDoor();
+		int closed = _save->getTiles()[i]->closeUfoDoor();
+		if (closed)
+		{
+			doorsclosed += closed;
+			_save->getPathfinding()->invalidateTerrain(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getPosition());
+		}
+	}
+	if (doorsclosed)
+	{
+		invalidateSight();
 	}
 
 	return doorsclosed;
@@ -988,6 +1836,8 @@ int TileEngine::calculateLine(const Position& origin, const Position& target, bo
 	int drift_xy, drift_xz;
 	int cx, cy, cz;
 	Position lastPoint(origin);
+	Position lastTile(-1, -1, -1);
+	bool lastTileEmpty = false;
 
 	//start and end points
 	x0 = origin.x;	 x1 = target.x;
@@ -1046,7 +1896,7 @@ int TileEngine::calculateLine(const Position& origin, const Position& target, bo
 		//passes through this point?
 		if (doVoxelCheck)
 		{
-			int result = voxelCheck(Position(cx, cy, cz), excludeUnit);
+			int result = inEmptyTile(Position(cx, cy, cz), excludeUnit, &lastTile, &lastTileEmpty) ? -1 : voxelCheck(Position(cx, cy, cz), excludeUnit);
 			if (result != -1)
 			{
 				if (!storeTrajectory && trajectory != 0)
@@ -1064,12 +1914,7 @@ int TileEngine::calculateLine(const Position& origin, const Position& target, bo
 			{
 				return result;
 			}
-			 _save->getTile(Position(cx, cy, cz))->setDiscovered(true, 2);
-			// walls to the east or south of a visible tile, we see that too
-			Tile* t = _save->getTile(Position(cx + 1, cy, cz));
-			if (t) t->setDiscovered(true, 0);
-			t = _save->getTile(Position(cx, cy + 1, cz));
-			if (t) t->setDiscovered(true, 1);
+			discoverTile(_save->getTile(Position(cx, cy, cz)));
 
 			lastPoint = Position(cx, cy, cz);
 		}
@@ -1122,6 +1967,8 @@ int TileEngine::calculateParabola(const Position& origin, const Position& target
 	int y = origin.y;
 	int z = origin.z;
 	int i = 8;
+	Position lastTile(-1, -1, -1);
+	bool lastTileEmpty = false;
 
 	while (z > 0) {
 		x = (int)((double)origin.x + (double)i * cos(te) * sin(fi));
@@ -1132,7 +1979,7 @@ int TileEngine::calculateParabola(const Position& origin, const Position& target
 			trajectory->push_back(Position(x, y, z));
 		}
 		//passes through this point?
-		int result = voxelCheck(Position(x, y, z), excludeUnit);
+		int result = inEmptyTile(Position(x, y, z), excludeUnit, &lastTile, &lastTileEmpty) ? -1 : voxelCheck(Position(x, y, z), excludeUnit);
 		if (result != -1)
 		{
 			if (!storeTrajectory && trajectory != 0)
@@ -1155,43 +2002,44 @@ int TileEngine::calculateParabola(const Position& origin, const Position& target
  */
 int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool excludeAllUnits)
 {
-
-	Tile *tile = _save->getTile(Position(voxel.x/16, voxel.y/16, voxel.z/24));
 	// check if we are not out of the map
-	if (tile == 0 || voxel.x < 0 || voxel.y < 0 || voxel.z < 0)
+	if (voxel.x < 0 || voxel.y < 0 || voxel.z < 0)
+	{
+		return 5;
+	}
+	Tile *tile = _save->getTile(Position(voxel.x >> 4, voxel.y >> 4, voxel.z / 24));
+	if (tile == 0)
 	{
 		return 5;
 	}
 
+	int x = voxel.x & 15;
+	int y = voxel.y & 15;
+	int z = voxel.z % 24;
+
 	if (!excludeAllUnits)
 	{
 		BattleUnit *unit = tile->getUnit();
 		if (unit != 0 && unit != excludeUnit)
 		{
-			if ((voxel.z%24) < (unit->getHeight()+(-tile->getTerrainLevel())) && (voxel.z%24) > (1+(-tile->getTerrainLevel())))
+			if (z < (unit->getHeight()+(-tile->getTerrainLevel())) && z > (1+(-tile->getTerrainLevel())))
 			{
-				int x = voxel.x%16;
-				int y = voxel.y%16;
-				int idx = (unit->getLoftemps() * 16) + y;
-				if ((_voxelData->at(idx) & (1 << x))==(1 << x))
+				if ((*_voxelData)[unit->getLoftemps() * 16 + y] & (1 << x))
 				{
 					return 4;
 				}
 			}
 		}
 		// sometimes there is unit on the tile below, but sticks up to this tile with his head
-		Tile *below = _save->getTile(Position(voxel.x/16, voxel.y/16, (voxel.z/24)-1));
+		Tile *below = _save->getTile(Position(voxel.x >> 4, voxel.y >> 4, (voxel.z/24)-1));
 		if (below)
 		{
 			BattleUnit *unit = below->getUnit();
 			if (unit != 0 && unit != excludeUnit)
 			{
-				if ((voxel.z%24) < ((unit->getHeight()+(-below->getTerrainLevel()))-24))
+				if (z < ((unit->getHeight()+(-below->getTerrainLevel()))-24))
 				{
-					int x = voxel.x%16;
-					int y = voxel.y%16;
-					int idx = (unit->getLoftemps() * 16) + y;
-					if ((_voxelData->at(idx) & (1 << x))==(1 << x))
+					if ((*_voxelData)[unit->getLoftemps() * 16 + y] & (1 << x))
 					{
 						return 4;
 					}
@@ -1203,23 +2051,72 @@ int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool
 	for (int i=0; i< 4; ++i)
 	{
 		MapData *mp = tile->getMapData(i);
-		if (tile->isUfoDoorOpen(i))
-			continue;
-		if (mp != 0)
+		if (mp != 0 && !tile->isUfoDoorOpen(i) && (mp->getVoxelRow(z, y) & (1 << x)))
 		{
-			int x = 15 - voxel.x%16;
-			int y = voxel.y%16;
-			int idx = (mp->getLoftID((voxel.z%24)/2)*16) + y;
-			if ((_voxelData->at(idx) & (1 << x))==(1 << x))
-			{
-				return i;
-			}
+			return i;
 		}
 	}
 	return -1;
 }
 
+/**
+ * Checks if a line can pass through a whole tile without any voxel checks:
+ * the tile is on the map, no unit stands on it or sticks up into it from below
+ * and none of its objects occupy a voxel.
+ * @param position Position of the tile.
+ * @param excludeUnit This unit doesn't count.
+ * @return True if nothing in the tile can be hit.
+ */
+bool TileEngine::isVoxelEmpty(const Position &position, BattleUnit *excludeUnit)
+{
+	Tile *tile = _save->getTile(position);
+	if (tile == 0)
+	{
+		return false;
+	}
+	if (tile->getUnit() != 0 && tile->getUnit() != excludeUnit)
+	{
+		return false;
+	}
+	Tile *below = _save->getTile(position + Position(0, 0, -1));
+	if (below && below->getUnit() != 0 && below->getUnit() != excludeUnit)
+	{
+		return false;
+	}
+	for (int i = 0; i < 4; ++i)
+	{
+		MapData *mp = tile->getMapData(i);
+		if (mp != 0 && !tile->isUfoDoorOpen(i) && !mp->isVoxelEmpty())
+		{
+			return false;
+		}
+	}
+	return true;
+}
 
+/**
+ * Checks if a voxel on a line lies in a tile with nothing to hit. Lines take
+ * many steps through each tile, so the answer for the last tile is kept.
+ * @param voxel The voxel to check.
+ * @param excludeUnit This unit doesn't count.
+ * @param lastTile Position of the last tile checked.
+ * @param lastTileEmpty Whether the last tile checked was empty.
+ * @return True if the voxel check can be skipped.
+ */
+bool TileEngine::inEmptyTile(const Position &voxel, BattleUnit *excludeUnit, Position *lastTile, bool *lastTileEmpty)
+{
+	if (voxel.x < 0 || voxel.y < 0 || voxel.z < 0)
+	{
+		return false;
+	}
+	Position tile(voxel.x >> 4, voxel.y >> 4, voxel.z / 24);
+	if (tile != *lastTile)
+	{
+		*lastTile = tile;
+		*lastTileEmpty = isVoxelEmpty(tile, excludeUnit);
+	}
+	return *lastTileEmpty;
+}
 
 /**
  * Toggles personal lighting on / off.
@@ -1227,6 +2124,7 @@ int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool
 void TileEngine::togglePersonalLighting()
 {
 	_personalLighting = !_personalLighting;
+	_lightSourcesFound[2] = false;
 	calculateUnitLighting();
 }
 
@@ -20,6 +20,7 @@
 #define OPENXCOM_TILEENGINE_H
 
 #include <vector>
+#include <map>
 #include "Position.h"
 #include "../Ruleset/MapData.h"
 #include <SDL.h>
@@ -32,6 +33,8 @@ class SavedBattleGame;
 class BattleUnit;
 class BattleItem;
 class Tile;
+class ViewCone;
+class ThreadPool;
 
 /**
  * A utility class that modifies tile properties on a battlescape map. This includes lighting, destruction, smoke, fire, fog of war.
@@ -42,12 +45,116 @@ class TileEngine
 private:
 	static const int MAX_VIEW_DISTANCE = 20;
 	static const int MAX_DARKNESS_TO_SEE_UNITS = 9;
+	static const int EXPLOSION_RAYS = 19 * 121;
+	/// A step of an explosion ray, relative to the tile the explosion starts in.
+	/// 16 bits, so rulesets can have explosions wider than 127 tiles.
+	struct RayStep
+	{
+		Sint16 x, y, z;
+	};
+	/// Something that gives off light, remembered so relighting only has to touch what changed.
+	struct LightSource
+	{
+		Position pos;
+		int power;
+		LightSource(const Position &pos_, int power_) : pos(pos_), power(power_) {};
+		bool operator<(const LightSource &other) const
+		{
+			if (pos.x != other.pos.x) return pos.x < other.pos.x;
+			if (pos.y != other.pos.y) return pos.y < other.pos.y;
+			if (pos.z != other.pos.z) return pos.z < other.pos.z;
+			return power < other.power;
+		}
+	};
+	/// A unit's line of sight to a tile, kept until something changes along it.
+	struct SightLine
+	{
+		Position origin;
+		unsigned int stamp;
+		bool seen;
+	};
+	/// What is remembered of a unit's view: its lines of sight and where it last discovered tiles from.
+	struct UnitSight
+	{
+		Position position;
+		int direction;
+		unsigned int terrain, stamp;
+		std::map<int, SightLine> lines;
+		/// Tiles the lines traced since the last time lead to, still to be added to the tile index.
+		std::vector<int> traced;
+		UnitSight() : position(-1, -1, -1), direction(-1), terrain(0), stamp(0) {};
+	};
+	/// A line of sight passing through a tile: whose it is, the tile it leads to and its stamp,
+	/// as lines traced again get a new stamp and leave the old keys behind.
+	struct SightKey
+	{
+		BattleUnit *unit;
+		int target;
+		unsigned int stamp;
+	};
+	/// What a unit sees, gathered without changing anything so several units can be done at once.
+	struct FieldOfView
+	{
+		UnitSight *sight;
+		std::vector<BattleUnit*> visibleUnits, spottedUnits;
+		std::vector<Tile*> discoveredTiles;
+	};
 	SavedBattleGame *_save;
 	std::vector<Uint16> *_voxelData;
-	void addLight(const Position &center, int power, int layer);
+	std::map<BattleUnit*, UnitSight> _sight;
+	std::vector<std::vector<SightKey> > _sightTiles;
+	size_t _sightKeys, _sightKeysLimit;
+	std::vector<int> _sightLineTiles;
+	std::vector<std::pair<BattleUnit*, int> > _changedSight;
+	std::map<BattleUnit*, std::vector<BattleUnit*> > _spotters;
+	unsigned int _terrainVersion;
+	ViewCone *_viewCone;
+	ThreadPool *_threadPool;
+	std::vector<std::vector<Tile*> > _coneTiles;
+	std::vector<FieldOfView> _fovs;
+	const std::vector<BattleUnit*> *_fovUnits;
+	/// A tile lit by a light source, relative to the source.
+	struct LightStep
+	{
+		Sint16 x, y;
+		Uint8 light;
+	};
+	std::vector<LightSource> _lightSources[3];
+	std::vector<int> _lightChanges[3];
+	bool _lightSourcesFound[3];
+	void collectLightChanges();
+	void keepUnchangedLights(int layer, std::vector<LightSource> *sources);
+	void findUnitLight(Tile *tile, std::vector<LightSource> *sources);
+	std::vector<std::vector<LightStep> > _lightStamps;
+	const std::vector<LightStep> &getLightStamp(int power);
+	std::vector<RayStep> _explosionRays;
+	int _explosionRayLength;
+	std::vector<Uint8> _explosionVisited;
+	void buildExplosionRays(int length);
+	void findTerrainLights(Tile *tile, std::vector<LightSource> *sources);
+	void addLight(const Position &center, int power, int layer, const Position &min, const Position &max);
+	void updateLighting(int layer, std::vector<LightSource> *sources);
+	void relight(int layer, Position min, Position max);
 	int blockage(Tile *tile, const int part, ItemDamageType type);
 	int vectorToDirection(const Position &vector);
 	int voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool excludeAllUnits = false);
+	bool isVoxelEmpty(const Position &position, BattleUnit *excludeUnit);
+	bool inEmptyTile(const Position &voxel, BattleUnit *excludeUnit, Position *lastTile, bool *lastTileEmpty);
+	void findVisible(BattleUnit *unit, FieldOfView *fov, int worker);
+	bool lineOfSight(BattleUnit *unit, Tile *tile, UnitSight *sight);
+	bool traceLineOfSight(BattleUnit *unit, Tile *tile);
+	void findSightLineTiles(const Position &origin, const Position &target, std::vector<int> *tiles);
+	void indexSightLines(BattleUnit *unit, UnitSight *sight);
+	void reindexSightLines();
+	bool seesUnit(BattleUnit *spotter, BattleUnit *unit);
+	void updateSpotter(BattleUnit *spotter, BattleUnit *unit);
+	void aggroOnSight(BattleUnit *unit);
+	void updateSight();
+	void terrainChanged(const Position &min, const Position &max);
+	static void findVisibleJob(void *engine, int job, int worker);
+	bool applyFOV(BattleUnit *unit, const FieldOfView &fov);
+	void discoverTiles(BattleUnit *unit, std::vector<Tile*> *coneTiles, std::vector<Tile*> *discovered);
+	void discoverTile(Tile *tile);
 	bool _personalLighting;
 public:
 	/// Creates a new TileEngine class.
@@ -58,10 +165,24 @@ public:
 	void calculateSunShading();
 	/// Calculate sun shading of a single tile.
 	void calculateSunShading(Tile *tile);
+	/// Calculate sun shading of the columns within an area.
+	void calculateSunShading(const Position &min, const Position &max);
 	/// Calculate the field of view from a units view point.
 	bool calculateFOV(BattleUnit *unit);
+	/// Calculate the field of view of several units at once.
+	void calculateFOV(const std::vector<BattleUnit*> &units);
+	/// Find the field of view of several units at once, to be applied later.
+	void findFOV(const std::vector<BattleUnit*> &units);
+	/// Apply the field of view found for one of the units.
+	bool applyFOV(size_t index);
 	/// Calculate the field of view within range of a certain position.
 	void calculateFOV(const Position &position);
+	/// Calculate the field of view within range of an area.
+	void calculateFOV(const Position &min, const Position &max);
+	/// Update which units see a unit that moved.
+	void updateSpotters(BattleUnit *unit);
+	/// Get the units that see a unit.
+	const std::vector<BattleUnit*> &getSpotters(BattleUnit *unit);
 	/// Check reaction fire.
 	bool checkReactionFire(BattleUnit *unit, BattleAction *action, BattleUnit *potentialVictim = 0, bool recalculateFOV = true);
 	/// Recalculate lighting of the battlescape.
@@ -82,6 +203,10 @@ public:
 	/// Calculate a parabola trajectory.
 	int calculateParabola(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, double curvature, double accuracy);
 	bool visible(BattleUnit *currentUnit, Tile *tile);
+	/// Forget the lines of sight passing through an area.
+	void invalidateSightLines(const Position &min, const Position &max);
+	/// Forget all lines of sight.
+	void invalidateSight();
 	void togglePersonalLighting();
 	int distance(const Position &pos1, const Position &pos2) const;
 	int horizontalBlockage(Tile *startTile, Tile *endTile, ItemDamageType type);
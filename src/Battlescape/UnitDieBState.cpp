@@ -20,6 +20,7 @@
 #include "UnitDieBState.h"
 #include "ExplosionBState.h"
 #include "TileEngine.h"
+#include "Pathfinding.h"
 #include "BattlescapeState.h"
 #include "Map.h"
 #include "Camera.h"
@@ -75,11 +76,11 @@ void UnitDieBState::init()
 	{
 		if ((_unit->getType() == "SOLDIER" && _unit->getGender() == GENDER_MALE) || _unit->getType() == "MALE_CIVILIAN")
 		{
-			_parent->getResourcePack()->getSoundSet("BATTLE.CAT")->getSound(RNG::generate(41,43))->play();
+			_parent->getResourcePack()->getSoundSet("BATTLE.CAT")->getSound(RNG::generate(41,43,RNG::EFFECTS))->play();
 		}
 		else if ((_unit->getType() == "SOLDIER" && _unit->getGender() == GENDER_FEMALE) || _unit->getType() == "FEMALE_CIVILIAN")
 		{
-			_parent->getResourcePack()->getSoundSet("BATTLE.CAT")->getSound(RNG::generate(44,46))->play();
+			_parent->getResourcePack()->getSoundSet("BATTLE.CAT")->getSound(RNG::generate(44,46,RNG::EFFECTS))->play();
 		}
 		else
 		{
@@ -179,6 +180,7 @@ void UnitDieBState::convertUnitToCorpse()
 			}
 		}
 	}
+	_parent->getSave()->getPathfinding()->invalidateReachability();
 }
 
 }
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "UnitSpriteCache.h"
+#include <algorithm>
+#include "UnitSprite.h"
+#include "../Engine/Surface.h"
+#include "../Engine/Profiler.h"
+#include "../Resource/ResourcePack.h"
+#include "../Ruleset/Armor.h"
+#include "../Ruleset/RuleItem.h"
+#include "../Savegame/BattleUnit.h"
+#include "../Savegame/BattleItem.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Compares two keys, for keeping them in a map.
+ * @param other Key to compare with.
+ * @return True if this key comes first.
+ */
+bool UnitSpriteCache::Key::operator<(const Key &other) const
+{
+	if (armor != other.armor)
+		return armor < other.armor;
+	if (item != other.item)
+		return item < other.item;
+	return std::lexicographical_compare(values, values + VALUES, other.values, other.values + VALUES);
+}
+
+/**
+ * Sets up an empty unit sprite cache.
+ * @param res Pointer to the resource pack with the unit sprites.
+ * @param rightHand Inventory slot of the item units hold, or 0 if the ruleset has none.
+ * @param width Width of a frame.
+ * @param height Height of a frame.
+ */
+UnitSpriteCache::UnitSpriteCache(ResourcePack *res, RuleInventory *rightHand, int width, int height) : _res(res), _rightHand(rightHand), _width(width), _height(height), _frames(), _owners(), _unused(), _pool()
+{
+	_sprite = new UnitSprite(width, height, 0, 0);
+}
+
+/**
+ * Deletes all the frames.
+ */
+UnitSpriteCache::~UnitSpriteCache()
+{
+	for (Frames::iterator i = _frames.begin(); i != _frames.end(); ++i)
+	{
+		delete i->second.surface;
+	}
+	for (std::vector<Surface*>::iterator i = _pool.begin(); i != _pool.end(); ++i)
+	{
+		delete *i;
+	}
+	delete _sprite;
+}
+
+/**
+ * Works out everything the look of a unit part depends on. Only what
+ * the unit's drawing routine (see UnitSprite) uses is filled in, so
+ * units share frames as much as they can.
+ * @param unit Pointer to the unit.
+ * @param part Part of the unit, for large units.
+ * @param animationFrame Current animation frame of the map.
+ * @return Key of the frame.
+ */
+UnitSpriteCache::Key UnitSpriteCache::getKey(BattleUnit *unit, int part, int animationFrame) const
+{
+	Key key;
+	key.armor = unit->getArmor();
+	key.item = 0;
+	std::fill(key.values, key.values + Key::VALUES, 0);
+	key.values[Key::PART] = part;
+	if (unit->isOut())
+	{
+		// nothing is drawn
+		key.values[Key::STATUS] = -1;
+		return key;
+	}
+
+	int routine = key.armor->getDrawingRoutine();
+	int status = unit->getStatus();
+	if (status != STATUS_WALKING && status != STATUS_AIMING && status != STATUS_FALLING)
+		status = STATUS_STANDING;
+	key.values[Key::STATUS] = status;
+	key.values[Key::DIRECTION] = unit->getDirection();
+	if (status == STATUS_WALKING)
+		key.values[Key::WALKING_PHASE] = unit->getWalkingPhase();
+	if (status == STATUS_FALLING)
+		key.values[Key::FALLING_PHASE] = unit->getFallingPhase();
+	key.values[Key::KNEELED] = unit->isKneeled();
+
+	if (routine == 0 || routine == 1)
+	{
+		BattleItem *item = _rightHand ? unit->getItem(_rightHand) : unit->getItem("STR_RIGHT_HAND");
+		key.item = item ? item->getRules() : 0;
+		// the item is drawn lower on shorter units
+		key.values[Key::STAND_HEIGHT] = unit->getStandHeight();
+	}
+	if (routine == 0)
+	{
+		key.values[Key::GENDER] = unit->getGender();
+	}
+	if (routine == 2)
+	{
+		key.values[Key::TURRET_TYPE] = unit->getTurretType();
+		key.values[Key::TURRET_DIRECTION] = unit->getTurretDirection();
+	}
+	if ((routine == 3 || (routine == 2 && key.armor->getMovementType() == MT_FLY)) && part > 0)
+		key.values[Key::ANIMATION_FRAME] = animationFrame;
+	return key;
+}
+
+/**
+ * Gets the frame a unit part looks like right now. If no unit looked
+ * like that before, the frame is composited. The unit part counts as
+ * showing the frame until it's released.
+ * @param unit Pointer to the unit.
+ * @param part Part of the unit, for large units.
+ * @param animationFrame Current animation frame of the map.
+ * @return Pointer to the frame.
+ */
+Surface *UnitSpriteCache::getFrame(BattleUnit *unit, int part, int animationFrame)
+{
+	Key key = getKey(unit, part, animationFrame);
+	Frames::iterator i = _frames.find(key);
+	if (i != _frames.end())
+	{
+		Profiler::count("UnitSpriteCache::hits");
+		if (i->second.users++ == 0)
+			_unused.erase(i->second.unused);
+		return i->second.surface;
+	}
+
+	Profiler::count("UnitSpriteCache::misses");
+	Surface *surface;
+	if (_pool.empty())
+	{
+		surface = new Surface(_width, _height);
+		surface->setPalette(_sprite->getPalette());
+	}
+	else
+	{
+		surface = _pool.back();
+		_pool.pop_back();
+	}
+
+	_sprite->setBattleUnit(unit, part);
+	_sprite->setBattleItem(0);
+	if (key.item)
+	{
+		_sprite->setBattleItem(_rightHand ? unit->getItem(_rightHand) : unit->getItem("STR_RIGHT_HAND"));
+	}
+	_sprite->setSurfaces(_res->getSurfaceSet(key.armor->getSpriteSheet()), _res->getSurfaceSet("HANDOB.PCK"));
+	_sprite->setAnimationFrame(animationFrame);
+	surface->clear();
+	_sprite->blit(surface);
+
+	Frame frame;
+	frame.surface = surface;
+	frame.users = 1;
+	frame.unused = _unused.end();
+	i = _frames.insert(std::make_pair(key, frame)).first;
+	_owners[surface] = i;
+	return surface;
+}
+
+/**
+ * Lets go of a frame a unit part showed, when the unit changed its
+ * looks. Frames nothing shows are kept for a while, and when there
+ * are too many, the one let go of first is dropped and its surface
+ * goes back in the pool.
+ * @param frame Pointer to a frame from this cache.
+ */
+void UnitSpriteCache::release(Surface *frame)
+{
+	if (frame == 0)
+		return;
+	std::map<Surface*, Frames::iterator>::iterator owner = _owners.find(frame);
+	if (owner == _owners.end())
+		return;
+	Frames::iterator i = owner->second;
+	if (--i->second.users > 0)
+		return;
+	i->second.unused = _unused.insert(_unused.end(), i->first);
+
+	if ((int)_unused.size() > MAX_UNUSED_FRAMES)
+	{
+		Frames::iterator oldest = _frames.find(_unused.front());
+		_unused.pop_front();
+		_pool.push_back(oldest->second.surface);
+		_owners.erase(oldest->second.surface);
+		_frames.erase(oldest);
+	}
+}
+
+/**
+ * Replaces a certain amount of colors in the palette of all the frames.
+ * @param colors Pointer to the set of colors.
+ * @param firstcolor Offset of the first color to replace.
+ * @param ncolors Amount of colors to replace.
+ */
+void UnitSpriteCache::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
+{
+	_sprite->setPalette(colors, firstcolor, ncolors);
+	for (Frames::iterator i = _frames.begin(); i != _frames.end(); ++i)
+	{
+		i->second.surface->setPalette(colors, firstcolor, ncolors);
+	}
+	for (std::vector<Surface*>::iterator i = _pool.begin(); i != _pool.end(); ++i)
+	{
+		(*i)->setPalette(colors, firstcolor, ncolors);
+	}
+}
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_UNITSPRITECACHE_H
+#define OPENXCOM_UNITSPRITECACHE_H
+
+#include <map>
+#include <list>
+#include <vector>
+#include <SDL.h>
+
+namespace OpenXcom
+{
+
+class Surface;
+class UnitSprite;
+class ResourcePack;
+class RuleInventory;
+class BattleUnit;
+class Armor;
+class RuleItem;
+
+/**
+ * Composites the sprites of units on the battlescape and keeps them,
+ * so units that look the same (same armor, pose, walking or falling phase
+ * and item in hand) share one frame, and a unit is only composited again
+ * when its looks change. Frames still in use by a unit are never dropped;
+ * unused ones are kept for a while in case they come back, and their
+ * surfaces are reused for new frames.
+ */
+class UnitSpriteCache
+{
+private:
+	static const int MAX_UNUSED_FRAMES = 256;
+	/// Everything a composited frame depends on.
+	struct Key
+	{
+		enum { PART, DIRECTION, TURRET_DIRECTION, TURRET_TYPE, STATUS, WALKING_PHASE, FALLING_PHASE, KNEELED, GENDER, STAND_HEIGHT, ANIMATION_FRAME, VALUES };
+		Armor *armor;
+		RuleItem *item;
+		int values[VALUES];
+		bool operator<(const Key &other) const;
+	};
+	/// A composited frame, and how many unit parts show it.
+	struct Frame
+	{
+		Surface *surface;
+		int users;
+		std::list<Key>::iterator unused;
+	};
+	typedef std::map<Key, Frame> Frames;
+	ResourcePack *_res;
+	RuleInventory *_rightHand;
+	int _width, _height;
+	UnitSprite *_sprite;
+	Frames _frames;
+	std::map<Surface*, Frames::iterator> _owners;
+	std::list<Key> _unused;
+	std::vector<Surface*> _pool;
+	/// Works out what a unit part looks like.
+	Key getKey(BattleUnit *unit, int part, int animationFrame) const;
+public:
+	/// Creates an empty unit sprite cache.
+	UnitSpriteCache(ResourcePack *res, RuleInventory *rightHand, int width, int height);
+	/// Cleans up the unit sprite cache.
+	~UnitSpriteCache();
+	/// Gets the frame of a unit part, compositing it if needed.
+	Surface *getFrame(BattleUnit *unit, int part, int animationFrame);
+	/// Lets go of a frame a unit part showed.
+	void release(Surface *frame);
+	/// Sets the palette of the frames.
+	void setPalette(SDL_Color *colors, int firstcolor = 0, int ncolors = 256);
+};
+
+}
+
+#endif
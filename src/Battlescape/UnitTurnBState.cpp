@@ -74,7 +74,7 @@ void UnitTurnBState::init()
 		}
 		if (door == 1)
 		{
-			_parent->getResourcePack()->getSoundSet("BATTLE.CAT")->getSound(RNG::generate(20,21))->play(); // ufo door
+			_parent->getResourcePack()->getSoundSet("BATTLE.CAT")->getSound(RNG::generate(20,21,RNG::EFFECTS))->play(); // ufo door
 		}
 		_parent->popState();
 	}
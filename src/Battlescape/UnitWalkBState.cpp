@@ -30,6 +30,7 @@
 #include "../Savegame/BattleUnit.h"
 #include "../Savegame/SavedBattleGame.h"
 #include "../Savegame/Tile.h"
+#include "../Savegame/TileGrid.h"
 #include "../Resource/ResourcePack.h"
 #include "../Engine/SoundSet.h"
 #include "../Engine/Sound.h"
@@ -137,6 +138,8 @@ void UnitWalkBState::think()
 					_parent->getSave()->getTile(_unit->getPosition() + Position(x,y,0))->setUnit(_unit);
 				}
 			}
+			// other units may now find their way blocked or free
+			_parent->getSave()->getPathfinding()->invalidateReachability();
 
 			// if the unit changed level, camera changes level with
 			_parent->getMap()->getCamera()->setViewHeight(_unit->getPosition().z);
@@ -173,6 +176,7 @@ void UnitWalkBState::think()
 									p.z = t->getPosition().z*24 + t->getTerrainLevel();
 									_parent->statePushNext(new ExplosionBState(_parent, p, (*i), (*i)->getPreviousOwner()));
 									t->getInventory()->erase(i);
+									_parent->getSave()->getTileGrid()->addDrawChange(_parent->getSave()->getTileIndex(t->getPosition()));
 									return;
 								}
 							}
@@ -0,0 +1,328 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ViewCone.h"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+namespace OpenXcom
+{
+
+/// A step of the line tree while it's being built.
+struct ViewConeBuildNode
+{
+	Position pos;
+	bool target;
+	std::vector<int> children;
+	ViewConeBuildNode(const Position &p) : pos(p), target(false) {}
+};
+
+/**
+ * Copies a subtree of the build tree to the flat node list, in depth-first order.
+ * @param tree The build tree.
+ * @param index Index of the subtree's root in the build tree.
+ * @param parent Index of the parent in the flat list.
+ * @param nodes The flat list.
+ */
+static void flatten(const std::vector<ViewConeBuildNode> &tree, int index, int parent, std::vector<ViewCone::Node> *nodes)
+{
+	const ViewConeBuildNode &b = tree[index];
+	int self = nodes->size();
+	ViewCone::Node node;
+	node.x = b.pos.x;
+	node.y = b.pos.y;
+	node.z = b.pos.z;
+	node.target = b.target;
+	node.parent = parent;
+	node.end = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		node.min[i] = 127;
+		node.max[i] = -128;
+	}
+	if (b.target)
+	{
+		node.min[0] = node.max[0] = node.x;
+		node.min[1] = node.max[1] = node.y;
+		node.min[2] = node.max[2] = node.z;
+	}
+	nodes->push_back(node);
+
+	for (std::vector<int>::const_iterator i = b.children.begin(); i != b.children.end(); ++i)
+	{
+		int child = nodes->size();
+		flatten(tree, *i, self, nodes);
+		for (int j = 0; j < 3; ++j)
+		{
+			(*nodes)[self].min[j] = std::min((*nodes)[self].min[j], (*nodes)[child].min[j]);
+			(*nodes)[self].max[j] = std::max((*nodes)[self].max[j], (*nodes)[child].max[j]);
+		}
+	}
+	(*nodes)[self].end = nodes->size();
+}
+
+/**
+ * Precomputes the view cones for all 8 directions.
+ * @param maxDistance How far a unit can see, in tiles.
+ * @param height Number of levels of the map.
+ */
+ViewCone::ViewCone(int maxDistance, int height) : _maxDistance(maxDistance), _height(height)
+{
+	for (int dir = 0; dir < 8; ++dir)
+	{
+		build(dir);
+	}
+}
+
+/**
+ * Deletes the view cones.
+ */
+ViewCone::~ViewCone()
+{
+
+}
+
+/**
+ * Builds the target list and line tree for one direction.
+ * The target order is the same the field of view has always been scanned in.
+ * @param direction Facing direction of the unit.
+ */
+void ViewCone::build(int direction)
+{
+	bool swap = (direction == 0 || direction == 4);
+	const int signX[8] = { +1, +1, +1, +1, -1, -1, -1, -1 };
+	const int signY[8] = { -1, -1, -1, +1, +1, +1, -1, -1 };
+	int y1, y2;
+	int side = 2 * _maxDistance + 1;
+	_inView[direction].assign(side * side, false);
+
+	for (int x = 0; x <= _maxDistance; ++x)
+	{
+		if (direction % 2)
+		{
+			y1 = 0;
+			y2 = _maxDistance - x;
+		}
+		else
+		{
+			y1 = -x;
+			y2 = x;
+		}
+		for (int y = y1; y <= y2; ++y)
+		{
+			int distance = int(floor(sqrt(float(x*x + y*y)) + 0.5));
+			if (distance <= _maxDistance)
+			{
+				Position target(signX[direction] * (swap ? y : x), signY[direction] * (swap ? x : y), 0);
+				_targets[direction].push_back(target);
+				_inView[direction][(target.y + _maxDistance) * side + target.x + _maxDistance] = true;
+			}
+		}
+	}
+
+	// merge the lines to every level of every column into one tree
+	std::vector<ViewConeBuildNode> tree;
+	std::vector<Position> line;
+	tree.push_back(ViewConeBuildNode(Position(0, 0, 0)));
+	for (std::vector<Position>::const_iterator t = _targets[direction].begin(); t != _targets[direction].end(); ++t)
+	{
+		for (int z = 1 - _height; z < _height; ++z)
+		{
+			line.clear();
+			traceLine(Position(0, 0, 0), Position(t->x, t->y, z), &line);
+			int current = 0;
+			for (std::vector<Position>::const_iterator p = line.begin() + 1; p != line.end(); ++p)
+			{
+				int next = -1;
+				for (std::vector<int>::const_iterator c = tree[current].children.begin(); c != tree[current].children.end(); ++c)
+				{
+					if (tree[*c].pos == *p)
+					{
+						next = *c;
+						break;
+					}
+				}
+				if (next == -1)
+				{
+					next = tree.size();
+					tree.push_back(ViewConeBuildNode(*p));
+					tree[current].children.push_back(next);
+				}
+				current = next;
+			}
+			tree[current].target = true;
+		}
+	}
+
+	_lines[direction].reserve(tree.size());
+	flatten(tree, 0, -1, &_lines[direction]);
+}
+
+/**
+ * Gets the tile columns in view of a unit facing a certain direction,
+ * relative to the unit and in the order they should be scanned.
+ * @param direction Facing direction of the unit.
+ * @return List of x/y offsets.
+ */
+const std::vector<Position> &ViewCone::getTargets(int direction) const
+{
+	return _targets[direction];
+}
+
+/**
+ * Checks if a tile column is in view of a unit facing a certain direction,
+ * without going through the whole list of targets.
+ * @param direction Facing direction of the unit.
+ * @param x Offset of the column from the unit.
+ * @param y Offset of the column from the unit.
+ * @return True if the column is one of the targets.
+ */
+bool ViewCone::inView(int direction, int x, int y) const
+{
+	if (abs(x) > _maxDistance || abs(y) > _maxDistance)
+		return false;
+	return _inView[direction][(y + _maxDistance) * (2 * _maxDistance + 1) + x + _maxDistance];
+}
+
+/**
+ * Gets the sight line tree for a direction. Node 0 is the origin; each node's
+ * subtree ends right before its end index, so a blocked step is skipped over
+ * by jumping to that index.
+ * @param direction Facing direction of the unit.
+ * @return List of nodes.
+ */
+const std::vector<ViewCone::Node> &ViewCone::getLines(int direction) const
+{
+	return _lines[direction];
+}
+
+/**
+ * Checks if any of the lines passing through a node end on the map. Tiles are
+ * only discovered by lines to tiles on the map, so nodes on lines running off the
+ * edge need this check.
+ * @param direction Facing direction of the unit.
+ * @param node Index of the node.
+ * @param origin Position of the unit.
+ * @param mapSize Width, length and height of the map.
+ * @return True if at least one line ends on the map.
+ */
+bool ViewCone::reachesMap(int direction, int node, const Position &origin, const Position &mapSize) const
+{
+	const Node &n = _lines[direction][node];
+	int o[3] = { origin.x, origin.y, origin.z };
+	int s[3] = { mapSize.x, mapSize.y, mapSize.z };
+	bool inside = true;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (o[i] + n.max[i] < 0 || o[i] + n.min[i] >= s[i])
+			return false;
+		if (o[i] + n.min[i] < 0 || o[i] + n.max[i] >= s[i])
+			inside = false;
+	}
+	if (inside)
+		return true;
+
+	if (n.target)
+	{
+		Position p(origin.x + n.x, origin.y + n.y, origin.z + n.z);
+		if (p.x >= 0 && p.x < s[0] && p.y >= 0 && p.y < s[1] && p.z >= 0 && p.z < s[2])
+			return true;
+	}
+	for (int child = node + 1; child < n.end; child = _lines[direction][child].end)
+	{
+		if (reachesMap(direction, child, origin, mapSize))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Gets all tiles on a straight line, stepping the same way TileEngine::calculateLine does.
+ * @param origin Start of the line.
+ * @param target End of the line.
+ * @param line Vector to store the positions in, including origin and target.
+ */
+void ViewCone::traceLine(const Position &origin, const Position &target, std::vector<Position> *line)
+{
+	int x, x0, x1, delta_x, step_x;
+	int y, y0, y1, delta_y, step_y;
+	int z, z0, z1, delta_z, step_z;
+	int swap_xy, swap_xz;
+	int drift_xy, drift_xz;
+	int cx, cy, cz;
+
+	x0 = origin.x;	 x1 = target.x;
+	y0 = origin.y;	 y1 = target.y;
+	z0 = origin.z;	 z1 = target.z;
+
+	swap_xy = abs(y1 - y0) > abs(x1 - x0);
+	if (swap_xy)
+	{
+		std::swap(x0, y0);
+		std::swap(x1, y1);
+	}
+
+	swap_xz = abs(z1 - z0) > abs(x1 - x0);
+	if (swap_xz)
+	{
+		std::swap(x0, z0);
+		std::swap(x1, z1);
+	}
+
+	delta_x = abs(x1 - x0);
+	delta_y = abs(y1 - y0);
+	delta_z = abs(z1 - z0);
+
+	drift_xy  = (delta_x / 2);
+	drift_xz  = (delta_x / 2);
+
+	step_x = 1;  if (x0 > x1) {  step_x = -1; }
+	step_y = 1;  if (y0 > y1) {  step_y = -1; }
+	step_z = 1;  if (z0 > z1) {  step_z = -1; }
+
+	y = y0;
+	z = z0;
+
+	for (x = x0; x != (x1+step_x); x += step_x)
+	{
+		cx = x;	cy = y;	cz = z;
+
+		if (swap_xz) std::swap(cx, cz);
+		if (swap_xy) std::swap(cx, cy);
+
+		line->push_back(Position(cx, cy, cz));
+
+		drift_xy = drift_xy - delta_y;
+		drift_xz = drift_xz - delta_z;
+
+		if (drift_xy < 0)
+		{
+			y = y + step_y;
+			drift_xy = drift_xy + delta_x;
+		}
+
+		if (drift_xz < 0)
+		{
+			z = z + step_z;
+			drift_xz = drift_xz + delta_x;
+		}
+	}
+}
+
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_VIEWCONE_H
+#define OPENXCOM_VIEWCONE_H
+
+#include <vector>
+#include <SDL.h>
+#include "Position.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Precomputed sight lines of a unit's field of view, for each of the 8 facing directions.
+ * All tile-space lines from the origin to every tile in the cone are merged into a tree
+ * (lines sharing their first steps share nodes), stored in depth-first order so the whole
+ * cone can be walked in one pass, skipping everything behind a blocked step.
+ */
+class ViewCone
+{
+public:
+	/// A single step of one or more sight lines, relative to the origin.
+	struct Node
+	{
+		Sint8 x, y, z;
+		/// Does a sight line end here?
+		bool target;
+		/// Bounding box of all line ends in this subtree.
+		Sint8 min[3], max[3];
+		/// Index of the previous step.
+		int parent;
+		/// Index of the first node after this subtree.
+		int end;
+	};
+private:
+	int _maxDistance, _height;
+	std::vector<Position> _targets[8];
+	std::vector<bool> _inView[8];
+	std::vector<Node> _lines[8];
+	void build(int direction);
+public:
+	/// Creates the view cones for a map of the given height.
+	ViewCone(int maxDistance, int height);
+	/// Cleans up the view cones.
+	~ViewCone();
+	/// Gets the tile columns within view, in scan order.
+	const std::vector<Position> &getTargets(int direction) const;
+	/// Is a tile column within view?
+	bool inView(int direction, int x, int y) const;
+	/// Gets the sight line tree.
+	const std::vector<Node> &getLines(int direction) const;
+	/// Does any line through this node end on the map?
+	bool reachesMap(int direction, int node, const Position &origin, const Position &mapSize) const;
+	/// Gets the tiles on a line in tile space.
+	static void traceLine(const Position &origin, const Position &target, std::vector<Position> *line);
+};
+
+}
+
+#endif
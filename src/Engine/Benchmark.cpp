@@ -0,0 +1,1856 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Benchmark.h"
+#include <algorithm>
+#include <iomanip>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <list>
+#include "Game.h"
+#include "Screen.h"
+#include "Surface.h"
+#include "SurfaceSet.h"
+#include "SpanSprite.h"
+#include "Palette.h"
+#include "Options.h"
+#include "CrossPlatform.h"
+#include "RNG.h"
+#include "Exception.h"
+#include "Profiler.h"
+#include "Blit.h"
+#include "ShaderDraw.h"
+#include "ShaderMove.h"
+#include "../Interface/Text.h"
+#include "../Geoscape/Globe.h"
+#include "../Battlescape/BattleSimulator.h"
+#include "../Battlescape/TileEngine.h"
+#include "../Battlescape/Pathfinding.h"
+#include "../Battlescape/Map.h"
+#include "../Battlescape/Camera.h"
+#include "../Resource/ResourcePack.h"
+#include "../Ruleset/MapData.h"
+#include "../Ruleset/Armor.h"
+#include "../Ruleset/Ruleset.h"
+#include "../Ruleset/RuleItem.h"
+#include "../Savegame/SavedGame.h"
+#include "../Savegame/SavedBattleGame.h"
+#include "../Savegame/BattleUnit.h"
+#include "../Savegame/BattleItem.h"
+#include "../Savegame/Tile.h"
+#include "../Savegame/TileGrid.h"
+
+namespace OpenXcom
+{
+
+/**
+ * A tile the way it was stored before TileGrid: allocated on its own, with its light,
+ * smoke, fire, explosive power and fog of war inside. Only used to compare the two.
+ */
+struct Benchmark::HeapTile
+{
+	MapData *objects[4];
+	int mapDataID[4], mapDataSetID[4], currentFrame[4];
+	bool discovered[3];
+	int light[3], lastLight[3];
+	int smoke, fire, explosive;
+	Position pos;
+	BattleUnit *unit;
+	std::vector<BattleItem*> inventory;
+	int animationOffset, markerColor;
+	HeapTile() : smoke(0), fire(0), explosive(0), unit(0), animationOffset(0), markerColor(0) {};
+};
+
+/**
+ * Sets up a benchmark.
+ * @param game Pointer to the core game, with the resources, ruleset and a saved game loaded.
+ * @param samples Number of times each benchmark is run.
+ */
+Benchmark::Benchmark(Game *game, int samples) : _game(game), _samples(std::max(samples, 1)), _out(0), _surface(0), _background(0), _sprite(0), _sprites(0), _spans(0), _text(0), _globe(0), _battle(0), _unit(0), _lines(), _destinations(), _destination(0), _grid(0), _heapTiles(), _burning(0), _map(0), _scrolls(0)
+{
+
+}
+
+/**
+ * Deletes the benchmark data.
+ */
+Benchmark::~Benchmark()
+{
+	delete _surface;
+	delete _background;
+	delete _text;
+	delete _globe;
+	delete _grid;
+	for (std::vector<HeapTile*>::iterator i = _heapTiles.begin(); i != _heapTiles.end(); ++i)
+	{
+		delete *i;
+	}
+	delete _map;
+	if (_battle)
+	{
+		// the units still point at frames of the map
+		for (std::vector<BattleUnit*>::iterator i = _battle->getUnits()->begin(); i != _battle->getUnits()->end(); ++i)
+		{
+			(*i)->clearCache();
+		}
+	}
+}
+
+/**
+ * Runs a benchmark once to warm up the caches, and then
+ * times it the given number of times, each time calling it
+ * a number of times. The median, fastest and slowest time
+ * per call are written out, along with the median deviation
+ * from the median, as a percentage.
+ * @param name Name of the benchmark.
+ * @param bench Benchmark to run.
+ * @param iterations Number of calls per sample.
+ */
+void Benchmark::measure(const std::string &name, Bench bench, int iterations)
+{
+	(this->*bench)();
+	std::vector<double> times, deviations;
+	for (int i = 0; i < _samples; ++i)
+	{
+		double start = CrossPlatform::getTime();
+		for (int j = 0; j < iterations; ++j)
+		{
+			(this->*bench)();
+		}
+		times.push_back((CrossPlatform::getTime() - start) * 1000000.0 / iterations);
+	}
+	std::sort(times.begin(), times.end());
+	double median = times[times.size() / 2];
+	for (std::vector<double>::iterator i = times.begin(); i != times.end(); ++i)
+	{
+		deviations.push_back(fabs(*i - median));
+	}
+	std::sort(deviations.begin(), deviations.end());
+	double spread = median > 0 ? deviations[deviations.size() / 2] * 100.0 / median : 0;
+
+	*_out << std::left << std::setw(32) << name << std::right << std::setw(8) << iterations
+		<< std::fixed << std::setprecision(2) << std::setw(14) << median << std::setw(14) << times.front()
+		<< std::setw(14) << times.back() << std::setw(10) << spread << std::endl;
+}
+
+/**
+ * Loads everything the benchmarks work on: a background, a unit
+ * sprite, a page of text, the globe and a terror mission, with a
+ * set of lines and paths across it picked at random, and the map
+ * of the mission centered on a soldier.
+ */
+void Benchmark::setup()
+{
+	ResourcePack *res = _game->getResourcePack();
+	SDL_Color *colors = res->getPalette("PALETTES.DAT_0")->getColors();
+	_game->setPalette(colors);
+
+	_surface = new Surface(320, 200);
+	_background = new Surface(320, 200);
+	res->getSurface("BACK01.SCR")->blit(_background);
+	_sprites = res->getSurfaceSet("XCOM_0.PCK");
+	_sprite = _sprites->getFrame(0);
+	_spans = _sprites->getSpans(0);
+
+	_text = new Text(320, 200);
+	_text->setFonts(res->getFont("Big.fnt"), res->getFont("Small.fnt"));
+	_text->setSmall();
+	_text->setWordWrap(true);
+	std::wstring page;
+	for (int i = 0; i < 12; ++i)
+	{
+		page += L"The aliens have landed near a large city and are terrorising the population. ";
+	}
+	_text->setText(page);
+
+	_globe = new Globe(_game, 130, 100, 256, 200, 0, 0);
+	_globe->setPalette(colors);
+
+	BattleSimulator simulator(_game, "STR_TERROR_MISSION", 1, 0);
+	_battle = simulator.generate();
+	TileEngine *tileEngine = _battle->getTileEngine();
+	tileEngine->calculateSunShading();
+	tileEngine->calculateTerrainLighting();
+	tileEngine->calculateUnitLighting();
+	tileEngine->calculateFOV(*_battle->getUnits());
+	for (std::vector<BattleUnit*>::iterator i = _battle->getUnits()->begin(); i != _battle->getUnits()->end(); ++i)
+	{
+		if ((*i)->getFaction() == FACTION_PLAYER && !(*i)->isOut())
+		{
+			_unit = *i;
+			break;
+		}
+	}
+
+	_map = new Map(_game, 320, 200, 0, 0, 200);
+	_map->setPalette(res->getPalette("PALETTES.DAT_4")->getColors());
+	_map->init();
+	_battle->setSelectedUnit(_unit);
+	_map->cacheUnits();
+	_map->getCamera()->centerOnPosition(_unit->getPosition(), false);
+
+	_grid = new TileGrid(60, 60, 4);
+	for (int i = 0; i < _grid->getSize(); ++i)
+	{
+		_heapTiles.push_back(new HeapTile());
+		if (RNG::generate(0, 49, RNG::MAP) == 0)
+		{
+			_grid->getFire()[i] = 1;
+			_heapTiles.back()->fire = 1;
+		}
+	}
+
+	int width = _battle->getWidth(), length = _battle->getLength(), height = _battle->getHeight();
+	for (int i = 0; i < 512; ++i)
+	{
+		_lines.push_back(Position(RNG::generate(0, width * 16 - 1, RNG::MAP), RNG::generate(0, length * 16 - 1, RNG::MAP), RNG::generate(0, height * 24 - 1, RNG::MAP)));
+	}
+	for (int i = 0; i < 10000 && _destinations.size() < 32; ++i)
+	{
+		Position pos(RNG::generate(0, width - 1, RNG::MAP), RNG::generate(0, length - 1, RNG::MAP), 0);
+		Tile *tile = _battle->getTile(pos);
+		if (tile && tile->getMapData(MapData::O_FLOOR) && !tile->getMapData(MapData::O_OBJECT) && !tile->getUnit())
+		{
+			_destinations.push_back(pos);
+		}
+	}
+}
+
+/**
+ * Checks that RNG::generate stays between its bounds, including ranges that
+ * span all ints and reversed bounds like the ones TileEngine::explode asks
+ * for with big explosions, and that a stream restored from its state gives
+ * the same numbers again. The effects stream is put back the way it was.
+ */
+void Benchmark::verifyRNG()
+{
+	const int bounds[][2] = { {0, 0}, {0, 1}, {1, 6}, {-5, 5}, {0, 99}, {20, 14}, {15, 14}, {100, -100}, {-2147483647 - 1, 2147483647}, {2147483647, -2147483647 - 1} };
+	std::string state = RNG::getState(RNG::EFFECTS);
+	for (int b = 0; b < 10; ++b)
+	{
+		int low = std::min(bounds[b][0], bounds[b][1]), high = std::max(bounds[b][0], bounds[b][1]);
+		for (int i = 0; i < 10000; ++i)
+		{
+			int x = RNG::generate(bounds[b][0], bounds[b][1], RNG::EFFECTS);
+			if (x < low || x > high)
+			{
+				RNG::setState(RNG::EFFECTS, state);
+				std::ostringstream ss;
+				ss << "RNG::generate(" << bounds[b][0] << ", " << bounds[b][1] << ") gave " << x;
+				throw Exception(ss.str());
+			}
+		}
+	}
+
+	std::string saved = RNG::getState(RNG::EFFECTS);
+	std::vector<int> numbers;
+	for (int i = 0; i < 1000; ++i)
+	{
+		numbers.push_back(RNG::generate(0, 1000000, RNG::EFFECTS));
+	}
+	RNG::setState(RNG::EFFECTS, saved);
+	for (int i = 0; i < 1000; ++i)
+	{
+		if (RNG::generate(0, 1000000, RNG::EFFECTS) != numbers[i])
+		{
+			RNG::setState(RNG::EFFECTS, state);
+			throw Exception("RNG::setState does not replay the stream");
+		}
+	}
+	RNG::setState(RNG::EFFECTS, state);
+	*_out << "RNG: numbers within bounds, reversed bounds swapped, streams replay from their state" << std::endl;
+}
+
+/**
+ * Checks that sprites drawn by Surface::blitNShade and SpanSprite, and
+ * spans shaded ahead of time by their SurfaceSet, come out exactly the
+ * same as with ShaderDraw and the Blit functors, for every shade, both
+ * widths, a few color groups and positions clipped on each side.
+ */
+void Benchmark::verifyBlit()
+{
+	const int positions[][2] = { {144, 80}, {-13, -7}, {301, 185}, {-20, 170}, {310, -30} };
+	Surface *reference = new Surface(320, 200), *spans = new Surface(320, 200), *shaded = new Surface(320, 200);
+	for (int p = 0; p < 5; ++p)
+	{
+		int x = positions[p][0], y = positions[p][1];
+		for (int shade = 0; shade <= 17; ++shade)
+		{
+			for (int half = 0; half < 2; ++half)
+			{
+				for (int color = 0; color < 4; ++color)
+				{
+					_background->blit(_surface);
+					_background->blit(reference);
+					_background->blit(spans);
+					_sprite->blitNShade(_surface, x, y, shade, half != 0, color);
+					_spans->blitNShade(spans, x, y, shade, half != 0, color);
+					SpanSprite *shadedSpans = color ? 0 : _sprites->getShadedSpans(0, shade);
+					if (shadedSpans)
+					{
+						_background->blit(shaded);
+						shadedSpans->blitNShade(shaded, x, y, 0, half != 0);
+					}
+
+					ShaderMove<Uint8> src(_sprite, x, y);
+					if (half)
+					{
+						GraphSubset g = src.getDomain();
+						g.beg_x = g.end_x/2;
+						src.setDomain(g);
+					}
+					if (color)
+						ShaderDraw<Blit::ColorReplace>(ShaderSurface(reference), src, ShaderScalar(shade), ShaderScalar((color - 1) << 4));
+					else
+						ShaderDraw<Blit::StandartShade>(ShaderSurface(reference), src, ShaderScalar(shade));
+
+					for (int row = 0; row < 200; ++row)
+					{
+						const Uint8 *expected = (Uint8*)reference->getSurface()->pixels + row * reference->getSurface()->pitch;
+						const char *differs = 0;
+						if (memcmp((Uint8*)_surface->getSurface()->pixels + row * _surface->getSurface()->pitch, expected, 320))
+							differs = "Surface::blitNShade";
+						else if (memcmp((Uint8*)spans->getSurface()->pixels + row * spans->getSurface()->pitch, expected, 320))
+							differs = "SpanSprite::blitNShade";
+						else if (shadedSpans && memcmp((Uint8*)shaded->getSurface()->pixels + row * shaded->getSurface()->pitch, expected, 320))
+							differs = "SurfaceSet::getShadedSpans";
+						if (differs)
+						{
+							delete reference;
+							delete spans;
+							delete shaded;
+							std::ostringstream ss;
+							ss << differs << " differs from ShaderDraw at " << x << "," << y << " shade " << shade << " half " << half << " color " << color;
+							throw Exception(ss.str());
+						}
+					}
+				}
+			}
+		}
+	}
+	delete reference;
+	delete spans;
+	delete shaded;
+	*_out << "Blit kernels: " << Blit::getKernels() << ", same as ShaderDraw" << std::endl;
+	*_out << "Sprite size: " << _sprite->getWidth() * _sprite->getHeight() << " bytes, " << _spans->getSize() << " as spans, " << _sprites->getShadedSize() << " shaded ahead of time" << std::endl;
+}
+
+/**
+ * The cheapest ways to the tiles of the map found by the old path search:
+ * the TU cost of each, and the tile and direction of their last step.
+ */
+struct FifoSearch
+{
+	std::vector<int> cost, prevTile, prevDir;
+};
+
+/**
+ * Finds the cheapest paths the way Pathfinding did before it used A*: a tile is queued
+ * again whenever a cheaper way to it turns up, until no way cheaper than the one to the
+ * end is left. Without an end, it goes on until the cheapest way to every tile is known.
+ * @param battle Pointer to the battle.
+ * @param unit Unit to find the paths for.
+ * @param end Where the path ends, or 0 for every tile.
+ * @param search Pointer to put the ways found in.
+ */
+static void searchPathFifo(SavedBattleGame *battle, BattleUnit *unit, const Position *end, FifoSearch *search)
+{
+	Pathfinding *pathfinding = battle->getPathfinding();
+	int size = battle->getWidth() * battle->getLength() * battle->getHeight();
+	search->cost.assign(size, -1);
+	search->prevTile.assign(size, -1);
+	search->prevDir.assign(size, -1);
+	int endIndex = end ? battle->getTileIndex(*end) : -1;
+	std::list<Position> open;
+	search->cost[battle->getTileIndex(unit->getPosition())] = 0;
+	open.push_back(unit->getPosition());
+	while (!open.empty())
+	{
+		Position current = open.front(), next;
+		open.pop_front();
+		int currentIndex = battle->getTileIndex(current);
+		for (int direction = 0; direction < 10; ++direction)
+		{
+			int tuCost = pathfinding->getTUCost(current, direction, &next, unit);
+			if (tuCost < 255)
+			{
+				int index = battle->getTileIndex(next);
+				int total = search->cost[currentIndex] + tuCost;
+				if ((search->cost[index] == -1 || search->cost[index] > total)
+					&& (endIndex == -1 || search->cost[endIndex] == -1 || search->cost[endIndex] > total))
+				{
+					search->cost[index] = total;
+					search->prevTile[index] = currentIndex;
+					search->prevDir[index] = direction;
+					open.push_back(next);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Moves the end of a path up the stairs or down to a floor, the way Pathfinding
+ * did before it used A*.
+ * @param battle Pointer to the battle.
+ * @param unit Unit to find the path for.
+ * @param end Pointer to where the path ends.
+ * @return False if the unit can't stand at the end.
+ */
+static bool adjustEndFifo(SavedBattleGame *battle, BattleUnit *unit, Position *end)
+{
+	MovementType movementType = unit->getArmor()->getMovementType();
+	Position start = unit->getPosition();
+	Tile *tile = battle->getTile(*end);
+	if (tile == 0 || (tile->getUnit() && tile->getUnit() != unit)
+		|| tile->getTUCost(MapData::O_FLOOR, movementType) == 255 || tile->getTUCost(MapData::O_OBJECT, movementType) == 255)
+		return false;
+
+	// going up the stairs from on or right in front of them, north-south first, then east-west
+	for (int i = 0; i < 2; ++i)
+	{
+		Position step = i ? Position(1, 0, 0) : Position(0, 1, 0);
+		Tile *upper = battle->getTile(*end + step), *lower = battle->getTile(*end + step + step);
+		if (upper && upper->getTerrainLevel() == -16)
+		{
+			if (lower && lower->getTerrainLevel() != -8)
+				break;
+			if (start == *end + step || start == *end + step + step || start == *end + step + step + step)
+			{
+				end->z++;
+				break;
+			}
+		}
+	}
+
+	// falling down to a floor, or onto a unit or an object
+	tile = battle->getTile(*end);
+	while (movementType != MT_FLY && tile && end->z > 0)
+	{
+		Position below = *end + Position(0, 0, -1);
+		BattleUnit *standing = battle->selectUnit(below);
+		Tile *belowTile = battle->getTile(below);
+		if ((standing && standing != unit)
+			|| (belowTile->getMapData(MapData::O_OBJECT) && belowTile->getMapData(MapData::O_OBJECT)->getTerrainLevel() == 0)
+			|| !tile->hasNoFloor())
+			break;
+		*end = below;
+		tile = belowTile;
+	}
+	return true;
+}
+
+/**
+ * Counts the cheapest ways to every tile, up to two, from the TU costs of
+ * the cheapest ways to every tile. Two ways that only differ in which
+ * direction is taken first count as two.
+ * @param battle Pointer to the battle.
+ * @param unit Unit the ways are for.
+ * @param cost TU cost of the cheapest way to every tile, as found by searchPathFifo.
+ * @param ways Pointer to put the count for every tile in.
+ * @return False if a step on the way costs no TUs, so the ways can't be counted in order.
+ */
+static bool countCheapestPaths(SavedBattleGame *battle, BattleUnit *unit, const std::vector<int> &cost, std::vector<int> *ways)
+{
+	Pathfinding *pathfinding = battle->getPathfinding();
+	std::vector<std::pair<int, int> > order;
+	for (int i = 0; i < (int)cost.size(); ++i)
+	{
+		if (cost[i] != -1)
+			order.push_back(std::make_pair(cost[i], i));
+	}
+	std::sort(order.begin(), order.end());
+	ways->assign(cost.size(), 0);
+	(*ways)[battle->getTileIndex(unit->getPosition())] = 1;
+	for (std::vector<std::pair<int, int> >::iterator i = order.begin(); i != order.end(); ++i)
+	{
+		int x, y, z;
+		battle->getTileCoords(i->second, &x, &y, &z);
+		Position current(x, y, z), next;
+		for (int direction = 0; direction < 10; ++direction)
+		{
+			int tuCost = pathfinding->getTUCost(current, direction, &next, unit);
+			if (tuCost < 255 && cost[battle->getTileIndex(next)] == i->first + tuCost)
+			{
+				if (tuCost == 0)
+					return false;
+				int &count = (*ways)[battle->getTileIndex(next)];
+				count = std::min(count + (*ways)[i->second], 2);
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Takes all the steps of the path Pathfinding has ready.
+ * @param pathfinding Pointer to the pathfinding.
+ * @return Directions of the steps, in the order they are taken.
+ */
+static std::vector<int> takePath(Pathfinding *pathfinding)
+{
+	std::vector<int> path;
+	for (int direction = pathfinding->dequeuePath(); direction != -1; direction = pathfinding->dequeuePath())
+	{
+		path.push_back(direction);
+	}
+	return path;
+}
+
+/**
+ * Follows a path and adds up the TU cost of its steps.
+ * @param battle Pointer to the battle.
+ * @param unit Unit to follow the path with.
+ * @param path Directions of the steps.
+ * @param end Pointer to put where the path ends in.
+ * @return TU cost, or -1 if a step is blocked.
+ */
+static int followPath(SavedBattleGame *battle, BattleUnit *unit, const std::vector<int> &path, Position *end)
+{
+	Position pos = unit->getPosition(), next;
+	int cost = 0;
+	for (std::vector<int>::const_iterator i = path.begin(); i != path.end(); ++i)
+	{
+		int tuCost = battle->getPathfinding()->getTUCost(pos, *i, &next, unit);
+		if (tuCost >= 255)
+			return -1;
+		cost += tuCost;
+		pos = next;
+	}
+	*end = pos;
+	return cost;
+}
+
+/**
+ * A path found the way Pathfinding did before it used A*.
+ */
+struct FifoPath
+{
+	Position end;
+	std::vector<int> steps;
+	int cost;
+	bool straight, unique;
+};
+
+/**
+ * Checks that Pathfinding finds the same paths as the old search, on maps of every stock
+ * terrain with the UFOs, the terror mission and the base defence. For up to three units of
+ * every side, paths are found to every tile within two tiles, on the unit's level and the
+ * ones above and below, and to tiles picked at random all over the map. The end must be
+ * moved the same way and the same straight paths taken. Otherwise the path must reach the
+ * same tiles, cost as many TUs as the cheapest one the old search finds, and take the
+ * same steps wherever only one path is the cheapest. Paths followed back from a unit's
+ * reachability are checked the same way, along with the TU cost it gives.
+ * The maps are generated before the benchmark's own battle, which replaces them.
+ */
+void Benchmark::verifyPaths()
+{
+	struct Mission
+	{
+		const char *terrain, *type, *ufo;
+		int texture;
+		double latitude;
+	};
+	const Mission missions[] =
+	{
+		{ "URBAN", "STR_TERROR_MISSION", "", 1, 0.0 },
+		{ "FOREST", "STR_UFO_CRASH_RECOVERY", "STR_SMALL_SCOUT", 0, -0.5 },
+		{ "JUNGLE", "STR_UFO_CRASH_RECOVERY", "STR_MEDIUM_SCOUT", 0, 0.5 },
+		{ "CULTA", "STR_UFO_CRASH_RECOVERY", "STR_LARGE_SCOUT", 1, 0.0 },
+		{ "MOUNT", "STR_UFO_CRASH_RECOVERY", "STR_SMALL_SCOUT", 5, 0.0 },
+		{ "DESERT", "STR_UFO_CRASH_RECOVERY", "STR_MEDIUM_SCOUT", 7, 0.0 },
+		{ "POLAR", "STR_UFO_CRASH_RECOVERY", "STR_LARGE_SCOUT", 9, 0.0 },
+		{ "XBASE", "STR_BASE_DEFENCE", "", 0, 0.0 }
+	};
+	for (int m = 0; m < 8; ++m)
+	{
+		BattleSimulator simulator(_game, missions[m].type, missions[m].texture, 0);
+		if (*missions[m].ufo)
+		{
+			simulator.setUfo(missions[m].ufo, missions[m].latitude);
+		}
+		SavedBattleGame *battle = simulator.generate();
+		Pathfinding *pathfinding = battle->getPathfinding();
+		int width = battle->getWidth(), length = battle->getLength(), height = battle->getHeight();
+		std::vector<Position> far;
+		for (int i = 0; i < 10000 && far.size() < 24; ++i)
+		{
+			Position pos(RNG::generate(0, width - 1, RNG::MAP), RNG::generate(0, length - 1, RNG::MAP), RNG::generate(0, height - 1, RNG::MAP));
+			Tile *tile = battle->getTile(pos);
+			if (!tile->hasNoFloor() && !tile->getUnit())
+			{
+				far.push_back(pos);
+			}
+		}
+
+		int paths = 0, straight = 0, unique = 0, unreachable = 0;
+		int picked[3] = { 0, 0, 0 };
+		for (std::vector<BattleUnit*>::iterator i = battle->getUnits()->begin(); i != battle->getUnits()->end(); ++i)
+		{
+			if ((*i)->isOut() || picked[(*i)->getFaction()] == 3)
+				continue;
+			picked[(*i)->getFaction()]++;
+			Position start = (*i)->getPosition();
+			std::vector<Position> ends(far);
+			for (int z = -1; z <= 1; ++z)
+			{
+				for (int y = -2; y <= 2; ++y)
+				{
+					for (int x = -2; x <= 2; ++x)
+					{
+						Position pos = start + Position(x, y, z);
+						if (pos != start && battle->getTile(pos))
+						{
+							ends.push_back(pos);
+						}
+					}
+				}
+			}
+
+			FifoSearch all;
+			std::vector<int> ways;
+			searchPathFifo(battle, *i, 0, &all);
+			bool counted = countCheapestPaths(battle, *i, all.cost, &ways);
+
+			// the way the old search went; the straight paths need Pathfinding set up for the unit
+			pathfinding->calculate(*i, start);
+			std::vector<FifoPath> expected(ends.size());
+			for (size_t j = 0; j < ends.size(); ++j)
+			{
+				FifoPath &old = expected[j];
+				old.end = ends[j];
+				old.cost = -1;
+				old.straight = false;
+				old.unique = false;
+				if (!adjustEndFifo(battle, *i, &old.end))
+					continue;
+				pathfinding->abortPath();
+				if (start.z == old.end.z && pathfinding->bresenhamPath(start, old.end))
+				{
+					old.steps = takePath(pathfinding);
+					std::reverse(old.steps.begin(), old.steps.end());
+					Position reached;
+					old.cost = followPath(battle, *i, old.steps, &reached);
+					old.straight = true;
+					straight++;
+				}
+				else
+				{
+					int index = battle->getTileIndex(old.end);
+					FifoSearch search;
+					pathfinding->abortPath();
+					searchPathFifo(battle, *i, &old.end, &search);
+					old.cost = search.cost[index];
+					for (int tile = index; old.cost != -1 && search.prevTile[tile] != -1; tile = search.prevTile[tile])
+					{
+						old.steps.push_back(search.prevDir[tile]);
+					}
+					std::reverse(old.steps.begin(), old.steps.end());
+					old.unique = counted && ways[index] == 1;
+					if (old.unique)
+						unique++;
+				}
+				if (old.cost == -1)
+					unreachable++;
+			}
+
+			for (int cached = 0; cached < 2; ++cached)
+			{
+				pathfinding->invalidateReachability();
+				for (size_t j = 0; j < ends.size(); ++j)
+				{
+					const FifoPath &old = expected[j];
+					int reachCost = -2;
+					if (cached)
+					{
+						reachCost = pathfinding->getReachCost(*i, ends[j]);
+					}
+					pathfinding->calculate(*i, ends[j]);
+					std::vector<int> steps = takePath(pathfinding);
+					Position reached = start;
+					int cost = followPath(battle, *i, steps, &reached);
+					if (steps.empty() && start != old.end)
+						cost = -1;
+
+					std::string differs;
+					if (cost != old.cost)
+						differs = "costs a different number of TUs";
+					else if (cost != -1 && reached != old.end)
+						differs = "ends somewhere else";
+					else if ((old.straight || old.unique) && steps != old.steps)
+						differs = old.straight ? "takes another straight path" : "leaves the only cheapest path";
+					else if (cached && reachCost != (old.cost == -1 ? -1 : all.cost[battle->getTileIndex(old.end)]))
+						differs = "has another reach cost";
+					if (!differs.empty())
+					{
+						std::ostringstream ss;
+						ss << "Pathfinding::calculate" << (cached ? " from the reachability" : "") << " on " << missions[m].terrain << " " << differs
+							<< " than the old search from " << start.x << "," << start.y << "," << start.z << " to " << ends[j].x << "," << ends[j].y << "," << ends[j].z
+							<< ": " << cost << " TUs, the old search " << old.cost;
+						throw Exception(ss.str());
+					}
+				}
+			}
+			paths += ends.size();
+		}
+		pathfinding->invalidateReachability();
+		*_out << "Pathfinding on " << missions[m].terrain << ": " << paths << " paths, " << straight << " straight, " << unique << " with one cheapest path, "
+			<< unreachable << " unreachable, same as the old search" << std::endl;
+	}
+}
+
+/**
+ * Discovers the tiles a soldier sees the way TileEngine::calculateFOV did before it
+ * walked precomputed sight lines: a line is traced to every tile in the view cone.
+ * @param battle Pointer to the battle.
+ * @param unit The soldier.
+ */
+static void discoverTilesSweep(SavedBattleGame *battle, BattleUnit *unit)
+{
+	const int viewDistance = 20; // TileEngine::MAX_VIEW_DISTANCE
+	const int signX[8] = { +1, +1, +1, +1, -1, -1, -1, -1 };
+	const int signY[8] = { -1, -1, -1, +1, +1, +1, -1, -1 };
+	Position center = unit->getPosition(), test;
+	int direction = unit->getDirection();
+	bool swap = (direction == 0 || direction == 4);
+	for (int x = 0; x <= viewDistance; ++x)
+	{
+		int y1 = direction % 2 ? 0 : -x;
+		int y2 = direction % 2 ? viewDistance - x : x;
+		for (int y = y1; y <= y2; ++y)
+		{
+			for (int z = 0; z < battle->getHeight(); z++)
+			{
+				int distance = int(floor(sqrt(float(x*x + y*y)) + 0.5));
+				if (distance <= viewDistance)
+				{
+					test.x = center.x + signX[direction] * (swap ? y : x);
+					test.y = center.y + signY[direction] * (swap ? x : y);
+					test.z = z;
+					if (battle->getTile(test))
+					{
+						battle->getTileEngine()->calculateLine(center, test, false, 0, unit, false);
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Checks that every soldier, facing each way, discovers exactly the same tiles
+ * with the precomputed sight lines as by tracing a line to every tile in the view
+ * cone, the way it used to. The fog of war is put back afterwards.
+ */
+void Benchmark::verifyFOV()
+{
+	TileEngine *tileEngine = _battle->getTileEngine();
+	Uint8 *discovered = _battle->getTileGrid()->getDiscovered();
+	int size = _battle->getTileGrid()->getSize();
+	std::vector<Uint8> original(discovered, discovered + size), expected;
+	int cones = 0;
+	for (std::vector<BattleUnit*>::iterator i = _battle->getUnits()->begin(); i != _battle->getUnits()->end(); ++i)
+	{
+		if ((*i)->getFaction() != FACTION_PLAYER || (*i)->isOut())
+			continue;
+		int direction = (*i)->getDirection();
+		for (int d = 0; d < 8; ++d)
+		{
+			(*i)->setDirection(d);
+			std::fill(discovered, discovered + size, 0);
+			discoverTilesSweep(_battle, *i);
+			expected.assign(discovered, discovered + size);
+			std::fill(discovered, discovered + size, 0);
+			tileEngine->invalidateSight();
+			tileEngine->calculateFOV(*i);
+			for (int t = 0; t < size; ++t)
+			{
+				if (discovered[t] != expected[t])
+				{
+					const Position &pos = _battle->getTiles()[t]->getPosition();
+					const Position &center = (*i)->getPosition();
+					std::ostringstream ss;
+					ss << "TileEngine::calculateFOV from " << center.x << "," << center.y << "," << center.z << " facing " << d
+						<< " discovers " << (int)discovered[t] << " at " << pos.x << "," << pos.y << "," << pos.z << ", tracing every line " << (int)expected[t];
+					throw Exception(ss.str());
+				}
+			}
+			cones++;
+		}
+		(*i)->setDirection(direction);
+	}
+	std::copy(original.begin(), original.end(), discovered);
+	tileEngine->invalidateSight();
+	tileEngine->calculateFOV(*_battle->getUnits());
+	*_out << "Field of view: " << cones << " view cones, same tiles as tracing every line" << std::endl;
+}
+
+/**
+ * Adds circular light around a light source the way TileEngine did before it
+ * used light stamps: every level of every tile within range of the source gets
+ * the power of the source less the distance, if that's more than it had.
+ * @param battle Pointer to the battle.
+ * @param center Position of the light source.
+ * @param power Power of the light source.
+ * @param light Light of every tile.
+ */
+static void addLightSweep(SavedBattleGame *battle, const Position &center, int power, std::vector<int> *light)
+{
+	const int signX[4] = { +1, -1, -1, +1 };
+	const int signY[4] = { +1, -1, +1, -1 };
+	for (int x = 0; x <= power; ++x)
+	{
+		for (int y = 0; y <= power; ++y)
+		{
+			int distance = int(floor(sqrt(float(x*x + y*y)) + 0.5));
+			for (int z = 0; z < battle->getHeight(); ++z)
+			{
+				for (int quadrant = 0; quadrant < 4; ++quadrant)
+				{
+					Position pos(center.x + x * signX[quadrant], center.y + y * signY[quadrant], z);
+					if (battle->getTile(pos))
+					{
+						int &current = (*light)[battle->getTileIndex(pos)];
+						current = std::max(current, power - distance);
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Lights the whole map from scratch the way TileEngine did before it kept its
+ * light sources: the sun, shaded by roofs found by looking down every column;
+ * the floors, objects, fires and flares; and the soldiers' personal light.
+ * @param battle Pointer to the battle.
+ * @param personalLighting Do soldiers give off light?
+ * @param light Pointer to the three light layers to put the light of every tile in.
+ */
+static void calculateLightingSweep(SavedBattleGame *battle, bool personalLighting, std::vector<int> light[3])
+{
+	const int fireLightPower = 15, personalLightPower = 15;
+	int size = battle->getWidth() * battle->getLength() * battle->getHeight();
+	for (int layer = 0; layer < 3; ++layer)
+	{
+		light[layer].assign(size, 0);
+	}
+	for (int i = 0; i < size; ++i)
+	{
+		Tile *tile = battle->getTiles()[i];
+		Position pos = tile->getPosition();
+		int power = 15 - battle->getGlobalShade();
+		if (battle->getGlobalShade() <= 4
+			&& battle->getTileEngine()->verticalBlockage(battle->getTile(Position(pos.x, pos.y, battle->getHeight() - 1)), tile, DT_NONE))
+		{
+			power -= 2;
+		}
+		light[0][i] = std::max(power, 0);
+
+		// only floors and objects can light up
+		const int parts[2] = { MapData::O_FLOOR, MapData::O_OBJECT };
+		for (int part = 0; part < 2; ++part)
+		{
+			MapData *data = tile->getMapData(parts[part]);
+			if (data && data->getLightSource())
+			{
+				addLightSweep(battle, pos, data->getLightSource(), &light[1]);
+			}
+		}
+		if (tile->getFire())
+		{
+			addLightSweep(battle, pos, fireLightPower, &light[1]);
+		}
+		for (std::vector<BattleItem*>::iterator j = tile->getInventory()->begin(); j != tile->getInventory()->end(); ++j)
+		{
+			if ((*j)->getRules()->getBattleType() == BT_FLARE)
+			{
+				addLightSweep(battle, pos, (*j)->getRules()->getPower(), &light[1]);
+			}
+		}
+	}
+	if (personalLighting)
+	{
+		for (std::vector<BattleUnit*>::iterator i = battle->getUnits()->begin(); i != battle->getUnits()->end(); ++i)
+		{
+			if ((*i)->getFaction() == FACTION_PLAYER && !(*i)->isOut())
+			{
+				addLightSweep(battle, (*i)->getPosition(), personalLightPower, &light[2]);
+			}
+		}
+	}
+}
+
+/**
+ * Checks that all three light layers of every tile are the same as when
+ * the whole map is lit from scratch.
+ * @param battle Pointer to the battle.
+ * @param personalLighting Do soldiers give off light?
+ * @param step What was just done to the battle.
+ */
+static void checkLighting(SavedBattleGame *battle, bool personalLighting, const std::string &step)
+{
+	const char *layers[3] = { "sun", "terrain", "unit" };
+	std::vector<int> light[3];
+	calculateLightingSweep(battle, personalLighting, light);
+	for (int layer = 0; layer < 3; ++layer)
+	{
+		const Uint8 *current = battle->getTileGrid()->getLight(layer);
+		for (int i = 0; i < (int)light[layer].size(); ++i)
+		{
+			if (current[i] != light[layer][i])
+			{
+				Position pos = battle->getTiles()[i]->getPosition();
+				std::ostringstream ss;
+				ss << "TileEngine " << layers[layer] << " light after " << step << " is " << (int)current[i] << " at "
+					<< pos.x << "," << pos.y << "," << pos.z << ", lit from scratch " << light[layer][i];
+				throw Exception(ss.str());
+			}
+		}
+	}
+}
+
+/**
+ * Checks that the light the TileEngine keeps up to date, by relighting only
+ * around the light sources that changed, is the same on every tile and layer
+ * as the whole map lit from scratch the old way. On a terror mission of its
+ * own: a soldier steps around, a flare is dropped, thrown further and picked
+ * up, fires start and are put out, street lights are blown up, an incendiary
+ * sets the street on fire that then spreads and burns out over a few turns,
+ * night falls and personal lighting is turned off and on again.
+ */
+void Benchmark::verifyLighting()
+{
+	BattleSimulator simulator(_game, "STR_TERROR_MISSION", 1, 0);
+	SavedBattleGame *battle = simulator.generate();
+	TileEngine *tileEngine = battle->getTileEngine();
+	bool personalLighting = true;
+	int checks = 0;
+	checkLighting(battle, personalLighting, "generating the map");
+	checks++;
+
+	BattleUnit *soldier = 0;
+	for (std::vector<BattleUnit*>::iterator i = battle->getUnits()->begin(); i != battle->getUnits()->end() && !soldier; ++i)
+	{
+		if ((*i)->getFaction() == FACTION_PLAYER && !(*i)->isOut())
+			soldier = *i;
+	}
+	Position start = soldier->getPosition();
+
+	// a soldier steps to every free tile around and back
+	for (int direction = 0; direction < 8; ++direction)
+	{
+		Position step;
+		Pathfinding::directionToVector(direction, &step);
+		Tile *tile = battle->getTile(start + step);
+		if (!tile || tile->getUnit() || tile->hasNoFloor())
+			continue;
+		for (int back = 0; back < 2; ++back)
+		{
+			Position pos = back ? start : start + step;
+			battle->getTile(soldier->getPosition())->setUnit(0);
+			soldier->setPosition(pos);
+			battle->getTile(pos)->setUnit(soldier);
+			tileEngine->calculateUnitLighting();
+			checkLighting(battle, personalLighting, "a soldier's step");
+			checks++;
+		}
+	}
+
+	// a flare is dropped, thrown further and picked up again
+	BattleItem *flare = new BattleItem(_game->getRuleset()->getItem("STR_ELECTRO_FLARE"), battle->getCurrentItemId());
+	battle->getItems()->push_back(flare);
+	Tile *flareTiles[2] = { battle->getTile(start), battle->getTile(Position(std::min(start.x + 6, battle->getWidth() - 1), start.y, start.z)) };
+	flareTiles[0]->addItem(flare);
+	tileEngine->calculateTerrainLighting();
+	checkLighting(battle, personalLighting, "dropping a flare");
+	flareTiles[0]->removeItem(flare);
+	flareTiles[1]->addItem(flare);
+	tileEngine->calculateTerrainLighting();
+	checkLighting(battle, personalLighting, "throwing a flare");
+	flareTiles[1]->removeItem(flare);
+	tileEngine->calculateTerrainLighting();
+	checkLighting(battle, personalLighting, "picking up a flare");
+	checks += 3;
+
+	// fires start around the soldier and are put out
+	for (int fire = 3; fire >= 0; fire -= 3)
+	{
+		for (int x = -2; x <= 2; x += 2)
+		{
+			Tile *tile = battle->getTile(start + Position(x, 3, 0));
+			if (tile)
+				tile->setFire(fire);
+		}
+		tileEngine->calculateTerrainLighting();
+		checkLighting(battle, personalLighting, fire ? "starting fires" : "putting out fires");
+		checks++;
+	}
+
+	// street lights are blown up
+	int lights = 0;
+	for (int i = 0; i < battle->getWidth() * battle->getLength() * battle->getHeight() && lights < 3; ++i)
+	{
+		Tile *tile = battle->getTiles()[i];
+		MapData *object = tile->getMapData(MapData::O_OBJECT);
+		if (object && object->getLightSource() && tile->getPosition().z == 0)
+		{
+			Position pos = tile->getPosition();
+			tileEngine->explode(Position(pos.x * 16 + 8, pos.y * 16 + 8, pos.z * 24 + 12), 120, DT_HE, 4);
+			tileEngine->calculateUnitLighting();
+			checkLighting(battle, personalLighting, "blowing up a light");
+			checks++;
+			lights++;
+		}
+	}
+
+	// an incendiary sets the street on fire, which spreads and burns out over the next turns
+	tileEngine->explode(Position(start.x * 16 + 8, (start.y + 4) * 16 + 8, start.z * 24 + 12), 60, DT_IN, 4);
+	checkLighting(battle, personalLighting, "an incendiary");
+	checks++;
+	for (int turn = 0; turn < 8; ++turn)
+	{
+		battle->prepareNewTurn();
+		tileEngine->calculateUnitLighting();
+		checkLighting(battle, personalLighting, "a new turn with fires");
+		checks++;
+	}
+
+	// night falls, and personal lighting is turned off and on again
+	battle->setGlobalShade(10);
+	tileEngine->calculateSunShading();
+	checkLighting(battle, personalLighting, "nightfall");
+	for (int toggle = 0; toggle < 2; ++toggle)
+	{
+		tileEngine->togglePersonalLighting();
+		personalLighting = !personalLighting;
+		checkLighting(battle, personalLighting, "toggling personal lighting");
+	}
+	checks += 3;
+
+	*_out << "Lighting: " << checks << " changes, " << lights << " lights blown up, same as lit from scratch" << std::endl;
+}
+
+/**
+ * Copies the pixels of a surface, row by row.
+ * @param surface Pointer to the surface.
+ * @return The pixels.
+ */
+static std::vector<Uint8> getPixels(Surface *surface)
+{
+	SDL_Surface *s = surface->getSurface();
+	std::vector<Uint8> pixels(s->w * s->h);
+	for (int y = 0; y < s->h; ++y)
+	{
+		memcpy(&pixels[y * s->w], (Uint8*)s->pixels + y * s->pitch, s->w);
+	}
+	return pixels;
+}
+
+/**
+ * Draws the terrain of the tiles in view the way Map::drawTerrain did before it
+ * had a draw list: looping over every level, row and column, looking up the
+ * sprites of each tile as it goes.
+ * @param battle Pointer to the battle.
+ * @param camera Pointer to the map's camera.
+ * @param floorItems Sprites of items lying on the ground.
+ * @param spriteWidth Width of a tile sprite.
+ * @param spriteHeight Height of a tile sprite.
+ * @param surface Surface to draw on.
+ */
+static void drawTerrainSweep(SavedBattleGame *battle, Camera *camera, SurfaceSet *floorItems, int spriteWidth, int spriteHeight, Surface *surface)
+{
+	int beginX = 0, endX = battle->getWidth() - 1;
+	int beginY = 0, endY = battle->getLength() - 1;
+	int beginZ = 0, endZ = camera->getViewHeight();
+	int dummy;
+	Position mapPosition, screenPosition;
+
+	camera->convertScreenToMap(0, 0, &beginX, &dummy);
+	camera->convertScreenToMap(surface->getWidth(), 0, &dummy, &beginY);
+	camera->convertScreenToMap(surface->getWidth(), surface->getHeight(), &endX, &dummy);
+	camera->convertScreenToMap(0, surface->getHeight(), &dummy, &endY);
+	beginY -= (camera->getViewHeight() * 2);
+	beginX -= (camera->getViewHeight() * 2);
+	beginX = std::max(beginX, 0);
+	beginY = std::max(beginY, 0);
+
+	for (int itZ = beginZ; itZ <= endZ; itZ++)
+	{
+		for (int itX = beginX; itX <= endX; itX++)
+		{
+			for (int itY = beginY; itY <= endY; itY++)
+			{
+				mapPosition = Position(itX, itY, itZ);
+				camera->convertMapToScreen(mapPosition, &screenPosition);
+				screenPosition += camera->getMapOffset();
+				if (screenPosition.x <= -spriteWidth || screenPosition.x >= surface->getWidth() + spriteWidth ||
+					screenPosition.y <= -spriteHeight || screenPosition.y >= surface->getHeight() + spriteHeight)
+					continue;
+				Tile *tile = battle->getTile(mapPosition);
+				if (!tile)
+					continue;
+				int tileShade = tile->isDiscovered(2) ? tile->getShade() : 16;
+
+				Surface *sprite = tile->getSprite(MapData::O_FLOOR);
+				if (sprite)
+					sprite->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_FLOOR)->getYOffset(), tileShade, false, tile->getMarkerColor());
+				if (tile->isVoid())
+					continue;
+
+				const int walls[2] = { MapData::O_WESTWALL, MapData::O_NORTHWALL };
+				for (int i = 0; i < 2; ++i)
+				{
+					sprite = tile->getSprite(walls[i]);
+					if (!sprite)
+						continue;
+					MapData *data = tile->getMapData(walls[i]);
+					int wallShade = tileShade;
+					if ((data->isDoor() || data->isUFODoor()) && (tile->isDiscovered(0) || tile->isDiscovered(1)))
+						wallShade = 0;
+					bool half = (walls[i] == MapData::O_NORTHWALL && tile->getMapData(MapData::O_WESTWALL));
+					sprite->blitNShade(surface, screenPosition.x, screenPosition.y - data->getYOffset(), wallShade, half);
+				}
+				if (tile->getMapData(MapData::O_OBJECT))
+				{
+					sprite = tile->getSprite(MapData::O_OBJECT);
+					if (sprite)
+						sprite->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_OBJECT)->getYOffset(), tileShade);
+				}
+				int item = tile->getTopItemSprite();
+				if (item != -1)
+				{
+					floorItems->getFrame(item)->blitNShade(surface, screenPosition.x, screenPosition.y + tile->getTerrainLevel(), tileShade);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Draws the map from its terrain layer, and then in full, tile by tile,
+ * and checks that every pixel came out the same. The terrain layer, drawn
+ * from the draw list, is also checked against the terrain drawn the way
+ * it was before there was a draw list.
+ * @param step What changed since the last frame, for the error.
+ */
+void Benchmark::checkMap(const std::string &step)
+{
+	_map->setFullRedraw(false);
+	_map->draw();
+	std::vector<Uint8> layered = getPixels(_map);
+	_map->setFullRedraw(true);
+	_map->draw();
+	_map->setFullRedraw(false);
+	std::vector<Uint8> full = getPixels(_map);
+	ResourcePack *res = _game->getResourcePack();
+	Surface *blank = res->getSurfaceSet("BLANKS.PCK")->getFrame(0);
+	_surface->clear();
+	drawTerrainSweep(_battle, _map->getCamera(), res->getSurfaceSet("FLOOROB.PCK"), blank->getWidth(), blank->getHeight(), _surface);
+	std::vector<Uint8> terrain = getPixels(_map->getTerrain()), sweep = getPixels(_surface);
+	for (size_t i = 0; i < full.size(); ++i)
+	{
+		const char *differs = 0;
+		if (layered[i] != full[i])
+			differs = "Map::drawTerrain from the terrain layer differs from drawing in full";
+		else if (terrain[i] != sweep[i])
+			differs = "The terrain drawn from MapDrawList differs from drawing tile by tile";
+		if (differs)
+		{
+			std::ostringstream ss;
+			ss << differs << " at " << i % _map->getWidth() << "," << i / _map->getWidth() << " after " << step;
+			throw Exception(ss.str());
+		}
+	}
+}
+
+/**
+ * Moves a unit to another tile straight away, the way it ends up after walking there.
+ * @param map Pointer to the map.
+ * @param battle Pointer to the battle.
+ * @param unit The unit.
+ * @param position Where it goes.
+ * @param direction Which way it faces.
+ */
+static void moveUnit(Map *map, SavedBattleGame *battle, BattleUnit *unit, const Position &position, int direction)
+{
+	battle->getTile(unit->getPosition())->setUnit(0);
+	unit->setPosition(position);
+	unit->setDirection(direction);
+	battle->getTile(position)->setUnit(unit);
+	unit->setCache(0);
+	map->cacheUnit(unit);
+}
+
+/**
+ * Checks that the map drawn on a copy of its terrain layer, with only the
+ * areas around what moves drawn again, looks exactly the same as the map
+ * drawn in full, frame after frame: while the cursor moves, a soldier walks
+ * around, doors open, animate and close, tiles catch fire and start smoking,
+ * the view goes up a level and it scrolls, a few pixels or most of the way
+ * across at a time. Every frame the terrain drawn from the draw list is also
+ * checked against the terrain drawn tile by tile, the way it used to be.
+ * The battle is put back afterwards.
+ */
+void Benchmark::verifyMap()
+{
+	TileEngine *tileEngine = _battle->getTileEngine();
+	Camera *camera = _map->getCamera();
+	Uint8 *discovered = _battle->getTileGrid()->getDiscovered();
+	std::vector<Uint8> fog(discovered, discovered + _battle->getTileGrid()->getSize());
+	int frames = 0;
+
+	camera->centerOnPosition(_unit->getPosition(), false);
+	checkMap("centering on a soldier");
+	checkMap("nothing changing");
+	frames += 2;
+
+	for (int i = 0; i < 8; ++i)
+	{
+		_map->setCursorType(i < 4 ? CT_NORMAL : CT_AIM, i == 3 ? 2 : 1);
+		_map->setSelectorPosition(24 + i * 37, 20 + i * 21);
+		checkMap("moving the cursor");
+		frames++;
+	}
+	_map->setCursorType(CT_NORMAL);
+
+	Position start = _unit->getPosition();
+	int direction = _unit->getDirection();
+	for (int d = 0; d < 8; ++d)
+	{
+		Position to;
+		Pathfinding::directionToVector(d, &to);
+		to += _unit->getPosition();
+		Tile *tile = _battle->getTile(to);
+		if (!tile || tile->getUnit() || !tile->getMapData(MapData::O_FLOOR) || tile->getMapData(MapData::O_OBJECT))
+			continue;
+		moveUnit(_map, _battle, _unit, to, d);
+		tileEngine->calculateFOV(_unit);
+		checkMap("moving a soldier");
+		frames++;
+	}
+	moveUnit(_map, _battle, _unit, start, direction);
+	checkMap("moving a soldier back");
+	frames++;
+
+	int doors = 0;
+	for (int t = 0; t < _battle->getTileGrid()->getSize() && doors < 4; ++t)
+	{
+		Tile *tile = _battle->getTiles()[t];
+		for (int part = MapData::O_WESTWALL; part <= MapData::O_NORTHWALL; ++part)
+		{
+			MapData *data = tile->getMapData(part);
+			if (!data || (!data->isDoor() && !data->isUFODoor()))
+				continue;
+			MapData *objects[4];
+			int ids[4], sets[4];
+			for (int i = 0; i < 4; ++i)
+			{
+				objects[i] = tile->getMapData(i);
+				tile->getMapData(&ids[i], &sets[i], i);
+			}
+			camera->centerOnPosition(tile->getPosition(), false);
+			checkMap("centering on a door");
+			tile->openDoor(part);
+			tileEngine->calculateTerrainLighting();
+			tileEngine->calculateFOV(tile->getPosition());
+			checkMap("opening a door");
+			// a whole animation cycle, so the animated tiles end up as they were
+			for (int i = 0; i < 8; ++i)
+			{
+				_map->animate(false);
+				checkMap("animating the tiles");
+			}
+			for (int i = 0; i < 4; ++i)
+			{
+				tile->setMapData(objects[i], ids[i], sets[i], i);
+			}
+			tile->closeUfoDoor();
+			tileEngine->calculateTerrainLighting();
+			checkMap("closing a door");
+			frames += 11;
+			doors++;
+			break;
+		}
+	}
+
+	camera->centerOnPosition(_unit->getPosition(), false);
+	std::vector<Tile*> burning;
+	for (int x = -3; x <= 3; ++x)
+	{
+		for (int y = -3; y <= 3; ++y)
+		{
+			Tile *tile = _battle->getTile(_unit->getPosition() + Position(x, y, 0));
+			if (tile && (x + y) % 2 == 0)
+			{
+				burning.push_back(tile);
+				if (x % 2)
+					tile->addSmoke(5 + abs(x + y) * 5);
+				else
+					tile->setFire(3);
+			}
+		}
+	}
+	tileEngine->calculateTerrainLighting();
+	checkMap("setting tiles on fire");
+	for (std::vector<Tile*>::iterator i = burning.begin(); i != burning.end(); ++i)
+	{
+		(*i)->setFire(0);
+		(*i)->addSmoke(-(*i)->getSmoke());
+	}
+	tileEngine->calculateTerrainLighting();
+	checkMap("putting out the fires");
+	frames += 2;
+
+	camera->setViewHeight(1);
+	checkMap("going up a level");
+	camera->setViewHeight(0);
+	checkMap("going down a level");
+	frames += 2;
+
+	// small scrolls move the terrain layer along, big ones draw it anew
+	const int scrolls[][2] = { {8, 0}, {-8, 0}, {0, 4}, {0, -4}, {8, 4}, {-8, -4}, {-3, 7}, {5, -1}, {1, 1}, {-1, -1}, {150, 0}, {-150, 0}, {0, 90}, {0, -90}, {200, 120}, {-200, -120} };
+	int speed = Options::getInt("battleScrollSpeed");
+	camera->centerOnPosition(_unit->getPosition(), false);
+	for (int i = 0; i < 16; ++i)
+	{
+		std::ostringstream ss;
+		ss << "scrolling by " << scrolls[i][0] << "," << scrolls[i][1];
+		camera->scrollXY(scrolls[i][0], scrolls[i][1], false);
+		checkMap(ss.str());
+	}
+	for (int i = 0; i < 16; ++i)
+	{
+		camera->scrollXY(i < 8 ? speed : -speed, i < 8 ? speed / 2 : -speed / 2, false);
+		checkMap("scrolling from the edge of the screen");
+	}
+	camera->setViewHeight(1);
+	camera->scrollXY(-speed, 0, false);
+	checkMap("scrolling a level up");
+	camera->setViewHeight(0);
+	camera->scrollXY(speed, 0, false);
+	checkMap("scrolling back down");
+	for (int d = 0; d < 8; d += 2)
+	{
+		Position to;
+		Pathfinding::directionToVector(d, &to);
+		to += start;
+		Tile *tile = _battle->getTile(to);
+		if (!tile || tile->getUnit() || !tile->getMapData(MapData::O_FLOOR) || tile->getMapData(MapData::O_OBJECT))
+			continue;
+		moveUnit(_map, _battle, _unit, to, d);
+		tileEngine->calculateFOV(_unit);
+		camera->scrollXY(d < 4 ? 6 : -6, d < 4 ? -3 : 3, false);
+		checkMap("scrolling while a soldier moves");
+		moveUnit(_map, _battle, _unit, start, direction);
+		frames++;
+	}
+	frames += 34;
+
+	std::copy(fog.begin(), fog.end(), discovered);
+	tileEngine->invalidateSight();
+	tileEngine->calculateFOV(*_battle->getUnits());
+	camera->centerOnPosition(Position(_battle->getWidth() / 2, _battle->getLength() / 2, 0), false);
+	*_out << "Map: " << frames << " frames around " << doors << " doors, same from the terrain layers as drawn in full, terrain the same as drawn tile by tile" << std::endl;
+}
+
+/**
+ * Gets what every unit sees, and who sees it, sorted so lists in another order compare equal.
+ * @param battle Pointer to the battle.
+ * @param visible List to store each unit's visible units in.
+ * @param spotters List to store the units seeing each unit in.
+ */
+static void getSightMatrix(SavedBattleGame *battle, std::vector<std::vector<int> > *visible, std::vector<std::vector<int> > *spotters)
+{
+	std::vector<BattleUnit*> *units = battle->getUnits();
+	visible->assign(units->size(), std::vector<int>());
+	spotters->assign(units->size(), std::vector<int>());
+	for (size_t i = 0; i < units->size(); ++i)
+	{
+		BattleUnit *unit = units->at(i);
+		if (unit->isOut())
+			continue;
+		for (std::vector<BattleUnit*>::iterator j = unit->getVisibleUnits()->begin(); j != unit->getVisibleUnits()->end(); ++j)
+		{
+			(*visible)[i].push_back((*j)->getId());
+		}
+		const std::vector<BattleUnit*> &seenBy = battle->getTileEngine()->getSpotters(unit);
+		for (std::vector<BattleUnit*>::const_iterator j = seenBy.begin(); j != seenBy.end(); ++j)
+		{
+			if (!(*j)->isOut())
+				(*spotters)[i].push_back((*j)->getId());
+		}
+		std::sort((*visible)[i].begin(), (*visible)[i].end());
+		std::sort((*spotters)[i].begin(), (*spotters)[i].end());
+	}
+}
+
+/**
+ * Checks that who sees whom, kept up as units step around the way a walk
+ * updates it, is the same as worked out from scratch. A few soldiers and aliens
+ * step to every side and back; after every step each unit's visible units,
+ * and the units seeing each unit, are compared with what calculating every
+ * view anew with no remembered lines of sight gives. The units are put back
+ * afterwards, and the fog of war too.
+ */
+void Benchmark::verifySpotters()
+{
+	TileEngine *tileEngine = _battle->getTileEngine();
+	Uint8 *discovered = _battle->getTileGrid()->getDiscovered();
+	std::vector<Uint8> fog(discovered, discovered + _battle->getTileGrid()->getSize());
+	std::vector<std::vector<int> > visible, spotters, expectedVisible, expectedSpotters;
+	std::vector<BattleUnit*> *units = _battle->getUnits();
+	int steps = 0, pairs = 0;
+
+	tileEngine->invalidateSight();
+	tileEngine->calculateFOV(*units);
+	for (int f = 0; f < 2; ++f)
+	{
+		UnitFaction faction = f == 0 ? FACTION_PLAYER : FACTION_HOSTILE;
+		int walkers = 0;
+		for (std::vector<BattleUnit*>::iterator u = units->begin(); u != units->end() && walkers < 3; ++u)
+		{
+			BattleUnit *unit = *u;
+			if (unit->getFaction() != faction || unit->isOut() || unit->getArmor()->getSize() != 1)
+				continue;
+			walkers++;
+			Position start = unit->getPosition();
+			int direction = unit->getDirection();
+			for (int d = 0; d < 16; ++d)
+			{
+				// every other step goes back to the start
+				Position to = start;
+				int facing = d / 2;
+				if (d % 2 == 0)
+				{
+					Pathfinding::directionToVector(facing, &to);
+					to += start;
+					Tile *tile = _battle->getTile(to);
+					if (!tile || tile->getUnit() || !tile->getMapData(MapData::O_FLOOR) || tile->getMapData(MapData::O_OBJECT))
+					{
+						d++;
+						continue;
+					}
+				}
+				else
+				{
+					facing = (facing + 4) % 8;
+				}
+				moveUnit(_map, _battle, unit, to, facing);
+				tileEngine->calculateFOV(unit);
+				tileEngine->updateSpotters(unit);
+				getSightMatrix(_battle, &visible, &spotters);
+
+				tileEngine->invalidateSight();
+				tileEngine->calculateFOV(*units);
+				getSightMatrix(_battle, &expectedVisible, &expectedSpotters);
+				for (size_t i = 0; i < units->size(); ++i)
+				{
+					const char *differs = 0;
+					if (visible[i] != expectedVisible[i])
+						differs = "sees other units";
+					else if (spotters[i] != expectedSpotters[i])
+						differs = "is seen by other units";
+					if (differs)
+					{
+						std::ostringstream ss;
+						ss << "TileEngine::updateSpotters after unit " << unit->getId() << " stepped to " << to.x << "," << to.y << "," << to.z
+							<< ": unit " << units->at(i)->getId() << " " << differs << " than when calculated from scratch";
+						throw Exception(ss.str());
+					}
+					pairs += expectedVisible[i].size();
+				}
+				steps++;
+			}
+			moveUnit(_map, _battle, unit, start, direction);
+		}
+	}
+
+	std::copy(fog.begin(), fog.end(), discovered);
+	tileEngine->invalidateSight();
+	tileEngine->calculateFOV(*units);
+	*_out << "Spotters: " << steps << " steps, " << pairs << " units seen, same as calculated from scratch" << std::endl;
+}
+
+/**
+ * Checks that timing a part and adding to a counter with the profiler off
+ * costs no more than a few function calls, by comparing the fastest run of
+ * profilerOff with the fastest run of the same loop without the profiler.
+ * Reading the clock or looking up the part would cost more than the margin.
+ */
+void Benchmark::verifyProfiler()
+{
+	const double margin = 15.0; // nanoseconds per iteration
+	const int runs = 200;
+	double fastest[2] = { 0, 0 };
+	Bench benches[2] = { &Benchmark::profilerOff, &Benchmark::emptyLoop };
+	for (int i = 0; i < std::max(_samples, 5); ++i)
+	{
+		for (int b = 0; b < 2; ++b)
+		{
+			double start = CrossPlatform::getTime();
+			for (int j = 0; j < runs; ++j)
+			{
+				(this->*benches[b])();
+			}
+			double time = CrossPlatform::getTime() - start;
+			if (i == 0 || time < fastest[b])
+				fastest[b] = time;
+		}
+	}
+	// each run is a loop of 1000 iterations
+	double overhead = (fastest[0] - fastest[1]) * 1000000000.0 / (runs * 1000);
+	if (overhead > margin)
+	{
+		std::ostringstream ss;
+		ss << "Profiler::Scope and Profiler::count cost " << overhead << " ns with the profiler off, more than " << margin << " ns";
+		throw Exception(ss.str());
+	}
+	*_out << "Profiler off: " << std::fixed << std::setprecision(2) << std::max(overhead, 0.0) << " ns per timed part, within " << margin << " ns" << std::endl;
+}
+
+/**
+ * Draws a unit sprite, shaded.
+ */
+void Benchmark::blitNShade()
+{
+	_sprite->blitNShade(_surface, 144, 80, 4);
+}
+
+/**
+ * Draws a unit sprite, shaded and at half width.
+ */
+void Benchmark::blitNShadeHalf()
+{
+	_sprite->blitNShade(_surface, 144, 80, 4, true);
+}
+
+/**
+ * Draws a unit sprite, shaded and with its colors replaced.
+ */
+void Benchmark::blitNShadeRecolor()
+{
+	_sprite->blitNShade(_surface, 144, 80, 4, false, 3);
+}
+
+/**
+ * Draws a unit sprite from its spans, shaded.
+ */
+void Benchmark::blitSpans()
+{
+	_spans->blitNShade(_surface, 144, 80, 4);
+}
+
+/**
+ * Draws a unit sprite from spans shaded ahead of time.
+ */
+void Benchmark::blitShadedSpans()
+{
+	SpanSprite *spans = _sprites->getShadedSpans(0, 4);
+	if (spans)
+		spans->blitNShade(_surface, 144, 80, 0);
+}
+
+/**
+ * Shades a whole screen with a shader kernel.
+ */
+void Benchmark::shaderDraw()
+{
+	ShaderDraw<Blit::StandartShade>(ShaderSurface(_surface), ShaderSurface(_background), ShaderScalar(4));
+}
+
+/**
+ * Scales the screen up to the window and shows it.
+ */
+void Benchmark::flip()
+{
+	_game->getScreen()->flip();
+}
+
+/**
+ * Loads the frames of a unit.
+ */
+void Benchmark::loadPck()
+{
+	SurfaceSet *set = new SurfaceSet(32, 40);
+	set->loadPck(CrossPlatform::getDataFile("UNITS/XCOM_0.PCK"), CrossPlatform::getDataFile("UNITS/XCOM_0.TAB"));
+	delete set;
+}
+
+/**
+ * Draws a page of word-wrapped text.
+ */
+void Benchmark::drawText()
+{
+	_text->draw();
+}
+
+/**
+ * Works out what every unit sees, from scratch.
+ */
+void Benchmark::calculateFOV()
+{
+	_battle->getTileEngine()->invalidateSight();
+	_battle->getTileEngine()->calculateFOV(*_battle->getUnits());
+}
+
+/**
+ * Works out what every unit sees, when nothing changed.
+ */
+void Benchmark::calculateFOVCached()
+{
+	_battle->getTileEngine()->calculateFOV(*_battle->getUnits());
+}
+
+/**
+ * Works out what one soldier sees, from scratch.
+ */
+void Benchmark::calculateFOVSoldier()
+{
+	_battle->getTileEngine()->invalidateSight();
+	_battle->getTileEngine()->calculateFOV(_unit);
+}
+
+/**
+ * Discovers the tiles one soldier sees by tracing a line to every
+ * tile in the view cone, the way calculateFOV used to.
+ */
+void Benchmark::calculateFOVSweep()
+{
+	discoverTilesSweep(_battle, _unit);
+}
+
+/**
+ * Traces lines between random points on the map, the way shots are traced.
+ */
+void Benchmark::calculateLine()
+{
+	for (std::vector<Position>::const_iterator i = _lines.begin(); i != _lines.end(); i += 2)
+	{
+		_battle->getTileEngine()->calculateLine(*i, *(i + 1), false, 0, _unit);
+	}
+}
+
+/**
+ * Sets off a smoke grenade in the middle of the map, which goes
+ * through the same rays as any explosion but destroys nothing.
+ */
+void Benchmark::explode()
+{
+	Position center(_battle->getWidth() * 8, _battle->getLength() * 8, 12);
+	_battle->getTileEngine()->explode(center, 60, DT_SMOKE, 8);
+}
+
+/**
+ * Finds a path for a soldier to one of the destinations, a different one each call.
+ */
+void Benchmark::calculatePath()
+{
+	if (_destinations.empty())
+		return;
+	_battle->getPathfinding()->calculate(_unit, _destinations[_destination]);
+	_destination = (_destination + 1) % _destinations.size();
+}
+
+/**
+ * Counts the burning and smoking tiles of a 60x60x4 map stored in a TileGrid,
+ * the way the turn starts look for them.
+ */
+void Benchmark::sweepTileGrid()
+{
+	const int *fire = _grid->getFire(), *smoke = _grid->getSmoke();
+	int burning = 0;
+	for (int i = 0; i < _grid->getSize(); ++i)
+	{
+		if (fire[i] || smoke[i])
+			burning++;
+	}
+	_burning = burning;
+}
+
+/**
+ * Counts the burning and smoking tiles of a 60x60x4 map stored as separate tiles.
+ */
+void Benchmark::sweepHeapTiles()
+{
+	int burning = 0;
+	for (std::vector<HeapTile*>::const_iterator i = _heapTiles.begin(); i != _heapTiles.end(); ++i)
+	{
+		if ((*i)->fire || (*i)->smoke)
+			burning++;
+	}
+	_burning = burning;
+}
+
+/**
+ * Draws the globe.
+ */
+void Benchmark::drawGlobe()
+{
+	_globe->draw();
+}
+
+/**
+ * Draws the map when nothing changed, from its terrain layer.
+ */
+void Benchmark::drawMap()
+{
+	_map->draw();
+}
+
+/**
+ * Draws the map in full, tile by tile.
+ */
+void Benchmark::drawMapFull()
+{
+	_map->setFullRedraw(true);
+	_map->draw();
+	_map->setFullRedraw(false);
+}
+
+/**
+ * Scrolls the map sideways a step, the way it scrolls while the mouse is at
+ * the edge of the screen, and draws it. It goes one way for eight steps and
+ * then back.
+ */
+void Benchmark::scrollMap()
+{
+	int speed = Options::getInt("battleScrollSpeed");
+	_map->getCamera()->scrollXY((_scrolls++ / 8) % 2 ? -speed : speed, 0, true);
+}
+
+/**
+ * Copies a frame the size of the map, which is all
+ * drawing the map should cost when nothing changed.
+ */
+void Benchmark::copyFrame()
+{
+	SDL_Surface *from = _map->getSurface(), *to = _surface->getSurface();
+	for (int y = 0; y < to->h; ++y)
+	{
+		memcpy((Uint8*)to->pixels + y * to->pitch, (Uint8*)from->pixels + y * from->pitch, to->w);
+	}
+}
+
+/**
+ * Saves the game with the battle.
+ */
+void Benchmark::saveGame()
+{
+	_game->getSavedGame()->save("benchmark");
+}
+
+/**
+ * Loads the game with the battle.
+ */
+void Benchmark::loadGame()
+{
+	SavedGame *save = new SavedGame(DIFF_BEGINNER);
+	save->load("benchmark", _game->getRuleset());
+	delete save;
+}
+
+/**
+ * Times a part and adds to a counter a thousand times, with the
+ * profiler off, to compare with the same loop doing nothing.
+ */
+void Benchmark::profilerOff()
+{
+	volatile int n = 0;
+	for (int i = 0; i < 1000; ++i)
+	{
+		Profiler::Scope profile("Benchmark::profilerOff");
+		Profiler::count("Benchmark::profilerOff");
+		n++;
+	}
+}
+
+/**
+ * Runs the loop of profilerOff without the profiler.
+ */
+void Benchmark::emptyLoop()
+{
+	volatile int n = 0;
+	for (int i = 0; i < 1000; ++i)
+	{
+		n++;
+	}
+}
+
+/**
+ * Sets up the data and runs every benchmark. Times are in microseconds per call.
+ * @param out Stream to write the results to.
+ */
+void Benchmark::run(std::ostream &out)
+{
+	_out = &out;
+	Profiler::setEnabled(false);
+	out << "Seed: " << RNG::getSeed() << std::endl;
+	verifyRNG();
+	// checked on maps of their own, before the benchmark's battle replaces them
+	verifyPaths();
+	verifyLighting();
+	setup();
+	_game->getScreen()->setResolution(640, 400);
+
+	out << "Map size: " << _battle->getWidth() << "x" << _battle->getLength() << "x" << _battle->getHeight() << std::endl;
+	out << "Tile size: " << _grid->getTileBytes() << " bytes in a TileGrid, " << sizeof(HeapTile) + sizeof(HeapTile*) << " as separate tiles" << std::endl;
+	out << "Samples: " << _samples << std::endl;
+	verifyBlit();
+	verifyFOV();
+	verifyMap();
+	verifySpotters();
+	verifyProfiler();
+	out << std::endl;
+	out << std::left << std::setw(32) << "Benchmark" << std::right << std::setw(8) << "Calls" << std::setw(14) << "Median (us)"
+		<< std::setw(14) << "Min (us)" << std::setw(14) << "Max (us)" << std::setw(10) << "Spread %" << std::endl;
+
+	measure("Surface::blitNShade", &Benchmark::blitNShade, 2000);
+	measure("Surface::blitNShade (half)", &Benchmark::blitNShadeHalf, 2000);
+	measure("Surface::blitNShade (recolor)", &Benchmark::blitNShadeRecolor, 2000);
+	measure("SpanSprite::blitNShade", &Benchmark::blitSpans, 2000);
+	measure("SpanSprite::blitNShade (pre-shaded)", &Benchmark::blitShadedSpans, 2000);
+	measure("ShaderDraw (320x200 shade)", &Benchmark::shaderDraw, 200);
+	measure("Screen::flip (640x400)", &Benchmark::flip, 50);
+	measure("SurfaceSet::loadPck", &Benchmark::loadPck, 20);
+	measure("Text::draw", &Benchmark::drawText, 100);
+	measure("Globe::draw", &Benchmark::drawGlobe, 20);
+	measure("Map::draw (idle)", &Benchmark::drawMap, 200);
+	measure("Map::draw (in full)", &Benchmark::drawMapFull, 20);
+	measure("Map::draw (scrolling)", &Benchmark::scrollMap, 64);
+	measure("Frame copy (320x200)", &Benchmark::copyFrame, 2000);
+	measure("TileEngine::calculateFOV", &Benchmark::calculateFOV, 5);
+	measure("TileEngine::calculateFOV (cached)", &Benchmark::calculateFOVCached, 20);
+	measure("TileEngine::calculateFOV (soldier)", &Benchmark::calculateFOVSoldier, 20);
+	measure("Old FOV line sweep (soldier)", &Benchmark::calculateFOVSweep, 5);
+	measure("TileEngine::calculateLine (x256)", &Benchmark::calculateLine, 10);
+	measure("TileEngine::explode", &Benchmark::explode, 10);
+	measure("Pathfinding::calculate", &Benchmark::calculatePath, 32);
+	measure("TileGrid sweep (60x60x4)", &Benchmark::sweepTileGrid, 200);
+	measure("Tile* array sweep (60x60x4)", &Benchmark::sweepHeapTiles, 200);
+	measure("SavedGame::save", &Benchmark::saveGame, 2);
+	measure("SavedGame::load", &Benchmark::loadGame, 2);
+	measure("Profiler::Scope (off, x1000)", &Benchmark::profilerOff, 100);
+	measure("Empty loop (x1000)", &Benchmark::emptyLoop, 100);
+
+	remove((Options::getUserFolder() + "benchmark.sav").c_str());
+}
+
+}
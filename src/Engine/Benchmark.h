@@ -0,0 +1,130 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_BENCHMARK_H
+#define OPENXCOM_BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include "../Battlescape/Position.h"
+
+namespace OpenXcom
+{
+
+class Game;
+class Surface;
+class SpanSprite;
+class SurfaceSet;
+class Text;
+class Globe;
+class SavedBattleGame;
+class BattleUnit;
+class TileGrid;
+class Map;
+
+/**
+ * Times the parts of the game that matter most for speed, each on its own
+ * and on the same data every run, so changes to them can be compared.
+ * Every benchmark is run a number of times and the time per call of each
+ * run is put together into a median and spread. Used by the openxcom_bench
+ * build, which runs without a display.
+ */
+class Benchmark
+{
+private:
+	typedef void (Benchmark::*Bench)();
+	Game *_game;
+	int _samples;
+	std::ostream *_out;
+	Surface *_surface, *_background, *_sprite;
+	SurfaceSet *_sprites;
+	SpanSprite *_spans;
+	Text *_text;
+	Globe *_globe;
+	SavedBattleGame *_battle;
+	BattleUnit *_unit;
+	std::vector<Position> _lines, _destinations;
+	unsigned int _destination;
+	TileGrid *_grid;
+	struct HeapTile;
+	std::vector<HeapTile*> _heapTiles;
+	int _burning;
+	Map *_map;
+	int _scrolls;
+	/// Times a benchmark and writes out the result.
+	void measure(const std::string &name, Bench bench, int iterations);
+	/// Sets up the data for the benchmarks.
+	void setup();
+	/// Checks that random numbers stay within their bounds and streams replay from their state.
+	void verifyRNG();
+	/// Checks the blit kernels, spans and shaded spans against ShaderDraw.
+	void verifyBlit();
+	/// Checks that paths are the same as with the old search, on every stock terrain.
+	void verifyPaths();
+	/// Checks that the light kept up to date is the same as lit from scratch.
+	void verifyLighting();
+	/// Checks that soldiers see the same tiles as when tracing every line.
+	void verifyFOV();
+	/// Checks that timing a part with the profiler off costs next to nothing.
+	void verifyProfiler();
+	/// Checks that the map drawn from its draw list and terrain layers looks the same as drawn in full.
+	void verifyMap();
+	/// Checks that who sees whom, kept up as units move, is the same as calculated from scratch.
+	void verifySpotters();
+	/// Draws the map every way and checks it looks the same.
+	void checkMap(const std::string &step);
+	void blitNShade();
+	void blitNShadeHalf();
+	void blitNShadeRecolor();
+	void blitSpans();
+	void blitShadedSpans();
+	void shaderDraw();
+	void flip();
+	void loadPck();
+	void drawText();
+	void calculateFOV();
+	void calculateFOVCached();
+	void calculateFOVSoldier();
+	void calculateFOVSweep();
+	void calculateLine();
+	void explode();
+	void calculatePath();
+	void sweepTileGrid();
+	void sweepHeapTiles();
+	void drawGlobe();
+	void drawMap();
+	void drawMapFull();
+	void scrollMap();
+	void copyFrame();
+	void saveGame();
+	void loadGame();
+	void profilerOff();
+	void emptyLoop();
+public:
+	/// Creates a new benchmark.
+	Benchmark(Game *game, int samples);
+	/// Cleans up the benchmark.
+	~Benchmark();
+	/// Runs all the benchmarks.
+	void run(std::ostream &out);
+};
+
+}
+
+#endif
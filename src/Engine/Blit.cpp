@@ -0,0 +1,236 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Blit.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OPENXCOM_BLIT_SSE2
+#include <emmintrin.h>
+#elif defined(OPENXCOM_ENABLE_NEON) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+// not checked against verifyBlit on ARM yet, so only used when asked for
+#define OPENXCOM_BLIT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace OpenXcom
+{
+namespace Blit
+{
+
+/**
+ * Runs a ShaderDraw functor over the pixels of a row.
+ * @param dest First pixel of the destination row.
+ * @param src First pixel of the source row.
+ * @param width Number of pixels.
+ * @param shade Shade to add.
+ * @param newColor Color group to move to, if the functor does that.
+ */
+template<typename ColorFunc>
+static inline void drawRow(Uint8 *dest, const Uint8 *src, int width, int shade, int newColor)
+{
+	for (int i = 0; i < width; ++i)
+	{
+		ColorFunc::func(dest[i], src[i], shade, newColor, 0);
+	}
+}
+
+#if defined(OPENXCOM_BLIT_SSE2)
+
+/**
+ * Puts together 16 pixels, taking each from one of two blocks.
+ * @param mask Which pixels to take from the first block.
+ * @param a First block.
+ * @param b Second block.
+ * @return Selected pixels.
+ */
+static inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/**
+ * Shades 16 pixels at once, without looking at transparency.
+ * @param src Source pixels.
+ * @param group Color group of every pixel, or zero to keep their own.
+ * @param keepGroup Mask keeping the color group of the pixels.
+ * @param add Shade to add.
+ * @return Shaded pixels.
+ */
+static inline __m128i shadeBlock(__m128i src, __m128i group, __m128i keepGroup, __m128i add)
+{
+	const __m128i shadeMask = _mm_set1_epi8(15);
+	__m128i shaded = _mm_add_epi8(_mm_and_si128(src, shadeMask), add);
+	// unsigned shaded <= 15, which SSE2 can only compare through min
+	__m128i inGroup = _mm_cmpeq_epi8(_mm_min_epu8(shaded, shadeMask), shaded);
+	__m128i color = _mm_or_si128(_mm_or_si128(_mm_and_si128(src, keepGroup), group), shaded);
+	return select(inGroup, color, shadeMask);
+}
+
+/**
+ * Shades a row 16 pixels at a time, leaving transparent pixels alone.
+ * @param dest First pixel of the destination row.
+ * @param src First pixel of the source row.
+ * @param width Number of pixels.
+ * @param shade Shade to add, from 0 to 240.
+ * @param newColor Color group to move to, or -1 to keep their own.
+ * @return Number of pixels done.
+ */
+static int shadeBlocks(Uint8 *dest, const Uint8 *src, int width, int shade, int newColor)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i add = _mm_set1_epi8((char)shade);
+	const __m128i group = _mm_set1_epi8((char)(newColor < 0 ? 0 : newColor));
+	const __m128i keepGroup = _mm_set1_epi8((char)(newColor < 0 ? 0xF0 : 0));
+	const bool copy = (shade == 0 && newColor < 0);
+	int i = 0;
+	for (; i + 16 <= width; i += 16)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i transparent = _mm_cmpeq_epi8(s, zero);
+		int mask = _mm_movemask_epi8(transparent);
+		if (mask == 0xFFFF)
+			continue;
+		__m128i result = copy ? s : shadeBlock(s, group, keepGroup, add);
+		if (mask)
+		{
+			result = select(transparent, _mm_loadu_si128((const __m128i*)(dest + i)), result);
+		}
+		_mm_storeu_si128((__m128i*)(dest + i), result);
+	}
+	return i;
+}
+
+#elif defined(OPENXCOM_BLIT_NEON)
+
+/**
+ * Shades 16 pixels at once, without looking at transparency.
+ * @param src Source pixels.
+ * @param group Color group of every pixel, or zero to keep their own.
+ * @param keepGroup Mask keeping the color group of the pixels.
+ * @param add Shade to add.
+ * @return Shaded pixels.
+ */
+static inline uint8x16_t shadeBlock(uint8x16_t src, uint8x16_t group, uint8x16_t keepGroup, uint8x16_t add)
+{
+	const uint8x16_t shadeMask = vdupq_n_u8(15);
+	uint8x16_t shaded = vaddq_u8(vandq_u8(src, shadeMask), add);
+	uint8x16_t color = vorrq_u8(vorrq_u8(vandq_u8(src, keepGroup), group), shaded);
+	return vbslq_u8(vcleq_u8(shaded, shadeMask), color, shadeMask);
+}
+
+/**
+ * Shades a row 16 pixels at a time, leaving transparent pixels alone.
+ * @param dest First pixel of the destination row.
+ * @param src First pixel of the source row.
+ * @param width Number of pixels.
+ * @param shade Shade to add, from 0 to 240.
+ * @param newColor Color group to move to, or -1 to keep their own.
+ * @return Number of pixels done.
+ */
+static int shadeBlocks(Uint8 *dest, const Uint8 *src, int width, int shade, int newColor)
+{
+	const uint8x16_t zero = vdupq_n_u8(0);
+	const uint8x16_t add = vdupq_n_u8((Uint8)shade);
+	const uint8x16_t group = vdupq_n_u8((Uint8)(newColor < 0 ? 0 : newColor));
+	const uint8x16_t keepGroup = vdupq_n_u8((Uint8)(newColor < 0 ? 0xF0 : 0));
+	const bool copy = (shade == 0 && newColor < 0);
+	int i = 0;
+	for (; i + 16 <= width; i += 16)
+	{
+		uint8x16_t s = vld1q_u8(src + i);
+		uint8x8_t any = vorr_u8(vget_low_u8(s), vget_high_u8(s));
+		if (vget_lane_u64(vreinterpret_u64_u8(any), 0) == 0)
+			continue;
+		uint8x16_t result = copy ? s : shadeBlock(s, group, keepGroup, add);
+		vst1q_u8(dest + i, vbslq_u8(vceqq_u8(s, zero), vld1q_u8(dest + i), result));
+	}
+	return i;
+}
+
+#endif
+
+/**
+ * Gets the name of the kernels rows are drawn with, for reports.
+ * @return "SSE2", "NEON" or "scalar".
+ */
+const char *getKernels()
+{
+#if defined(OPENXCOM_BLIT_SSE2)
+	return "SSE2";
+#elif defined(OPENXCOM_BLIT_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+/**
+ * Copies the non-transparent pixels of a row, the same as shading them by 0.
+ * @param dest First pixel of the destination row.
+ * @param src First pixel of the source row.
+ * @param width Number of pixels.
+ */
+void copyRow(Uint8 *dest, const Uint8 *src, int width)
+{
+	shadeRow(dest, src, width, 0);
+}
+
+/**
+ * Shades the non-transparent pixels of a row and draws them,
+ * the same as ShaderDraw with StandartShade.
+ * @param dest First pixel of the destination row.
+ * @param src First pixel of the source row.
+ * @param width Number of pixels.
+ * @param shade Shade to add.
+ */
+void shadeRow(Uint8 *dest, const Uint8 *src, int width, int shade)
+{
+	int done = 0;
+#if defined(OPENXCOM_BLIT_SSE2) || defined(OPENXCOM_BLIT_NEON)
+	// shades outside this range don't fit in a byte lane
+	if (shade >= 0 && shade <= 240)
+	{
+		done = shadeBlocks(dest, src, width, shade, -1);
+	}
+#endif
+	drawRow<StandartShade>(dest + done, src + done, width - done, shade, 0);
+}
+
+/**
+ * Shades the non-transparent pixels of a row and draws them in
+ * another color group, the same as ShaderDraw with ColorReplace.
+ * @param dest First pixel of the destination row.
+ * @param src First pixel of the source row.
+ * @param width Number of pixels.
+ * @param shade Shade to add.
+ * @param newColor First color of the group to draw in.
+ */
+void recolorRow(Uint8 *dest, const Uint8 *src, int width, int shade, int newColor)
+{
+	int done = 0;
+#if defined(OPENXCOM_BLIT_SSE2) || defined(OPENXCOM_BLIT_NEON)
+	if (shade >= 0 && shade <= 240 && newColor >= 0)
+	{
+		done = shadeBlocks(dest, src, width, shade, newColor);
+	}
+#endif
+	drawRow<ColorReplace>(dest + done, src + done, width - done, shade, newColor);
+}
+
+}
+}
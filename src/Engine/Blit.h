@@ -0,0 +1,104 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_BLIT_H
+#define OPENXCOM_BLIT_H
+
+#include <SDL.h>
+
+namespace OpenXcom
+{
+
+/**
+ * Row kernels for drawing paletted sprites, used by Surface::blitNShade.
+ * Palette colors come in groups of 16 shades, so shading a pixel moves
+ * it along its group, down to black. Where the processor allows it rows
+ * are done 16 pixels at a time with SSE2 (or NEON, when built with
+ * OPENXCOM_ENABLE_NEON), otherwise (and for the leftover pixels) pixel
+ * by pixel with the same functors ShaderDraw uses, so the result is
+ * exactly the same either way.
+ */
+namespace Blit
+{
+	/**
+	 * Shades a pixel, leaving transparent pixels alone.
+	 */
+	struct StandartShade
+	{
+		/**
+		* Function used by ShaderDraw in Surface::blitNShade
+		* set shade
+		* @param dest destination pixel
+		* @param src source pixel
+		* @param shade value of shade of this surface
+		* @param notused
+		* @param notused
+		*/
+		static inline void func(Uint8& dest, const Uint8& src, const int& shade, const int&, const int&)
+		{
+			if(src)
+			{
+				const int newShade = (src&15) + shade;
+				if (newShade > 15)
+					// so dark it would flip over to another color - make it black instead
+					dest = 15;
+				else
+					dest = (src&(15<<4)) | newShade;
+			}
+		}
+	};
+	/**
+	 * Shades a pixel and moves it to another color group, leaving transparent pixels alone.
+	 */
+	struct ColorReplace
+	{
+		/**
+		* Function used by ShaderDraw in Surface::blitNShade
+		* set shade and replace color in that surface
+		* @param dest destination pixel
+		* @param src source pixel
+		* @param shade value of shade of this surface
+		* @param newColor new color to set (it should be offseted by 4)
+		* @param notused
+		*/
+		static inline void func(Uint8& dest, const Uint8& src, const int& shade, const int& newColor, const int&)
+		{
+			if(src)
+			{
+				const int newShade = (src&15) + shade;
+				if (newShade > 15)
+					// so dark it would flip over to another color - make it black instead
+					dest = 15;
+				else
+					dest = newColor | newShade;
+			}
+		}
+	};
+	/// Gets the name of the kernels in use.
+	const char *getKernels();
+	/// Copies the non-transparent pixels of a row.
+	void copyRow(Uint8 *dest, const Uint8 *src, int width);
+	/// Shades the non-transparent pixels of a row.
+	void shadeRow(Uint8 *dest, const Uint8 *src, int width, int shade);
+	/// Shades and recolors the non-transparent pixels of a row.
+	void recolorRow(Uint8 *dest, const Uint8 *src, int width, int shade, int newColor);
+}
+
+}
+
+#endif
@@ -41,6 +41,7 @@
 #include <stdlib.h>
 #include <sys/param.h>
 #include <sys/types.h>
+#include <sys/time.h>
 #include <pwd.h>
 #endif
 
@@ -449,5 +450,40 @@ bool fileExists(const std::string &path)
 #endif
 }
 
+/**
+ * Gets the number of processors the system has online.
+ * @return Number of processors, at least 1.
+ */
+int getProcessorCount()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	int count = info.dwNumberOfProcessors;
+#else
+	int count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return count > 0 ? count : 1;
+}
+
+/**
+ * Gets the time passed since some point in the past, to a fraction of a
+ * millisecond, for timing the code.
+ * @return Time in seconds.
+ */
+double getTime()
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+	timeval time;
+	gettimeofday(&time, 0);
+	return time.tv_sec + time.tv_usec / 1000000.0;
+#endif
+}
+
 }
 }
@@ -53,6 +53,10 @@ namespace CrossPlatform
 	bool folderExists(const std::string &path);
 	/// Checks if the path is an existing file.
 	bool fileExists(const std::string &path);
+	/// Gets the number of processors in the system.
+	int getProcessorCount();
+	/// Gets the time with a high resolution.
+	double getTime();
 }
 
 }
@@ -34,6 +34,7 @@
 #include "InteractiveSurface.h"
 #include "Options.h"
 #include "CrossPlatform.h"
+#include "Profiler.h"
 
 namespace OpenXcom
 {
@@ -95,6 +96,9 @@ Game::Game(const std::string &title, int width, int height, int bpp) : _screen(0
 	// Create fps counter
 	_fpsCounter = new FpsCounter(15, 5, 0, 0);
 
+	// Time the game if asked to
+	Profiler::setEnabled(Options::getBool("profiler"));
+
 	// Create blank language
 	_lang = new Language();
 }
@@ -176,6 +180,10 @@ void Game::run()
 			{
 				_quit = true;
 			}
+			else if (_event.type == SDL_KEYDOWN && _event.key.keysym.sym == SDLK_F6 && Profiler::isEnabled())
+			{
+				Profiler::dump();
+			}
 			else
 			{
 				Action action = Action(&_event, _screen->getXScale(), _screen->getYScale());
@@ -216,6 +224,12 @@ void Game::run()
 			SDL_Delay(100);
 		else
 			SDL_Delay(1);
+		Profiler::frame();
+	}
+
+	if (Profiler::isEnabled())
+	{
+		Profiler::dump();
 	}
 }
 
@@ -66,7 +66,14 @@ void createDefault()
 	setBool("battleAltGrenade", false);
 	setBool("battlePreviewPath", false);
 	setBool("battleRangeBasedAccuracy", false);
+	// threads for field of view calculations, 0 uses all processors
+	setInt("battleThreads", 0);
+	setInt("battleShadeCache", 512); // KB of sprites shaded ahead of time per sprite set, 0 to turn off
+	// record the battle's start to battle.sav and the player's commands to battle.log
+	setBool("battleRecord", false);
 	setBool("fpsCounter", false);
+	// time parts of the game, written to profile.csv/.json/_trace.json on exit or F6
+	setBool("profiler", false);
 	setBool("craftLaunchAlways", false);
 	setBool("globeSeasons", false);
 }
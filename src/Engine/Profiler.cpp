@@ -0,0 +1,487 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Profiler.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+#include "CrossPlatform.h"
+#include "Options.h"
+
+namespace OpenXcom
+{
+namespace Profiler
+{
+
+/// A timed part of the code, a counter or a gauge.
+struct Stat
+{
+	std::string name;
+	double total, frame, frameMax;
+	int calls, depth;
+	Stat(const std::string &name_) : name(name_), total(0), frame(0), frameMax(0), calls(0), depth(0) {};
+};
+
+/// How values added to a histogram are spread out, in powers of 2.
+struct Histogram
+{
+	static const int BUCKETS = 32;
+	std::string name;
+	double sum, min, max;
+	int samples;
+	int buckets[BUCKETS];
+	Histogram(const std::string &name_) : name(name_), sum(0), min(0), max(0), samples(0) { clear(); };
+	void clear() { sum = min = max = 0; samples = 0; for (int i = 0; i < BUCKETS; ++i) buckets[i] = 0; };
+};
+
+/// A timed scope, for the trace.
+struct Event
+{
+	int part;
+	double start, duration;
+};
+
+const size_t MAX_EVENTS = 200000;
+
+bool _enabled = false;
+double _begin = 0, _frameStart = 0;
+int _frames = 0;
+std::vector<Stat> _parts, _counters, _gauges;
+std::vector<Histogram> _histograms;
+std::vector<Event> _events;
+std::map<std::string, int> _partIds, _counterIds, _gaugeIds, _histogramIds;
+std::map<const char*, int> _partSites, _counterSites, _gaugeSites, _histogramSites;
+
+/**
+ * Finds the index of a name, adding it if it's new. Names are
+ * usually string literals, so they're looked up by address first.
+ * @param name Name to look up.
+ * @param sites Indexes by name address.
+ * @param ids Indexes by name.
+ * @param size Number of names so far.
+ * @param added Set to true if the name is new.
+ * @return Index of the name.
+ */
+static int find(const char *name, std::map<const char*, int> *sites, std::map<std::string, int> *ids, int size, bool *added)
+{
+	*added = false;
+	std::map<const char*, int>::iterator site = sites->find(name);
+	if (site != sites->end())
+		return site->second;
+	std::map<std::string, int>::iterator i = ids->find(name);
+	if (i == ids->end())
+	{
+		i = ids->insert(std::make_pair(std::string(name), size)).first;
+		*added = true;
+	}
+	sites->insert(std::make_pair(name, i->second));
+	return i->second;
+}
+
+/**
+ * Gets the index of a part, adding it if it's new.
+ * @param name Name of the part.
+ * @return Index of the part.
+ */
+static int findPart(const char *name)
+{
+	bool added;
+	int id = find(name, &_partSites, &_partIds, _parts.size(), &added);
+	if (added)
+		_parts.push_back(Stat(name));
+	return id;
+}
+
+/**
+ * Adds a timed stretch to a part.
+ * @param part Index of the part.
+ * @param start When it started.
+ * @param end When it ended.
+ */
+static void addTime(int part, double start, double end)
+{
+	Stat &s = _parts[part];
+	s.total += end - start;
+	s.frame += end - start;
+	s.calls++;
+	if (_events.size() < MAX_EVENTS)
+	{
+		Event e = { part, start, end - start };
+		_events.push_back(e);
+	}
+}
+
+/**
+ * Starts timing a part of the code, if the profiler is on.
+ * @param part Name of the part.
+ */
+Scope::Scope(const char *part) : _part(-1), _start(0)
+{
+	if (!_enabled)
+		return;
+	_part = findPart(part);
+	if (_parts[_part].depth++ == 0)
+	{
+		_start = CrossPlatform::getTime();
+	}
+}
+
+/**
+ * Stops timing the part and adds the time to it.
+ */
+Scope::~Scope()
+{
+	if (_part == -1)
+		return;
+	if (--_parts[_part].depth == 0)
+	{
+		addTime(_part, _start, CrossPlatform::getTime());
+	}
+}
+
+/**
+ * Adds to a counter, like the number of tiles drawn.
+ * @param counter Name of the counter.
+ * @param amount Amount to add.
+ */
+void count(const char *counter, int amount)
+{
+	if (!_enabled)
+		return;
+	bool added;
+	int id = find(counter, &_counterSites, &_counterIds, _counters.size(), &added);
+	if (added)
+		_counters.push_back(Stat(counter));
+	_counters[id].total += amount;
+	_counters[id].frame += amount;
+	_counters[id].calls++;
+}
+
+/**
+ * Sets a gauge to its current value, like the memory a cache takes up.
+ * Unlike a counter, it's not added up: it keeps the last value and the most.
+ * @param gauge Name of the gauge.
+ * @param value Current value.
+ */
+void gauge(const char *gauge, double value)
+{
+	if (!_enabled)
+		return;
+	bool added;
+	int id = find(gauge, &_gaugeSites, &_gaugeIds, _gauges.size(), &added);
+	if (added)
+		_gauges.push_back(Stat(gauge));
+	_gauges[id].total = value;
+	_gauges[id].frameMax = std::max(_gauges[id].frameMax, value);
+	_gauges[id].calls++;
+}
+
+/**
+ * Adds a value to a histogram, like the length of a path.
+ * @param histogram Name of the histogram.
+ * @param value Value to add.
+ */
+void sample(const char *histogram, double value)
+{
+	if (!_enabled)
+		return;
+	bool added;
+	int id = find(histogram, &_histogramSites, &_histogramIds, _histograms.size(), &added);
+	if (added)
+		_histograms.push_back(Histogram(histogram));
+	Histogram &h = _histograms[id];
+	if (h.samples == 0 || value < h.min)
+		h.min = value;
+	if (h.samples == 0 || value > h.max)
+		h.max = value;
+	h.sum += value;
+	h.samples++;
+	int bucket = 0;
+	for (double limit = 1; value >= limit && bucket < Histogram::BUCKETS - 1; limit *= 2)
+	{
+		bucket++;
+	}
+	h.buckets[bucket]++;
+}
+
+/**
+ * Ends the current frame: times it as the "Game::frame" part and
+ * adds it to the "Game::frameMs" histogram, and keeps the most
+ * each part and counter added up in a frame.
+ */
+void frame()
+{
+	if (!_enabled)
+		return;
+	double now = CrossPlatform::getTime();
+	if (_frameStart > 0)
+	{
+		addTime(findPart("Game::frame"), _frameStart, now);
+		sample("Game::frameMs", (now - _frameStart) * 1000.0);
+		_frames++;
+	}
+	_frameStart = now;
+	for (std::vector<Stat>::iterator i = _parts.begin(); i != _parts.end(); ++i)
+	{
+		i->frameMax = std::max(i->frameMax, i->frame);
+		i->frame = 0;
+	}
+	for (std::vector<Stat>::iterator i = _counters.begin(); i != _counters.end(); ++i)
+	{
+		i->frameMax = std::max(i->frameMax, i->frame);
+		i->frame = 0;
+	}
+}
+
+/**
+ * Turns the profiler on or off.
+ * @param enabled Is the profiler on?
+ */
+void setEnabled(bool enabled)
+{
+	if (enabled && !_enabled && _begin == 0)
+	{
+		_begin = CrossPlatform::getTime();
+	}
+	_enabled = enabled;
+}
+
+/**
+ * Checks if the profiler is on.
+ * @return Is the profiler on?
+ */
+bool isEnabled()
+{
+	return _enabled;
+}
+
+/**
+ * Forgets everything added up so far, keeping the names
+ * and the current value of the gauges.
+ */
+void reset()
+{
+	for (std::vector<Stat>::iterator i = _parts.begin(); i != _parts.end(); ++i)
+	{
+		i->total = i->frame = i->frameMax = 0;
+		i->calls = 0;
+	}
+	for (std::vector<Stat>::iterator i = _counters.begin(); i != _counters.end(); ++i)
+	{
+		i->total = i->frame = i->frameMax = 0;
+		i->calls = 0;
+	}
+	for (std::vector<Stat>::iterator i = _gauges.begin(); i != _gauges.end(); ++i)
+	{
+		i->frameMax = i->total;
+		i->calls = 0;
+	}
+	for (std::vector<Histogram>::iterator i = _histograms.begin(); i != _histograms.end(); ++i)
+	{
+		i->clear();
+	}
+	_events.clear();
+	_frames = 0;
+	_frameStart = 0;
+	_begin = CrossPlatform::getTime();
+}
+
+/**
+ * Writes the total time spent in each part, how often it ran
+ * and the average time it took, in the order they first ran.
+ * Counters follow with their totals, and gauges with their
+ * last and largest values.
+ * @param out Stream to write to.
+ */
+void report(std::ostream &out)
+{
+	out << std::left << std::setw(40) << "Part" << std::right << std::setw(10) << "Calls" << std::setw(14) << "Total (ms)" << std::setw(14) << "Average (us)" << std::endl;
+	for (std::vector<Stat>::iterator i = _parts.begin(); i != _parts.end(); ++i)
+	{
+		double average = i->calls ? i->total * 1000000.0 / i->calls : 0;
+		out << std::left << std::setw(40) << i->name << std::right << std::setw(10) << i->calls
+			<< std::fixed << std::setprecision(2) << std::setw(14) << i->total * 1000.0 << std::setw(14) << average << std::endl;
+	}
+	if (!_counters.empty())
+	{
+		out << std::endl << std::left << std::setw(40) << "Counter" << std::right << std::setw(10) << "Calls" << std::setw(14) << "Total" << std::endl;
+		for (std::vector<Stat>::iterator i = _counters.begin(); i != _counters.end(); ++i)
+		{
+			out << std::left << std::setw(40) << i->name << std::right << std::setw(10) << i->calls
+				<< std::fixed << std::setprecision(0) << std::setw(14) << i->total << std::endl;
+		}
+	}
+	if (!_gauges.empty())
+	{
+		out << std::endl << std::left << std::setw(40) << "Gauge" << std::right << std::setw(10) << "Calls" << std::setw(14) << "Last" << std::setw(14) << "Most" << std::endl;
+		for (std::vector<Stat>::iterator i = _gauges.begin(); i != _gauges.end(); ++i)
+		{
+			out << std::left << std::setw(40) << i->name << std::right << std::setw(10) << i->calls
+				<< std::fixed << std::setprecision(0) << std::setw(14) << i->total << std::setw(14) << i->frameMax << std::endl;
+		}
+	}
+}
+
+/**
+ * Writes a row of stats as CSV.
+ * @param out Stream to write to.
+ * @param kind Kind of stat.
+ * @param s Stat.
+ * @param scale Unit to write the totals in.
+ */
+static void writeCsvRow(std::ostream &out, const char *kind, const Stat &s, double scale)
+{
+	out << kind << "," << s.name << "," << s.calls << "," << s.total * scale << ","
+		<< (s.calls ? s.total * scale / s.calls : 0) << ","
+		<< (_frames ? s.total * scale / _frames : 0) << "," << s.frameMax * scale << std::endl;
+}
+
+/**
+ * Writes everything added up as CSV, one row per part, counter,
+ * gauge and histogram. Times are in milliseconds; the frame columns
+ * are the average and most per frame. A gauge's total is its last
+ * value, and its frame_max the most it reached.
+ * @param out Stream to write to.
+ */
+void writeCsv(std::ostream &out)
+{
+	out << std::fixed << std::setprecision(3);
+	out << "kind,name,calls,total,average,frame_average,frame_max" << std::endl;
+	for (std::vector<Stat>::iterator i = _parts.begin(); i != _parts.end(); ++i)
+	{
+		writeCsvRow(out, "part", *i, 1000.0);
+	}
+	for (std::vector<Stat>::iterator i = _counters.begin(); i != _counters.end(); ++i)
+	{
+		writeCsvRow(out, "counter", *i, 1.0);
+	}
+	for (std::vector<Stat>::iterator i = _gauges.begin(); i != _gauges.end(); ++i)
+	{
+		out << "gauge," << i->name << "," << i->calls << "," << i->total << ",,," << i->frameMax << std::endl;
+	}
+	for (std::vector<Histogram>::iterator i = _histograms.begin(); i != _histograms.end(); ++i)
+	{
+		out << "histogram," << i->name << "," << i->samples << "," << i->sum << ","
+			<< (i->samples ? i->sum / i->samples : 0) << ",," << std::endl;
+	}
+}
+
+/**
+ * Quotes a name for JSON.
+ * @param name Name.
+ * @return Quoted name.
+ */
+static std::string quote(const std::string &name)
+{
+	std::string s = "\"";
+	for (std::string::const_iterator i = name.begin(); i != name.end(); ++i)
+	{
+		if (*i == '"' || *i == '\\')
+			s += '\\';
+		s += *i;
+	}
+	return s + "\"";
+}
+
+/**
+ * Writes everything added up as JSON, with the histograms'
+ * buckets: each counts the values below its limit and at
+ * or above the previous one.
+ * @param out Stream to write to.
+ */
+void writeJson(std::ostream &out)
+{
+	out << std::fixed << std::setprecision(3);
+	out << "{\n\t\"frames\": " << _frames << ",\n\t\"parts\": [";
+	for (std::vector<Stat>::iterator i = _parts.begin(); i != _parts.end(); ++i)
+	{
+		out << (i == _parts.begin() ? "\n" : ",\n");
+		out << "\t\t{ \"name\": " << quote(i->name) << ", \"calls\": " << i->calls << ", \"total_ms\": " << i->total * 1000.0
+			<< ", \"frame_max_ms\": " << i->frameMax * 1000.0 << " }";
+	}
+	out << "\n\t],\n\t\"counters\": [";
+	for (std::vector<Stat>::iterator i = _counters.begin(); i != _counters.end(); ++i)
+	{
+		out << (i == _counters.begin() ? "\n" : ",\n");
+		out << "\t\t{ \"name\": " << quote(i->name) << ", \"calls\": " << i->calls << ", \"total\": " << i->total
+			<< ", \"frame_max\": " << i->frameMax << " }";
+	}
+	out << "\n\t],\n\t\"gauges\": [";
+	for (std::vector<Stat>::iterator i = _gauges.begin(); i != _gauges.end(); ++i)
+	{
+		out << (i == _gauges.begin() ? "\n" : ",\n");
+		out << "\t\t{ \"name\": " << quote(i->name) << ", \"calls\": " << i->calls << ", \"value\": " << i->total
+			<< ", \"max\": " << i->frameMax << " }";
+	}
+	out << "\n\t],\n\t\"histograms\": [";
+	for (std::vector<Histogram>::iterator i = _histograms.begin(); i != _histograms.end(); ++i)
+	{
+		out << (i == _histograms.begin() ? "\n" : ",\n");
+		out << "\t\t{ \"name\": " << quote(i->name) << ", \"samples\": " << i->samples << ", \"sum\": " << i->sum
+			<< ", \"min\": " << i->min << ", \"max\": " << i->max << ", \"buckets\": [";
+		int last = Histogram::BUCKETS - 1;
+		while (last > 0 && i->buckets[last] == 0)
+			last--;
+		for (int j = 0; j <= last; ++j)
+		{
+			out << (j ? ", " : " ") << "{ \"below\": " << std::pow(2.0, j) << ", \"count\": " << i->buckets[j] << " }";
+		}
+		out << " ] }";
+	}
+	out << "\n\t]\n}" << std::endl;
+}
+
+/**
+ * Writes the timed scopes in the Chrome trace event format, to be
+ * looked at in chrome://tracing. Only the first scopes are kept,
+ * to keep the trace from growing without end.
+ * @param out Stream to write to.
+ */
+void writeTrace(std::ostream &out)
+{
+	out << "{\"traceEvents\":[";
+	out << std::fixed << std::setprecision(1);
+	for (std::vector<Event>::iterator i = _events.begin(); i != _events.end(); ++i)
+	{
+		out << (i == _events.begin() ? "\n" : ",\n");
+		out << "{\"name\":" << quote(_parts[i->part].name) << ",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+			<< (i->start - _begin) * 1000000.0 << ",\"dur\":" << i->duration * 1000000.0 << "}";
+	}
+	out << "\n]}" << std::endl;
+}
+
+/**
+ * Writes profile.csv, profile.json and profile_trace.json to the user folder.
+ */
+void dump()
+{
+	std::string folder = Options::getUserFolder();
+	std::ofstream csv((folder + "profile.csv").c_str());
+	writeCsv(csv);
+	std::ofstream json((folder + "profile.json").c_str());
+	writeJson(json);
+	std::ofstream trace((folder + "profile_trace.json").c_str());
+	writeTrace(trace);
+}
+
+}
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_PROFILER_H
+#define OPENXCOM_PROFILER_H
+
+#include <ostream>
+
+namespace OpenXcom
+{
+
+/**
+ * Adds up the time spent in named parts of the code, to find out
+ * where it goes, along with named counters, gauges and histograms of
+ * values. Parts are named after the function they time, like
+ * "Map::drawTerrain", and the rest after the class they belong to and
+ * what they measure, like "Map::tilesDrawn".
+ * Everything is also added up per frame, and can be written out as
+ * a table, CSV, JSON or a Chrome trace (chrome://tracing).
+ * It's off by default, and timing a part while it's off costs
+ * next to nothing. Only meant for the main thread.
+ */
+namespace Profiler
+{
+	/**
+	 * Times the scope it's declared in and adds the time to a part.
+	 * A part is only timed once when its scopes are nested.
+	 */
+	class Scope
+	{
+	private:
+		int _part;
+		double _start;
+	public:
+		/// Starts timing a part.
+		Scope(const char *part);
+		/// Stops timing the part.
+		~Scope();
+	};
+	/// Adds to a counter.
+	void count(const char *counter, int amount = 1);
+	/// Sets a gauge to its current value.
+	void gauge(const char *gauge, double value);
+	/// Adds a value to a histogram.
+	void sample(const char *histogram, double value);
+	/// Ends the current frame.
+	void frame();
+	/// Turns the profiler on or off.
+	void setEnabled(bool enabled);
+	/// Checks if the profiler is on.
+	bool isEnabled();
+	/// Forgets everything added up so far.
+	void reset();
+	/// Writes the time spent in each part.
+	void report(std::ostream &out);
+	/// Writes everything added up as CSV.
+	void writeCsv(std::ostream &out);
+	/// Writes everything added up as JSON.
+	void writeJson(std::ostream &out);
+	/// Writes the timed scopes as a Chrome trace.
+	void writeTrace(std::ostream &out);
+	/// Writes all the formats to the user folder.
+	void dump();
+}
+
+}
+
+#endif
@@ -19,8 +19,10 @@
 #include "RNG.h"
 #define _USE_MATH_DEFINES
 #include <cmath>
-#include <cstdlib>
 #include <ctime>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
 
 namespace OpenXcom
 {
@@ -28,9 +30,56 @@ namespace RNG
 {
 
 int _seed = 0;
+Uint64 _state[STREAMS][4];
 
 /**
- * Seeds the random generator with a new number.
+ * Advances a splitmix64 generator, used to spread
+ * a seed over the whole state of a stream.
+ * @param x Generator state.
+ * @return Next number.
+ */
+static Uint64 splitmix(Uint64 *x)
+{
+	Uint64 z = (*x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * Rotates a number left.
+ * @param x Number.
+ * @param k Bits to rotate by.
+ * @return Rotated number.
+ */
+static inline Uint64 rotl(Uint64 x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * Advances a stream (xoshiro256**). Only fixed-width
+ * integer math, so it gives the same numbers everywhere.
+ * @param stream Stream to advance.
+ * @return Next 64-bit number.
+ */
+static Uint64 next(Stream stream)
+{
+	Uint64 *s = _state[stream];
+	Uint64 result = rotl(s[1] * 5, 7) * 9;
+	Uint64 t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+/**
+ * Seeds all the streams with a new number, each
+ * stream getting a different state from it.
  * Defaults to the current time if none is set.
  * @param seed New seed.
  */
@@ -44,7 +93,10 @@ void init(int seed)
 	{
 		_seed = seed;
 	}
-	srand(_seed);
+	for (int i = 0; i < STREAMS; ++i)
+	{
+		RNG::seed((Stream)i, (int)((Uint32)_seed + i));
+	}
 }
 
 /**
@@ -56,64 +108,116 @@ int getSeed()
 	return _seed;
 }
 
+/**
+ * Seeds a single stream, leaving the others alone.
+ * @param stream Stream to seed.
+ * @param seed New seed.
+ */
+void seed(Stream stream, int seed)
+{
+	Uint64 x = (Uint32)seed;
+	for (int i = 0; i < 4; ++i)
+	{
+		_state[stream][i] = splitmix(&x);
+	}
+}
+
+/**
+ * Gets the full state of a stream, for saving.
+ * @param stream Stream.
+ * @return State as hexadecimal words.
+ */
+std::string getState(Stream stream)
+{
+	std::stringstream ss;
+	ss << std::hex << std::setfill('0');
+	for (int i = 0; i < 4; ++i)
+	{
+		if (i > 0)
+			ss << " ";
+		ss << std::setw(8) << (Uint32)(_state[stream][i] >> 32) << std::setw(8) << (Uint32)_state[stream][i];
+	}
+	return ss.str();
+}
+
+/**
+ * Restores the state of a stream from a saved one.
+ * Malformed states are ignored.
+ * @param stream Stream.
+ * @param state State as returned by getState.
+ */
+void setState(Stream stream, const std::string &state)
+{
+	std::stringstream ss(state);
+	Uint64 s[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		std::string word;
+		ss >> word;
+		if (word.size() != 16)
+			return;
+		Uint32 high, low;
+		std::stringstream(word.substr(0, 8)) >> std::hex >> high;
+		std::stringstream(word.substr(8)) >> std::hex >> low;
+		s[i] = ((Uint64)high << 32) | low;
+	}
+	if ((s[0] | s[1] | s[2] | s[3]) == 0)
+		return;
+	for (int i = 0; i < 4; ++i)
+	{
+		_state[stream][i] = s[i];
+	}
+}
+
 /**
  * Generates a random integer number within a certain range.
+ * Reversed bounds are swapped, so the number is always between them.
  * @param min Minimum number.
  * @param max Maximum number.
+ * @param stream Stream to draw from.
  * @return Generated number.
  */
-int generate(int min, int max)
+int generate(int min, int max, Stream stream)
 {
-	_seed = rand();
-	return (_seed % (max - min + 1) + min);
+	if (max < min)
+		std::swap(min, max);
+	Uint64 range = (Uint64)((Sint64)max - min + 1);
+	return (int)(min + (Sint64)(((next(stream) >> 32) * range) >> 32));
 }
 
 /**
  * Generates a random decimal number within a certain range.
  * @param min Minimum number.
  * @param max Maximum number.
+ * @param stream Stream to draw from.
  * @return Generated number.
  */
-double generate(double min, double max)
+double generate(double min, double max, Stream stream)
 {
-	_seed = rand();
-	return (_seed * (max - min) / RAND_MAX + min);
+	double x = (next(stream) >> 11) * (1.0 / 9007199254740992.0);
+	return (x * (max - min) + min);
 }
 
 /**
- * Normal random variate generator
+ * Normal random variate generator. The second value of each
+ * pair is thrown away, so a stream's state is all there is to it.
  * @param m mean
  * @param s standard deviation
+ * @param stream Stream to draw from.
  * @return normally distributed value.
  */
-double boxMuller(double m, double s)
+double boxMuller(double m, double s, Stream stream)
 {
-	double y1;
-	static double y2;
-	static int use_last = 0;
-
-	if (use_last)				/* use value from previous call */
-	{
-		y1 = y2;
-		use_last = 0;
-	}
-	else
-	{
-		double x1, x2, w;
-		do {
-			x1 = 2.0 * generate(0.0, 1.0) - 1.0;
-			x2 = 2.0 * generate(0.0, 1.0) - 1.0;
-			w = x1 * x1 + x2 * x2;
-		} while ( w >= 1.0 );
+	double x1, x2, w;
+	do {
+		x1 = 2.0 * generate(0.0, 1.0, stream) - 1.0;
+		x2 = 2.0 * generate(0.0, 1.0, stream) - 1.0;
+		w = x1 * x1 + x2 * x2;
+	} while ( w >= 1.0 || w == 0.0 );
 
-		w = sqrt( (-2.0 * log( w ) ) / w );
-		y1 = x1 * w;
-		y2 = x2 * w;
-		use_last = 1;
-	}
-
-	return( m + y1 * s );
+	w = sqrt( (-2.0 * log( w ) ) / w );
+	return( m + x1 * w * s );
 }
 
 }
-}
\ No newline at end of file
+}
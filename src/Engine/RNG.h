@@ -19,27 +19,40 @@
 #ifndef OPENXCOM_RNG_H
 #define OPENXCOM_RNG_H
 
+#include <string>
+#include <SDL.h>
+
 namespace OpenXcom
 {
 
 /**
  * Random Number Generator used throughout the game
- * for all your randomness needs. It's really just the
- * standard C generator, but wrapped in a way that we
- * can store its seed for later use if necessary.
+ * for all your randomness needs. Every part of the game
+ * draws from its own stream, so one part using more or
+ * fewer numbers (eg. a sound effect) doesn't change what
+ * another gets, and the streams' states can be saved with
+ * the game to make it play out the same way every time.
  */
 namespace RNG
 {
-	/// Initializes the generator.
+	/// The independent streams of random numbers.
+	enum Stream { GEOSCAPE, MAP, AI, COMBAT, EFFECTS, STREAMS };
+	/// Initializes all the streams.
 	void init(int seed = -1);
 	/// Gets the generator's seed.
 	int getSeed();
+	/// Seeds a single stream.
+	void seed(Stream stream, int seed);
+	/// Gets the state of a stream.
+	std::string getState(Stream stream);
+	/// Sets the state of a stream.
+	void setState(Stream stream, const std::string &state);
 	/// Generates a random integer number.
-	int generate(int min, int max);
+	int generate(int min, int max, Stream stream);
 	/// Generates a random decimal number.
-	double generate(double min, double max);
+	double generate(double min, double max, Stream stream);
 	/// Get normally distributed value.
-	double boxMuller(double m = 0, double s = 1);
+	double boxMuller(double m, double s, Stream stream);
 }
 
 }
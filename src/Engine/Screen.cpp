@@ -25,6 +25,7 @@
 #include "Action.h"
 #include "Options.h"
 #include "CrossPlatform.h"
+#include "Profiler.h"
 
 namespace OpenXcom
 {
@@ -216,6 +217,7 @@ int Screen::_zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int f
  */
 void Screen::flip()
 {
+	Profiler::Scope profile("Screen::flip");
 	if (getWidth() != BASE_WIDTH || getHeight() != BASE_HEIGHT)
 	{
 		_zoomSurfaceY(_surface->getSurface(), _screen, 0, 0);
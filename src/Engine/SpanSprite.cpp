@@ -0,0 +1,162 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "SpanSprite.h"
+#include <algorithm>
+#include "Surface.h"
+#include "GraphSubset.h"
+#include "Blit.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Goes through the rows of a frame and keeps its runs of
+ * non-transparent pixels.
+ * @param frame Frame to make the spans of.
+ */
+SpanSprite::SpanSprite(Surface *frame) : _width(frame->getWidth()), _height(frame->getHeight()), _rows(), _spans(), _pixels()
+{
+	frame->lock();
+	const SDL_Surface *s = frame->getSurface();
+	_rows.reserve(_height + 1);
+	for (int y = 0; y < _height; ++y)
+	{
+		_rows.push_back(_spans.size());
+		const Uint8 *row = (const Uint8*)s->pixels + y * s->pitch;
+		int x = 0;
+		while (x < _width)
+		{
+			while (x < _width && row[x] == 0)
+				++x;
+			if (x == _width)
+				break;
+			Span span;
+			span.x = x;
+			span.offset = _pixels.size();
+			while (x < _width && row[x] != 0)
+				_pixels.push_back(row[x++]);
+			span.length = x - span.x;
+			_spans.push_back(span);
+		}
+	}
+	_rows.push_back(_spans.size());
+	frame->unlock();
+}
+
+/**
+ * Copies the spans of another sprite, with their pixels shaded
+ * the same way Surface::blitNShade would shade them, so the copy
+ * can be drawn without shading.
+ * @param other Sprite to copy.
+ * @param shade Shade to add.
+ */
+SpanSprite::SpanSprite(const SpanSprite &other, int shade) : _width(other._width), _height(other._height), _rows(other._rows), _spans(other._spans), _pixels(other._pixels.size())
+{
+	if (!_pixels.empty())
+	{
+		Blit::shadeRow(&_pixels[0], &other._pixels[0], _pixels.size(), shade);
+	}
+}
+
+/**
+ * Deletes the spans.
+ */
+SpanSprite::~SpanSprite()
+{
+
+}
+
+/**
+ * Draws the sprite in a certain shade, the same as Surface::blitNShade
+ * would draw the frame it was made from, including the clipping.
+ * Notice there is no surface locking here - you have to make sure you lock the surface yourself
+ * at the start of blitting and unlock it when done.
+ * @param surface Surface to blit to.
+ * @param x X position of the sprite.
+ * @param y Y position of the sprite.
+ * @param off Shade to add.
+ * @param half Only draw the right half of the sprite.
+ * @param newBaseColor Attention: the actual color + 1, because 0 is no new base color.
+ */
+void SpanSprite::blitNShade(Surface *surface, int x, int y, int off, bool half, int newBaseColor) const
+{
+	const SDL_Rect &clip = surface->getSurface()->clip_rect;
+	GraphSubset src(std::make_pair(half ? _width / 2 : 0, _width), std::make_pair(0, _height));
+	GraphSubset dest(std::make_pair((int)clip.x, clip.x + clip.w), std::make_pair((int)clip.y, clip.y + clip.h));
+	GraphSubset area = GraphSubset::intersection(src.offset(x, y), dest.offset(surface->getX(), surface->getY()));
+	if (area.size_x() <= 0 || area.size_y() <= 0)
+		return;
+
+	const bool recolor = (newBaseColor != 0);
+	if (recolor)
+	{
+		--newBaseColor;
+		newBaseColor <<= 4;
+	}
+	const int destPitch = surface->getSurface()->pitch;
+	// the area in sprite coordinates, and where the sprite's left edge is on the surface
+	const int beginX = area.beg_x - x, endX = area.end_x - x;
+	const int beginY = area.beg_y - y, endY = area.end_y - y;
+	const int left = x - surface->getX();
+	Uint8 *destRow = (Uint8*)surface->getSurface()->pixels + (area.beg_y - surface->getY()) * destPitch;
+	for (int row = beginY; row < endY; ++row, destRow += destPitch)
+	{
+		for (int i = _rows[row]; i < _rows[row + 1]; ++i)
+		{
+			const Span &span = _spans[i];
+			int begin = std::max((int)span.x, beginX), end = std::min(span.x + span.length, endX);
+			if (begin >= end)
+				continue;
+			const Uint8 *pixels = &_pixels[span.offset + begin - span.x];
+			if (recolor)
+				Blit::recolorRow(destRow + left + begin, pixels, end - begin, off, newBaseColor);
+			else
+				Blit::shadeRow(destRow + left + begin, pixels, end - begin, off);
+		}
+	}
+}
+
+/**
+ * Returns the width of the sprite.
+ * @return Width in pixels.
+ */
+int SpanSprite::getWidth() const
+{
+	return _width;
+}
+
+/**
+ * Returns the height of the sprite.
+ * @return Height in pixels.
+ */
+int SpanSprite::getHeight() const
+{
+	return _height;
+}
+
+/**
+ * Returns how much memory the spans and their pixels take up.
+ * @return Size in bytes.
+ */
+size_t SpanSprite::getSize() const
+{
+	return sizeof(*this) + _rows.size() * sizeof(int) + _spans.size() * sizeof(Span) + _pixels.size();
+}
+
+}
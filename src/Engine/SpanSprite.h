@@ -0,0 +1,69 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_SPANSPRITE_H
+#define OPENXCOM_SPANSPRITE_H
+
+#include <vector>
+#include <SDL.h>
+
+namespace OpenXcom
+{
+
+class Surface;
+
+/**
+ * A sprite kept as the runs of non-transparent pixels on each of its rows,
+ * the way PCK images are stored on disk. Drawing it only touches those
+ * runs and skips the transparent parts altogether, which make up most
+ * of a terrain or unit sprite. Made from a frame when a SurfaceSet is
+ * loaded, and drawn exactly like Surface::blitNShade draws the frame.
+ */
+class SpanSprite
+{
+private:
+	/// A run of non-transparent pixels on a row.
+	struct Span
+	{
+		Uint16 x, length;
+		Uint32 offset;
+	};
+	int _width, _height;
+	std::vector<int> _rows;
+	std::vector<Span> _spans;
+	std::vector<Uint8> _pixels;
+public:
+	/// Creates the spans of a frame.
+	SpanSprite(Surface *frame);
+	/// Creates a shaded copy of spans.
+	SpanSprite(const SpanSprite &other, int shade);
+	/// Cleans up the spans.
+	~SpanSprite();
+	/// Draws the sprite shaded, like Surface::blitNShade.
+	void blitNShade(Surface *surface, int x, int y, int off, bool half = false, int newBaseColor = 0) const;
+	/// Gets the width of the sprite.
+	int getWidth() const;
+	/// Gets the height of the sprite.
+	int getHeight() const;
+	/// Gets the memory used by the spans.
+	size_t getSize() const;
+};
+
+}
+
+#endif
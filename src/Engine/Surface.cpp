@@ -17,12 +17,12 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "Surface.h"
-#include "ShaderDraw.h"
+#include "GraphSubset.h"
 #include <fstream>
 #include <SDL_gfxPrimitives.h>
 #include "Palette.h"
 #include "Exception.h"
-#include "ShaderMove.h"
+#include "Blit.h"
 
 namespace OpenXcom
 {
@@ -660,71 +660,12 @@ void Surface::paletteRestore()
 	}
 }
 
-/**
- * help class used for Surface::blitNShade
- */
-struct ColorReplace
-{
-	
-	/**
-	* Function used by ShaderDraw in Surface::blitNShade
-	* set shade and replace color in that surface
-	* @param dest destination pixel
-	* @param src source pixel
-	* @param shade value of shade of this surface
-	* @param newColor new color to set (it should be offseted by 4)
-	* @param notused
-	*/
-	static inline void func(Uint8& dest, const Uint8& src, const int& shade, const int& newColor, const int&)
-	{
-		if(src)
-		{
-			const int newShade = (src&15) + shade;
-			if (newShade > 15)
-				// so dark it would flip over to another color - make it black instead
-				dest = 15;
-			else
-				dest = newColor | newShade;
-		}
-	}
-	
-};
-
-/**
- * help class used for Surface::blitNShade
- */
-struct StandartShade
-{
-	/**
-	* Function used by ShaderDraw in Surface::blitNShade
-	* set shade
-	* @param dest destination pixel
-	* @param src source pixel
-	* @param shade value of shade of this surface
-	* @param notused
-	* @param notused
-	*/
-	static inline void func(Uint8& dest, const Uint8& src, const int& shade, const int&, const int&)
-	{
-		if(src)
-		{
-			const int newShade = (src&15) + shade;
-			if (newShade > 15)
-				// so dark it would flip over to another color - make it black instead
-				dest = 15;
-			else
-				dest = (src&(15<<4)) | newShade;
-		}
-	}
-	
-};
-
-
-
 /**
  * Specific blit function to blit battlescape terrain data in different shades in a fast way.
  * Notice there is no surface locking here - you have to make sure you lock the surface yourself
  * at the start of blitting and unlock it when done.
+ * Like any SDL blit, nothing is drawn outside the clipping rectangle of the target surface.
+ * The rows are drawn with the Blit kernels, which do many pixels at once where they can.
  * @param surface to blit to
  * @param x
  * @param y
@@ -734,22 +675,34 @@ struct StandartShade
  */
 void Surface::blitNShade(Surface *surface, int x, int y, int off, bool half, int newBaseColor)
 {
-	ShaderMove<Uint8> src(this, x, y);
-	if(half)
-	{
-		GraphSubset g = src.getDomain();
-		g.beg_x = g.end_x/2;
-		src.setDomain(g);
-	}
+	// same drawing area as ShaderDraw would work out for a ShaderMove of each surface
+	const SDL_Rect &clip = surface->getSurface()->clip_rect;
+	GraphSubset src(std::make_pair(half ? getWidth() / 2 : 0, getWidth()), std::make_pair(0, getHeight()));
+	GraphSubset dest(std::make_pair((int)clip.x, clip.x + clip.w), std::make_pair((int)clip.y, clip.y + clip.h));
+	GraphSubset area = GraphSubset::intersection(src.offset(x, y), dest.offset(surface->getX(), surface->getY()));
+	if (area.size_x() <= 0 || area.size_y() <= 0)
+		return;
+
+	const int srcPitch = _surface->pitch, destPitch = surface->getSurface()->pitch;
+	const Uint8 *srcRow = (Uint8*)_surface->pixels + (area.beg_y - y) * srcPitch + (area.beg_x - x);
+	Uint8 *destRow = (Uint8*)surface->getSurface()->pixels + (area.beg_y - surface->getY()) * destPitch + (area.beg_x - surface->getX());
+	const int width = area.size_x();
 	if(newBaseColor)
 	{
 		--newBaseColor;
 		newBaseColor <<= 4;
-		ShaderDraw<ColorReplace>(ShaderSurface(surface), src, ShaderScalar(off), ShaderScalar(newBaseColor));
+		for (int i = area.size_y(); i > 0; --i, srcRow += srcPitch, destRow += destPitch)
+		{
+			Blit::recolorRow(destRow, srcRow, width, off, newBaseColor);
+		}
 	}
 	else
-		ShaderDraw<StandartShade>(ShaderSurface(surface), src, ShaderScalar(off));
-		
+	{
+		for (int i = area.size_y(); i > 0; --i, srcRow += srcPitch, destRow += destPitch)
+		{
+			Blit::shadeRow(destRow, srcRow, width, off);
+		}
+	}
 }
 
 /**
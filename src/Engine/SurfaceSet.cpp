@@ -18,18 +18,25 @@
  */
 #include "SurfaceSet.h"
 #include <fstream>
+#include <algorithm>
 #include "Surface.h"
+#include "SpanSprite.h"
 #include "Exception.h"
+#include "Options.h"
+#include "Profiler.h"
 
 namespace OpenXcom
 {
 
+const int SurfaceSet::SHADES;
+size_t SurfaceSet::_shadedTotal = 0;
+
 /**
  * Sets up a new empty surface set for frames of the specified size.
  * @param width Frame width in pixels.
  * @param height Frame height in pixels.
  */
-SurfaceSet::SurfaceSet(int width, int height) : _width(width), _height(height), _frames()
+SurfaceSet::SurfaceSet(int width, int height) : _width(width), _height(height), _frames(), _spans(), _palette(256), _shaded(), _shadedUsed(), _shadedSize(0), _shadedBudget(std::max(0, Options::getInt("battleShadeCache")) * 1024)
 {
 
 }
@@ -38,14 +45,18 @@ SurfaceSet::SurfaceSet(int width, int height) : _width(width), _height(height),
  * Performs a deep copy of an existing surface set.
  * @param other Surface set to copy from.
  */
-SurfaceSet::SurfaceSet(const SurfaceSet& other)
+SurfaceSet::SurfaceSet(const SurfaceSet& other) : _palette(other._palette), _shaded(), _shadedUsed(), _shadedSize(0), _shadedBudget(other._shadedBudget)
 {
 	_width = other._width;
 	_height = other._height;
 
 	for (unsigned int f = 0; f < other._frames.size(); f++)
 	{
-		_frames.push_back(new Surface(*other._frames[f]));
+		_frames.push_back(other._frames[f] ? new Surface(*other._frames[f]) : 0);
+	}
+	for (unsigned int f = 0; f < other._spans.size(); f++)
+	{
+		_spans.push_back(new SpanSprite(*other._spans[f]));
 	}
 }
 
@@ -58,13 +69,28 @@ SurfaceSet::~SurfaceSet()
 	{
 		delete *i;
 	}
+	for (std::vector<SpanSprite*>::iterator i = _spans.begin(); i != _spans.end(); ++i)
+	{
+		delete *i;
+	}
+	for (std::vector<ShadedFrame>::iterator i = _shaded.begin(); i != _shaded.end(); ++i)
+	{
+		delete i->spans;
+	}
+	if (_shadedSize > 0)
+	{
+		_shadedTotal -= _shadedSize;
+		Profiler::gauge("SurfaceSet::shadeCacheBytes", _shadedTotal);
+	}
 }
 
 /**
  * Loads the contents of an X-Com set of PCK/TAB image files
  * into the surface. The PCK file contains an RLE compressed
  * image, while the TAB file contains the offsets to each
- * frame in the image.
+ * frame in the image. Each frame is only kept as spans
+ * (see SpanSprite), which the battlescape draws from; the
+ * surface of a frame is made from them when it's asked for.
  * @param pck Filename of the PCK image.
  * @param tab Filename of the TAB offsets.
  * @sa http://www.ufopaedia.org/index.php?title=Image_Formats#PCK
@@ -78,8 +104,6 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 	if (!offsetFile)
 	{
 		nframes = 1;
-		Surface *surface = new Surface(_width, _height);
-		_frames.push_back(surface);
 	}
 	else
 	{
@@ -87,8 +111,6 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 
 		while (offsetFile.read((char*)&off, sizeof(off)))
 		{
-			Surface *surface = new Surface(_width, _height);
-			_frames.push_back(surface);
 			nframes++;
 		}
 	}
@@ -101,20 +123,23 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 	}
 
 	Uint8 value;
+	// Every frame is unpacked in the same surface, only to make its spans
+	Surface surface(_width, _height);
 
 	for (int frame = 0; frame < nframes; frame++)
 	{
 		int x = 0, y = 0;
 
+		surface.clear();
 		// Lock the surface
-		_frames[frame]->lock();
+		surface.lock();
 
 		imgFile.read((char*)&value, 1);
 		for (int i = 0; i < value; ++i)
 		{
 			for (int j = 0; j < _width; ++j)
 			{
-				_frames[frame]->setPixelIterative(&x, &y, 0);
+				surface.setPixelIterative(&x, &y, 0);
 			}
 		}
 
@@ -125,17 +150,20 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 				imgFile.read((char*)&value, 1);
 				for (int i = 0; i < value; ++i)
 				{
-					_frames[frame]->setPixelIterative(&x, &y, 0);
+					surface.setPixelIterative(&x, &y, 0);
 				}
 			}
 			else
 			{
-				_frames[frame]->setPixelIterative(&x, &y, value);
+				surface.setPixelIterative(&x, &y, value);
 			}
 		}
 
 		// Unlock the surface
-		_frames[frame]->unlock();
+		surface.unlock();
+
+		_frames.push_back(0);
+		_spans.push_back(new SpanSprite(&surface));
 	}
 
 	imgFile.close();
@@ -204,14 +232,118 @@ void SurfaceSet::loadDat(const std::string &filename)
 
 /**
  * Returns a particular frame from the surface set.
+ * Frames loaded from a PCK file are drawn from their
+ * spans the first time they're asked for.
  * @param i Frame number in the set.
  * @return Pointer to the respective surface.
  */
 Surface *const SurfaceSet::getFrame(int i) const
 {
+	if (!_frames[i])
+	{
+		Surface *surface = new Surface(_width, _height);
+		surface->setPalette(const_cast<SDL_Color*>(&_palette[0]));
+		surface->lock();
+		_spans[i]->blitNShade(surface, 0, 0, 0);
+		surface->unlock();
+		_frames[i] = surface;
+	}
 	return _frames[i];
 }
 
+/**
+ * Returns the spans of a particular frame, made when it was
+ * loaded from a PCK file.
+ * @param i Frame number in the set.
+ * @return Pointer to the spans, or 0 if the frame has none.
+ */
+SpanSprite *SurfaceSet::getSpans(int i) const
+{
+	if (i < 0 || i >= (int)_spans.size())
+		return 0;
+	return _spans[i];
+}
+
+/**
+ * Returns the spans of a particular frame with a shade already applied,
+ * so they can be drawn as they are. Shaded frames are made the first
+ * time they're asked for, and kept as long as they fit in the budget
+ * set by the "battleShadeCache" option, dropping the ones used the
+ * longest ago to make room.
+ * @param i Frame number in the set.
+ * @param shade Shade to apply.
+ * @return Pointer to the shaded spans, or 0 if they can't be kept.
+ */
+SpanSprite *SurfaceSet::getShadedSpans(int i, int shade)
+{
+	if (shade == 0)
+		return getSpans(i);
+	if (shade < 0 || _shadedBudget == 0 || i < 0 || i >= (int)_spans.size())
+		return 0;
+	shade = std::min(shade, SHADES);
+
+	if (_shaded.empty())
+	{
+		ShadedFrame none;
+		none.spans = 0;
+		none.used = _shadedUsed.end();
+		_shaded.resize(_spans.size() * SHADES, none);
+	}
+	int key = i * SHADES + shade - 1;
+	ShadedFrame &shaded = _shaded[key];
+	if (shaded.spans)
+	{
+		Profiler::count("SurfaceSet::shadeCacheHits");
+		_shadedUsed.splice(_shadedUsed.begin(), _shadedUsed, shaded.used);
+		return shaded.spans;
+	}
+
+	Profiler::count("SurfaceSet::shadeCacheMisses");
+	SpanSprite *spans = new SpanSprite(*_spans[i], shade);
+	size_t size = spans->getSize();
+	if (size > _shadedBudget)
+	{
+		delete spans;
+		return 0;
+	}
+	while (_shadedSize + size > _shadedBudget)
+	{
+		dropShaded();
+	}
+	shaded.spans = spans;
+	shaded.used = _shadedUsed.insert(_shadedUsed.begin(), key);
+	_shadedSize += size;
+	_shadedTotal += size;
+	Profiler::gauge("SurfaceSet::shadeCacheBytes", _shadedTotal);
+	return spans;
+}
+
+/**
+ * Deletes the shaded frame that was used the longest ago.
+ */
+void SurfaceSet::dropShaded()
+{
+	ShadedFrame &shaded = _shaded[_shadedUsed.back()];
+	size_t size = shaded.spans->getSize();
+	_shadedSize -= size;
+	_shadedTotal -= size;
+	Profiler::count("SurfaceSet::shadeCacheEvictions");
+	Profiler::gauge("SurfaceSet::shadeCacheBytes", _shadedTotal);
+	delete shaded.spans;
+	shaded.spans = 0;
+	shaded.used = _shadedUsed.end();
+	_shadedUsed.pop_back();
+}
+
+/**
+ * Returns how much memory the frames shaded ahead of time take up.
+ * @return Size in bytes.
+ */
+size_t SurfaceSet::getShadedSize() const
+{
+	return _shadedSize;
+}
+
 /**
  * Returns the full width of a frame in the set.
  * @return Width in pixels.
@@ -248,9 +380,13 @@ int SurfaceSet::getTotalFrames() const
  */
 void SurfaceSet::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 {
+	std::copy(colors, colors + ncolors, _palette.begin() + firstcolor);
 	for (std::vector<Surface*>::iterator i = _frames.begin(); i != _frames.end(); ++i)
 	{
-		(*i)->setPalette(colors, firstcolor, ncolors);
+		if (*i)
+		{
+			(*i)->setPalette(colors, firstcolor, ncolors);
+		}
 	}
 }
 
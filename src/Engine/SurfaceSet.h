@@ -20,6 +20,7 @@
 #define OPENXCOM_SURFACESET_H
 
 #include <vector>
+#include <list>
 #include <string>
 #include <SDL.h>
 
@@ -27,6 +28,7 @@ namespace OpenXcom
 {
 
 class Surface;
+class SpanSprite;
 
 /**
  * Container of a set of surfaces.
@@ -38,7 +40,25 @@ class SurfaceSet
 {
 private:
 	int _width, _height;
-	std::vector<Surface*> _frames;
+	/// Frames of a PCK set are only made from their spans when asked for.
+	mutable std::vector<Surface*> _frames;
+	std::vector<SpanSprite*> _spans;
+	std::vector<SDL_Color> _palette;
+	/// Number of shades kept for each frame; any shade from the last one on is all black.
+	static const int SHADES = 16;
+	/// A frame shaded ahead of time, and where it is in the list of recently used ones.
+	struct ShadedFrame
+	{
+		SpanSprite *spans;
+		std::list<int>::iterator used;
+	};
+	std::vector<ShadedFrame> _shaded;
+	std::list<int> _shadedUsed;
+	size_t _shadedSize, _shadedBudget;
+	/// Memory taken up by the frames shaded ahead of time in all the sets.
+	static size_t _shadedTotal;
+	/// Forgets the frame shaded ahead of time that was used the longest ago.
+	void dropShaded();
 public:
 	/// Crates a surface set with frames of the specified size.
 	SurfaceSet(int width, int height);
@@ -52,6 +72,12 @@ public:
 	void loadDat(const std::string &filename);
 	/// Gets a particular frame from the set.
 	Surface *const getFrame(int i) const;
+	/// Gets the spans of a particular frame.
+	SpanSprite *getSpans(int i) const;
+	/// Gets the spans of a particular frame, shaded ahead of time.
+	SpanSprite *getShadedSpans(int i, int shade);
+	/// Gets the memory used by frames shaded ahead of time.
+	size_t getShadedSize() const;
 	/// Gets the width of all frames.
 	int getWidth() const;
 	/// Gets the height of all frames.
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ThreadPool.h"
+#include "Exception.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Creates the worker threads, which wait for a batch of jobs to run.
+ * @param threads Number of threads besides the one running the batches.
+ */
+ThreadPool::ThreadPool(int threads) : _job(0), _data(0), _next(0), _count(0), _busy(0), _started(0), _batch(0), _quit(false)
+{
+	_mutex = SDL_CreateMutex();
+	_start = SDL_CreateCond();
+	_done = SDL_CreateCond();
+	if (_mutex == 0 || _start == 0 || _done == 0)
+	{
+		throw Exception(SDL_GetError());
+	}
+	for (int i = 0; i < threads; ++i)
+	{
+		SDL_Thread *thread = SDL_CreateThread(loop, this);
+		if (thread == 0)
+		{
+			// run with whatever threads we got
+			break;
+		}
+		_threads.push_back(thread);
+	}
+}
+
+/**
+ * Tells the worker threads to quit and waits for them.
+ */
+ThreadPool::~ThreadPool()
+{
+	SDL_LockMutex(_mutex);
+	_quit = true;
+	SDL_CondBroadcast(_start);
+	SDL_UnlockMutex(_mutex);
+	for (std::vector<SDL_Thread*>::iterator i = _threads.begin(); i != _threads.end(); ++i)
+	{
+		SDL_WaitThread(*i, 0);
+	}
+	SDL_DestroyCond(_done);
+	SDL_DestroyCond(_start);
+	SDL_DestroyMutex(_mutex);
+}
+
+/**
+ * Main loop of a worker thread: waits for a new batch,
+ * helps working on it, then reports back.
+ * @param pool Pointer to the pool.
+ * @return Always 0.
+ */
+int ThreadPool::loop(void *pool)
+{
+	ThreadPool *self = (ThreadPool*)pool;
+
+	SDL_LockMutex(self->_mutex);
+	int worker = ++self->_started;
+	unsigned int batch = 0;
+	while (true)
+	{
+		while (!self->_quit && batch == self->_batch)
+		{
+			SDL_CondWait(self->_start, self->_mutex);
+		}
+		if (self->_quit)
+		{
+			break;
+		}
+		batch = self->_batch;
+		SDL_UnlockMutex(self->_mutex);
+
+		self->work(worker);
+
+		SDL_LockMutex(self->_mutex);
+		if (--self->_busy == 0)
+		{
+			SDL_CondSignal(self->_done);
+		}
+	}
+	SDL_UnlockMutex(self->_mutex);
+	return 0;
+}
+
+/**
+ * Takes jobs of the current batch until there are none left.
+ * @param worker Index of the thread doing the work.
+ */
+void ThreadPool::work(int worker)
+{
+	while (true)
+	{
+		SDL_LockMutex(_mutex);
+		int job = _next++;
+		SDL_UnlockMutex(_mutex);
+		if (job >= _count)
+		{
+			break;
+		}
+		_job(_data, job, worker);
+	}
+}
+
+/**
+ * Gets the number of threads that can run jobs at once,
+ * including the one starting the batch. Worker indexes
+ * passed to jobs are below this.
+ * @return Number of workers.
+ */
+int ThreadPool::getWorkers() const
+{
+	return _threads.size() + 1;
+}
+
+/**
+ * Runs a batch of jobs on all threads of the pool. Which thread
+ * runs which job is up to chance, so jobs must not depend on each
+ * other or the order they run in.
+ * @param job Function to run for each job.
+ * @param data Data shared by the jobs.
+ * @param count Number of jobs.
+ */
+void ThreadPool::run(ThreadJob job, void *data, int count)
+{
+	if (_threads.empty() || count < 2)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			job(data, i, 0);
+		}
+		return;
+	}
+
+	SDL_LockMutex(_mutex);
+	_job = job;
+	_data = data;
+	_next = 0;
+	_count = count;
+	_busy = _threads.size();
+	++_batch;
+	SDL_CondBroadcast(_start);
+	SDL_UnlockMutex(_mutex);
+
+	work(0);
+
+	SDL_LockMutex(_mutex);
+	while (_busy > 0)
+	{
+		SDL_CondWait(_done, _mutex);
+	}
+	SDL_UnlockMutex(_mutex);
+}
+
+}
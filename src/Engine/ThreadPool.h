@@ -0,0 +1,63 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_THREADPOOL_H
+#define OPENXCOM_THREADPOOL_H
+
+#include <vector>
+#include <SDL.h>
+
+namespace OpenXcom
+{
+
+/// A job run by the thread pool: data is shared by all jobs of a batch,
+/// job is the index of this job and worker the index of the thread running it.
+typedef void (*ThreadJob)(void *data, int job, int worker);
+
+/**
+ * A fixed set of worker threads that run batches of independent jobs.
+ * The thread starting a batch works on it too and only returns once
+ * every job is done, so the jobs can use data on its stack.
+ */
+class ThreadPool
+{
+private:
+	std::vector<SDL_Thread*> _threads;
+	SDL_mutex *_mutex;
+	SDL_cond *_start, *_done;
+	ThreadJob _job;
+	void *_data;
+	int _next, _count, _busy, _started;
+	unsigned int _batch;
+	bool _quit;
+	static int loop(void *pool);
+	void work(int worker);
+public:
+	/// Creates a pool with a number of extra threads.
+	ThreadPool(int threads);
+	/// Stops the threads and cleans up the pool.
+	~ThreadPool();
+	/// Gets the number of threads that can run jobs at once.
+	int getWorkers() const;
+	/// Runs a batch of jobs and waits for them to finish.
+	void run(ThreadJob job, void *data, int count);
+};
+
+}
+
+#endif
@@ -370,10 +370,10 @@ void DogfightState::move()
 			// Handle weapon damage
 			if ((*d) >= _currentDist)
 			{
-				int acc = RNG::generate(1, 100);
+				int acc = RNG::generate(1, 100, RNG::GEOSCAPE);
 				if (acc <= w->getRules()->getAccuracy() && !_ufo->isCrashed())
 				{
-					int damage = RNG::generate(w->getRules()->getDamage() / 2, w->getRules()->getDamage());
+					int damage = RNG::generate(w->getRules()->getDamage() / 2, w->getRules()->getDamage(), RNG::GEOSCAPE);
 					_ufo->setDamage(_ufo->getDamage() + damage);
 					setStatus("STR_UFO_HIT");
 					_currentRadius += 4;
@@ -508,7 +508,7 @@ void DogfightState::move()
 			}
 			else
 			{
-				_ufo->setHoursCrashed(24 + RNG::generate(0, 72));
+				_ufo->setHoursCrashed(24 + RNG::generate(0, 72, RNG::GEOSCAPE));
 			}
 		}
 		_targetRadius = 0;
@@ -22,6 +22,7 @@
 #include <sstream>
 #include <iomanip>
 #include "../Engine/RNG.h"
+#include "../Engine/Profiler.h"
 #include "../Engine/Game.h"
 #include "../Engine/Action.h"
 #include "../Resource/ResourcePack.h"
@@ -300,7 +301,7 @@ void GeoscapeState::init()
 	if (!_music)
 	{
 		std::stringstream ss;
-		ss << "GMGEO" << RNG::generate(1, 2);
+		ss << "GMGEO" << RNG::generate(1, 2, RNG::EFFECTS);
 		_game->getResourcePack()->getMusic(ss.str())->play();
 		_music = true;
 	}
@@ -369,6 +370,7 @@ void GeoscapeState::timeDisplay()
  */
 void GeoscapeState::timeAdvance()
 {
+	Profiler::Scope profile("GeoscapeState::timeAdvance");
 	int timeSpan = 0;
 	if (_timeSpeed == _btn5Secs)
 	{
@@ -556,10 +558,10 @@ void GeoscapeState::time10Minutes()
 void GeoscapeState::time30Minutes()
 {
 	// Spawn UFOs
-	int chance = RNG::generate(1, 100);
+	int chance = RNG::generate(1, 100, RNG::GEOSCAPE);
 	if (chance <= 50)
 	{
-		int type = RNG::generate(1, 3);
+		int type = RNG::generate(1, 3, RNG::GEOSCAPE);
 		Ufo *u;
 		switch (type)
 		{
@@ -573,13 +575,13 @@ void GeoscapeState::time30Minutes()
 			u = new Ufo(_game->getRuleset()->getUfo("STR_LARGE_SCOUT"));
 			break;
 		}
-		u->setLongitude(RNG::generate(0.0, 2*M_PI));
-		u->setLatitude(RNG::generate(-M_PI_2, M_PI_2));
+		u->setLongitude(RNG::generate(0.0, 2*M_PI, RNG::GEOSCAPE));
+		u->setLatitude(RNG::generate(-M_PI_2, M_PI_2, RNG::GEOSCAPE));
 		Waypoint *w = new Waypoint();
-		w->setLongitude(RNG::generate(0.0, 2*M_PI));
-		w->setLatitude(RNG::generate(-M_PI_2, M_PI_2));
+		w->setLongitude(RNG::generate(0.0, 2*M_PI, RNG::GEOSCAPE));
+		w->setLatitude(RNG::generate(-M_PI_2, M_PI_2, RNG::GEOSCAPE));
 		u->setDestination(w);
-		u->setSpeed(RNG::generate(u->getRules()->getMaxSpeed() / 4, u->getRules()->getMaxSpeed() / 2));
+		u->setSpeed(RNG::generate(u->getRules()->getMaxSpeed() / 4, u->getRules()->getMaxSpeed() / 2, RNG::GEOSCAPE));
 		_game->getSavedGame()->getUfos()->push_back(u);
 	}
 
@@ -628,7 +630,7 @@ void GeoscapeState::time30Minutes()
 						continue;
 					if ((*f)->insideRadarRange(*u))
 					{
-						int chance = RNG::generate(1, 100);
+						int chance = RNG::generate(1, 100, RNG::GEOSCAPE);
 						if (chance <= (*f)->getRules()->getRadarChance())
 						{
 							detected = true;
@@ -47,6 +47,7 @@
 #include "../Engine/ShaderMove.h"
 #include "../Engine/ShaderRepeat.h"
 #include "../Engine/Options.h"
+#include "../Engine/Profiler.h"
 
 namespace OpenXcom
 {
@@ -939,6 +940,7 @@ void Globe::rotate()
  */
 void Globe::draw()
 {
+	Profiler::Scope profile("Globe::draw");
 	Surface::draw();
 	drawOcean();
 	drawLand();
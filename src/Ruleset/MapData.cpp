@@ -25,8 +25,16 @@ namespace OpenXcom
 *  Creates a new Map Data Object.
 * @param dataset The dataset this object belongs to.
 */
-MapData::MapData(MapDataSet *dataset) : _dataset(dataset)
+MapData::MapData(MapDataSet *dataset) : _dataset(dataset), _voxelsEmpty(true)
 {
+	for (int layer = 0; layer < 12; ++layer)
+	{
+		_loftID[layer] = 0;
+		for (int y = 0; y < 16; ++y)
+		{
+			_voxels[layer][y] = 0;
+		}
+	}
 
 }
 
@@ -67,6 +75,22 @@ void MapData::setSprite(int frameID, int value)
 	_sprite[frameID] = value;
 }
 
+/**
+* Check if the object is animated, i.e. its sprite changes between frames.
+* @return True if any frame has a different sprite.
+*/
+bool MapData::isAnimated() const
+{
+	for (int frame = 1; frame < 8; ++frame)
+	{
+		if (_sprite[frame] != _sprite[0])
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
   * Get whether this is an animated ufo door.
   * @return bool
@@ -418,6 +442,37 @@ void MapData::setLoftID(int loft, int layer)
 	_loftID[layer] = loft;
 }
 
+/**
+ * Builds the voxel occupancy table of this object: one row of 16 bits per
+ * layer and y, taken from the loft templates. Terrain lofts are stored mirrored,
+ * so the rows are flipped here to make bit x the voxel at x, same as for units.
+ * @param voxelData The loft templates (LOFTEMPS.DAT).
+ */
+void MapData::loadVoxels(const std::vector<Uint16> *voxelData)
+{
+	_voxelsEmpty = true;
+	for (int layer = 0; layer < 12; ++layer)
+	{
+		for (int y = 0; y < 16; ++y)
+		{
+			Uint16 row = voxelData->at(_loftID[layer] * 16 + y);
+			Uint16 flipped = 0;
+			for (int x = 0; x < 16; ++x)
+			{
+				if (row & (1 << (15 - x)))
+				{
+					flipped |= 1 << x;
+				}
+			}
+			_voxels[layer][y] = flipped;
+			if (flipped)
+			{
+				_voxelsEmpty = false;
+			}
+		}
+	}
+}
+
 /**
   * Get the amount of explosive.
   * @return armor
@@ -19,6 +19,8 @@
 #ifndef OPENXCOM_MAPDATA_H
 #define OPENXCOM_MAPDATA_H
 
+#include <vector>
+#include <SDL.h>
 #include "RuleItem.h"
 
 namespace OpenXcom
@@ -59,6 +61,8 @@ private:
 	int _sprite[8];
 	int _block[6];
 	int _loftID[12];
+	Uint16 _voxels[12][16];
+	bool _voxelsEmpty;
 	unsigned short _miniMapIndex;
 public:
 	static const int O_FLOOR = 0;
@@ -73,6 +77,8 @@ public:
 	int getSprite(int frameID) const;
 	/// Set the sprite index for a certain frame.
 	void setSprite(int frameID, int value);
+	/// Does the sprite change between frames?
+	bool isAnimated() const;
 	/// Get whether this is an animated ufo door.
 	bool isUFODoor() const;
 	/// Can we walk over it.
@@ -139,6 +145,12 @@ public:
 	int getLoftID(int layer) const;
 	/// Set the loft index for a certain layer.
 	void setLoftID(int loft, int layer);
+	/// Build the voxel occupancy table from the loft indexes.
+	void loadVoxels(const std::vector<Uint16> *voxelData);
+	/// Get a row of voxels of the occupancy table.
+	Uint16 getVoxelRow(int z, int y) const { return _voxels[z >> 1][y]; }
+	/// Does this object not occupy any voxel?
+	bool isVoxelEmpty() const { return _voxelsEmpty; }
 	/// Get the amount of explosive.
 	int getExplosive() const;
 	/// Set the amount of explosive.
@@ -105,8 +105,9 @@ SurfaceSet *MapDataSet::getSurfaceset() const
 /**
  * Loads terraindata in X-Com format (MCD & PCK files)
  * @sa http://www.ufopaedia.org/index.php?title=MCD
+ * @param voxelData The loft templates, to build the voxel tables of the objects from.
  */
-void MapDataSet::loadData()
+void MapDataSet::loadData(const std::vector<Uint16> *voxelData)
 {
 	// prevents loading twice
 	if (_loaded) return;
@@ -206,6 +207,7 @@ void MapDataSet::loadData()
 			int loft = (int)mcd.LOFT[layer];
 			to->setLoftID(loft, layer);
 		}
+		to->loadVoxels(voxelData);
 
 		// store the 2 tiles of blanks in a static - so they are accessible everywhere
 		if (_name.compare("BLANKS") == 0)
@@ -64,7 +64,7 @@ public:
 	/// Get surfaces in this dataset.
 	SurfaceSet *getSurfaceset() const;
 	/// Load the objects from an MCD file.
-	void loadData();
+	void loadData(const std::vector<Uint16> *voxelData);
 	///	Unload to free memory.
 	void unloadData();
 	///
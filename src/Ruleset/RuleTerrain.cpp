@@ -154,7 +154,7 @@ MapBlock* RuleTerrain::getRandomMapBlock(int maxsize, MapBlockType type)
 
 	if (compliantMapBlocks.empty()) return 0;
 
-	int n = RNG::generate(0, compliantMapBlocks.size() - 1);
+	int n = RNG::generate(0, compliantMapBlocks.size() - 1, RNG::MAP);
 
 	return compliantMapBlocks[n];
 }
@@ -127,12 +127,11 @@ BattleUnit::BattleUnit(Unit *unit, UnitFaction faction, Armor *armor) : _faction
 }
 
 /**
- *
+ * The cached frames belong to the map's unit sprite cache.
  */
 BattleUnit::~BattleUnit()
 {
-	for (int i = 0; i < 5; ++i)
-		delete _cache[i];
+
 }
 
 /**
@@ -607,6 +606,17 @@ Surface *BattleUnit::getCache(bool *invalid, int part) const
 	return _cache[part];
 }
 
+/**
+ * Forgets the frames the unit is cached as, for when the
+ * cache they belong to goes away, and marks it for redrawing.
+ */
+void BattleUnit::clearCache()
+{
+	for (int i = 0; i < 5; ++i)
+		_cache[i] = 0;
+	_cacheInvalid = true;
+}
+
 /**
  * Kneel down.
  * @param kneeled to kneel or to stand up
@@ -802,8 +812,8 @@ void BattleUnit::damage(Position position, int power, ItemDamageType type, bool
 				// fatal wounds
 				if (isWoundable())
 				{
-					if (RNG::generate(0,power) > 2)
-						_fatalWounds[bodypart] += RNG::generate(1,3);
+					if (RNG::generate(0,power,RNG::COMBAT) > 2)
+						_fatalWounds[bodypart] += RNG::generate(1,3,RNG::COMBAT);
 
 					if (_fatalWounds[bodypart])
 						moraleChange(-_fatalWounds[bodypart]);
@@ -1135,7 +1145,7 @@ void BattleUnit::prepareNewTurn()
 	// suffer from fire
 	if (_fire > 0)
 	{
-		_health -= RNG::generate(5, 10);
+		_health -= RNG::generate(5, 10, RNG::COMBAT);
 		_fire--;
 	}
 
@@ -1157,9 +1167,9 @@ void BattleUnit::prepareNewTurn()
 	if (!isOut())
 	{
 		int chance = 100 - (2 * getMorale());
-		if (RNG::generate(1,100) <= chance)
+		if (RNG::generate(1,100,RNG::COMBAT) <= chance)
 		{
-			int type = RNG::generate(0,100);
+			int type = RNG::generate(0,100,RNG::COMBAT);
 			_status = (type<=33?STATUS_BERSERK:STATUS_PANICKING); // 33% chance of berserk, panic can mean freeze or flee, but that is determined later
 		}
 		else
@@ -1509,11 +1519,11 @@ bool BattleUnit::postMissionProcedures(SavedGame *geoscape)
 	UnitStats *stats = s->getCurrentStats();
 	int healthLoss = stats->health - _health;
 
-	s->setWoundRecovery(RNG::generate((healthLoss*0.5),(healthLoss*1.5)));
+	s->setWoundRecovery(RNG::generate((healthLoss*0.5),(healthLoss*1.5), RNG::COMBAT));
 
 	if (_expBravery && stats->bravery < 100)
 	{
-		if (_expBravery > RNG::generate(0,10)) stats->bravery += 10;
+		if (_expBravery > RNG::generate(0,10,RNG::COMBAT)) stats->bravery += 10;
 	}
 	if (_expReactions && stats->reactions < 100)
 	{
@@ -1542,13 +1552,13 @@ bool BattleUnit::postMissionProcedures(SavedGame *geoscape)
 			s->promoteRank();
 		int v;
 		v = 80 - stats->tu;
-		if (v > 0) stats->tu += RNG::generate(0, v/10 + 2);
+		if (v > 0) stats->tu += RNG::generate(0, v/10 + 2, RNG::COMBAT);
 		v = 60 - stats->health;
-		if (v > 0) stats->health += RNG::generate(0, v/10 + 2);
+		if (v > 0) stats->health += RNG::generate(0, v/10 + 2, RNG::COMBAT);
 		v = 70 - stats->strength;
-		if (v > 0) stats->strength += RNG::generate(0, v/10 + 2);
+		if (v > 0) stats->strength += RNG::generate(0, v/10 + 2, RNG::COMBAT);
 		v = 100 - stats->stamina;
-		if (v > 0) stats->stamina += RNG::generate(0, v/10 + 2);
+		if (v > 0) stats->stamina += RNG::generate(0, v/10 + 2, RNG::COMBAT);
 		return true;
 	}
 	else
@@ -1568,7 +1578,7 @@ int BattleUnit::improveStat(int exp)
 	if (exp < 3) v = 1;
 	if (exp < 6) v = 2;
 	if (exp < 10) v = 3;
-	return (int)(v/2.0 + RNG::generate(0.0, v));
+	return (int)(v/2.0 + RNG::generate(0.0, v, RNG::COMBAT));
 }
 
 /*
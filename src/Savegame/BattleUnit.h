@@ -152,6 +152,8 @@ public:
 	void setCache(Surface *cache, int part = 0);
 	/// If this unit is cached on the battlescape.
 	Surface *getCache(bool *invalid, int part = 0) const;
+	/// Forget the cached frames.
+	void clearCache();
 	/// Kneel down.
 	void kneel(bool kneeled);
 	/// Is kneeled?
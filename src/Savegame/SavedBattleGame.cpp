@@ -20,9 +20,11 @@
 #include "SavedBattleGame.h"
 #include "SavedGame.h"
 #include "Tile.h"
+#include "TileGrid.h"
 #include "Node.h"
 #include <SDL.h>
 #include "../Ruleset/MapDataSet.h"
+#include "../Ruleset/MapData.h"
 #include "../Battlescape/Pathfinding.h"
 #include "../Battlescape/TileEngine.h"
 #include "../Battlescape/Position.h"
@@ -43,7 +45,7 @@ namespace OpenXcom
 /**
  * Initializes a brand new battlescape saved game.
  */
-SavedBattleGame::SavedBattleGame() : _tiles(), _selectedUnit(0), _nodes(), _units(), _items(), _pathfinding(0), _tileEngine(0), _missionType(""), _side(FACTION_PLAYER), _turn(1), _debugMode(false), _aborted(false), _itemId(0)
+SavedBattleGame::SavedBattleGame() : _tileGrid(0), _tiles(), _selectedUnit(0), _nodes(), _units(), _items(), _pathfinding(0), _tileEngine(0), _missionType(""), _side(FACTION_PLAYER), _turn(1), _debugMode(false), _aborted(false), _itemId(0), _seed(-1)
 {
 }
 
@@ -52,11 +54,8 @@ SavedBattleGame::SavedBattleGame() : _tiles(), _selectedUnit(0), _nodes(), _unit
  */
 SavedBattleGame::~SavedBattleGame()
 {
-	for (int i = 0; i < _height * _length * _width; ++i)
-	{
-		delete _tiles[i];
-	}
 	delete[] _tiles;
+	delete _tileGrid;
 
 	for (std::vector<Node*>::iterator i = _nodes.begin(); i != _nodes.end(); ++i)
 	{
@@ -91,6 +90,20 @@ void SavedBattleGame::load(const YAML::Node &node, Ruleset *rule, SavedGame* sav
 	node["height"] >> _height;
 	node["globalshade"] >> _globalShade;
 	node["selectedUnit"] >> selectedUnit;
+	if (const YAML::Node *pName = node.FindValue("seed"))
+	{
+		*pName >> _seed;
+	}
+	if (const YAML::Node *pName = node.FindValue("rng"))
+	{
+		std::string state;
+		(*pName)["map"] >> state;
+		RNG::setState(RNG::MAP, state);
+		(*pName)["ai"] >> state;
+		RNG::setState(RNG::AI, state);
+		(*pName)["combat"] >> state;
+		RNG::setState(RNG::COMBAT, state);
+	}
 
 	for (YAML::Iterator i = node["mapdatasets"].begin(); i != node["mapdatasets"].end(); ++i)
 	{
@@ -238,7 +251,7 @@ void SavedBattleGame::loadMapResources(ResourcePack *res)
 {
 	for (std::vector<MapDataSet*>::const_iterator i = _mapDataSets.begin(); i != _mapDataSets.end(); ++i)
 	{
-		(*i)->loadData();
+		(*i)->loadData(res->getVoxelData());
 	}
 
 	int mdsID, mdID;
@@ -259,10 +272,7 @@ void SavedBattleGame::loadMapResources(ResourcePack *res)
 	getTileEngine()->calculateSunShading();
 	getTileEngine()->calculateTerrainLighting();
 	getTileEngine()->calculateUnitLighting();
-	for (std::vector<BattleUnit*>::iterator bu = _units.begin(); bu != _units.end(); ++bu)
-	{
-		_tileEngine->calculateFOV(*bu);
-	}
+	_tileEngine->calculateFOV(_units);
 }
 
 /**
@@ -278,6 +288,13 @@ void SavedBattleGame::save(YAML::Emitter &out) const
 	out << YAML::Key << "height" << YAML::Value << _height;
 	out << YAML::Key << "globalshade" << YAML::Value << _globalShade;
 	out << YAML::Key << "selectedUnit" << YAML::Value << (_selectedUnit?_selectedUnit->getId():-1);
+	out << YAML::Key << "seed" << YAML::Value << _seed;
+	out << YAML::Key << "rng" << YAML::Value;
+	out << YAML::BeginMap;
+	out << YAML::Key << "map" << YAML::Value << RNG::getState(RNG::MAP);
+	out << YAML::Key << "ai" << YAML::Value << RNG::getState(RNG::AI);
+	out << YAML::Key << "combat" << YAML::Value << RNG::getState(RNG::COMBAT);
+	out << YAML::EndMap;
 
 	out << YAML::Key << "mapdatasets" << YAML::Value;
 	out << YAML::BeginSeq;
@@ -334,6 +351,57 @@ Tile **SavedBattleGame::getTiles() const
 	return _tiles;
 }
 
+/**
+ * Gets the storage of all tiles, with the per-field arrays for fast map scans.
+ * @return Pointer to the tile grid.
+ */
+TileGrid *SavedBattleGame::getTileGrid() const
+{
+	return _tileGrid;
+}
+
+/**
+ * Gets the highest level of a column that has a floor blocking the sun.
+ * Every tile below it is in the shade of a roof.
+ * @param x X coordinate of the column.
+ * @param y Y coordinate of the column.
+ * @return Level of the roof, or -1 if the column is open to the sky.
+ */
+int SavedBattleGame::getRoofLevel(int x, int y) const
+{
+	return _roofLevels[y * _width + x];
+}
+
+/**
+ * Recalculates the roof levels of the columns within an area, going down
+ * each column until a floor that blocks the sun. Needed whenever floors
+ * get destroyed.
+ * @param min Top left corner of the area.
+ * @param max Bottom right corner of the area.
+ */
+void SavedBattleGame::updateRoofLevels(const Position &min, const Position &max)
+{
+	for (int x = std::max(min.x, 0); x <= std::min(max.x, _width - 1); ++x)
+	{
+		for (int y = std::max(min.y, 0); y <= std::min(max.y, _length - 1); ++y)
+		{
+			int level = -1;
+			// a floor on the ground level has nothing below it to shade
+			for (int z = _height - 1; z > 0; --z)
+			{
+				Tile *tile = getTile(Position(x, y, z));
+				MapData *floor = tile->getMapData(MapData::O_FLOOR);
+				if (floor && floor->getBlock(DT_NONE) && !tile->isUfoDoorOpen(MapData::O_FLOOR))
+				{
+					level = z;
+					break;
+				}
+			}
+			_roofLevels[y * _width + x] = level;
+		}
+	}
+}
+
 /**
  * Initializes the array of tiles + creates a pathfinding object.
  * @param width
@@ -345,15 +413,14 @@ void SavedBattleGame::initMap(int width, int length, int height)
 	_width = width;
 	_length = length;
 	_height = height;
+	/* create tile objects, all in one block */
+	_tileGrid = new TileGrid(_width, _length, _height);
 	_tiles = new Tile*[_height * _length * _width];
-	/* create tile objects */
 	for (int i = 0; i < _height * _length * _width; ++i)
 	{
-		Position pos;
-		getTileCoords(i, &pos.x, &pos.y, &pos.z);
-		_tiles[i] = new Tile(pos);
+		_tiles[i] = _tileGrid->getTile(i);
 	}
-
+	_roofLevels.assign(_width * _length, -1);
 }
 
 /**
@@ -721,13 +788,17 @@ void SavedBattleGame::endTurn()
 		}
 	}
 
-	for (std::vector<BattleUnit*>::iterator i = _units.begin(); i != _units.end(); ++i)
+	// what the units see does not depend on preparing the new turn, which never moves,
+	// turns or knocks out a unit, so that part is found up front for all of them at once;
+	// the results are still applied in the old order, interleaved with the preparation
+	_tileEngine->findFOV(_units);
+	for (size_t i = 0; i < _units.size(); ++i)
 	{
-		if ((*i)->getFaction() == _side)
+		if (_units[i]->getFaction() == _side)
 		{
-			(*i)->prepareNewTurn();
+			_units[i]->prepareNewTurn();
 		}
-		_tileEngine->calculateFOV(*i);
+		_tileEngine->applyFOV(i);
 	}
 
 	if (_side != FACTION_PLAYER)
@@ -809,6 +880,7 @@ void SavedBattleGame::removeItem(BattleItem *item)
 			if ((*it) == item)
 			{
 				it = _tiles[i]->getInventory()->erase(it);
+				_tileGrid->addDrawChange(i);
 				return;
 			}
 			++it;
@@ -844,6 +916,29 @@ int *SavedBattleGame::getCurrentItemId()
 	return &_itemId;
 }
 
+/**
+ * Gets the seed the battle's random number streams
+ * were started with, or -1 if they haven't been yet.
+ * @return Seed.
+ */
+int SavedBattleGame::getSeed() const
+{
+	return _seed;
+}
+
+/**
+ * Seeds the map, AI and combat random number streams,
+ * so a battle started with the same seed plays out the same.
+ * @param seed Seed.
+ */
+void SavedBattleGame::setSeed(int seed)
+{
+	_seed = seed;
+	RNG::seed(RNG::MAP, seed);
+	RNG::seed(RNG::AI, (int)((Uint32)seed + 1));
+	RNG::seed(RNG::COMBAT, (int)((Uint32)seed + 2));
+}
+
 /**
  * Finds a fitting node where a unit can spawn.
  * @param nodeRank Rank of the node (is not rank of the alien!).
@@ -879,7 +974,7 @@ Node *SavedBattleGame::getSpawnNode(int nodeRank, BattleUnit *unit)
 	
 	if (compliantNodes.empty()) return 0;
 
-	int n = RNG::generate(0, compliantNodes.size() - 1);
+	int n = RNG::generate(0, compliantNodes.size() - 1, RNG::AI);
 
 	return compliantNodes[n];
 }
@@ -914,7 +1009,7 @@ Node *SavedBattleGame::getPatrolNode(bool scout, BattleUnit *unit, Node *fromNod
 
 	if (compliantNodes.empty()) return 0;
 
-	return compliantNodes[RNG::generate(0, compliantNodes.size() - 1)];
+	return compliantNodes[RNG::generate(0, compliantNodes.size() - 1, RNG::AI)];
 }
 
 /**
@@ -927,21 +1022,20 @@ void SavedBattleGame::prepareNewTurn()
 	std::vector<Tile*> tilesOnSmoke;
 
 	// prepare a list of tiles on fire/smoke
-	for (int i = 0; i < getWidth() * getLength() * getHeight(); ++i)
+	const std::vector<int> &fire = _tileGrid->getActive(TileGrid::ACTIVE_FIRE);
+	for (std::vector<int>::const_iterator i = fire.begin(); i != fire.end(); ++i)
 	{
-		if (getTiles()[i]->getFire() > 0)
-		{
-			tilesOnFire.push_back(getTiles()[i]);
-		}
-		if (getTiles()[i]->getSmoke() > 0)
-		{
-			tilesOnSmoke.push_back(getTiles()[i]);
-		}
+		tilesOnFire.push_back(_tiles[*i]);
+	}
+	const std::vector<int> &smoke = _tileGrid->getActive(TileGrid::ACTIVE_SMOKE);
+	for (std::vector<int>::const_iterator i = smoke.begin(); i != smoke.end(); ++i)
+	{
+		tilesOnSmoke.push_back(_tiles[*i]);
 	}
 
 	// smoke spreads in 1 random direction, but the direction is same for all smoke
-	int spreadX = RNG::generate(-1, +1);
-	int spreadY = RNG::generate(-1, +1);
+	int spreadX = RNG::generate(-1, +1, RNG::COMBAT);
+	int spreadY = RNG::generate(-1, +1, RNG::COMBAT);
 	for (std::vector<Tile*>::iterator i = tilesOnSmoke.begin(); i != tilesOnSmoke.end(); ++i)
 	{
 		int x = (*i)->getPosition().x;
@@ -980,11 +1074,11 @@ void SavedBattleGame::prepareNewTurn()
 		if ((*i)->getUnit())
 		{
 			// units on a flaming tile suffer damage
-			(*i)->getUnit()->damage(Position(0,0,0), RNG::generate(1,12), DT_IN, true);
+			(*i)->getUnit()->damage(Position(0,0,0), RNG::generate(1,12,RNG::COMBAT), DT_IN, true);
 			// units on a flaming tile can catch fire 33% chance
-			if (RNG::generate(0,2) == 1)
+			if (RNG::generate(0,2,RNG::COMBAT) == 1)
 			{
-				(*i)->getUnit()->setFire(RNG::generate(1,5));
+				(*i)->getUnit()->setFire(RNG::generate(1,5,RNG::COMBAT));
 			}
 		}
 
@@ -1002,12 +1096,12 @@ void SavedBattleGame::prepareNewTurn()
 						int flam = t->getFlammability();
 						if (flam < 255)
 						{
-							double base = RNG::boxMuller(0,126);
+							double base = RNG::boxMuller(0,126,RNG::COMBAT);
 							if (base < 0) base *= -1;
 
 							if (flam < base)
 							{
-								if (RNG::generate(0, flam) < 2)
+								if (RNG::generate(0, flam, RNG::COMBAT) < 2)
 								{
 									t->ignite();
 								}
@@ -1022,8 +1116,16 @@ void SavedBattleGame::prepareNewTurn()
 
 	if (!tilesOnFire.empty())
 	{
+		for (std::vector<Tile*>::iterator i = tilesOnFire.begin(); i != tilesOnFire.end(); ++i)
+		{
+			// burnt floors no longer keep the sun out
+			Position column((*i)->getPosition().x, (*i)->getPosition().y, 0);
+			getTileEngine()->calculateSunShading(column, column);
+			getPathfinding()->invalidateTerrain((*i)->getPosition(), (*i)->getPosition()); // burnt out objects are destroyed
+		}
 		getTileEngine()->calculateTerrainLighting(); // fires could have been stopped
 	}
+	getTileEngine()->invalidateSight(); // smoke drifted and faded
 
 	reviveUnconsciousUnits();
 
@@ -1049,6 +1151,7 @@ void SavedBattleGame::reviveUnconsciousUnits()
 				// recover from unconscious
 				(*i)->setPosition(originalPosition + Position(xd[dir],yd[dir],0));
 				getTile(originalPosition + Position(xd[dir],yd[dir],0))->setUnit(*i);
+				_pathfinding->invalidateReachability();
 				(*i)->turn(false); // makes the unit stand up again
 				(*i)->setCache(0);
 				getTileEngine()->calculateFOV((*i));
@@ -1108,6 +1211,10 @@ bool SavedBattleGame::setUnitPosition(BattleUnit *bu, const Position &position,
 			getTile(position + Position(x,y,0))->setUnit(bu);
 		}
 	}
+	if (_pathfinding)
+	{
+		_pathfinding->invalidateReachability();
+	}
 
 	return true;
 }
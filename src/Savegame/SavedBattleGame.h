@@ -31,6 +31,7 @@ namespace OpenXcom
 {
 
 class Tile;
+class TileGrid;
 class SavedGame;
 class MapDataSet;
 class RuleUnit;
@@ -57,7 +58,9 @@ class SavedBattleGame
 private:
 	int _width, _length, _height;
 	std::vector<MapDataSet*> _mapDataSets;
+	TileGrid *_tileGrid;
 	Tile **_tiles;
+	std::vector<int> _roofLevels;
 	BattleUnit *_selectedUnit, *_lastSelectedUnit;
 	std::vector<Node*> _nodes;
 	std::vector<BattleUnit*> _units;
@@ -71,6 +74,7 @@ private:
 	bool _debugMode;
 	bool _aborted;
 	int _itemId;
+	int _seed;
 public:
 	/// Creates a new battle save, based on current generic save.
 	SavedBattleGame();
@@ -96,6 +100,8 @@ public:
 	int getGlobalShade() const;
 	/// Gets pointer to the tiles, a tile is the smallest component of battlescape.
 	Tile **getTiles() const;
+	/// Gets the tile storage.
+	TileGrid *getTileGrid() const;
 	/// Get pointer to the list of nodes.
 	std::vector<Node*> *const getNodes();
 	/// Get pointer to the list of items.
@@ -114,6 +120,10 @@ public:
 	void getTileCoords(int index, int *x, int *y, int *z) const;
 	/// Gets the tile at certain position.
 	Tile *getTile(const Position& pos) const;
+	/// Gets the highest level of a column with a floor blocking the sun.
+	int getRoofLevel(int x, int y) const;
+	/// Recalculates the roof levels of the columns within an area.
+	void updateRoofLevels(const Position &min, const Position &max);
 	/// get the currently selected unit
 	BattleUnit *getSelectedUnit() const;
 	/// set the currently selected unit
@@ -152,6 +162,10 @@ public:
 	bool isAborted();
 	/// Gets the current item ID.
 	int *getCurrentItemId();
+	/// Gets the seed the battle was started with.
+	int getSeed() const;
+	/// Seeds the battle's random number streams.
+	void setSeed(int seed);
 	/// Gets a spawn node.
 	Node *getSpawnNode(int nodeRank, BattleUnit *unit);
 	/// Gets a patrol node.
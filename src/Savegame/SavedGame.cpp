@@ -86,7 +86,6 @@ bool equalProduction::operator()(const Production * p) const
  */
 SavedGame::SavedGame(GameDifficulty difficulty) : _difficulty(difficulty), _funds(0), _countries(), _regions(), _bases(), _ufos(), _craftId(), _waypoints(), _ufoId(1), _waypointId(1), _soldierId(1), _battleGame(0)
 {
-	RNG::init();
 	_time = new GameTime(6, 1, 1, 1999, 12, 0, 0);
 	_ufopaedia = new UfopaediaSaved();
 }
@@ -203,6 +202,12 @@ void SavedGame::load(const std::string &filename, Ruleset *rule)
 	doc["difficulty"] >> a;
 	_difficulty = (GameDifficulty)a;
 	doc["funds"] >> _funds;
+	if (const YAML::Node *pName = doc.FindValue("rng"))
+	{
+		std::string state;
+		*pName >> state;
+		RNG::setState(RNG::GEOSCAPE, state);
+	}
 
 	for (YAML::Iterator i = doc["countries"].begin(); i != doc["countries"].end(); ++i)
 	{
@@ -299,6 +304,7 @@ void SavedGame::save(const std::string &filename) const
 	out << YAML::BeginMap;
 	out << YAML::Key << "difficulty" << YAML::Value << _difficulty;
 	out << YAML::Key << "funds" << YAML::Value << _funds;
+	out << YAML::Key << "rng" << YAML::Value << RNG::getState(RNG::GEOSCAPE);
 	out << YAML::Key << "countries" << YAML::Value;
 	out << YAML::BeginSeq;
 	for (std::vector<Country*>::const_iterator i = _countries.begin(); i != _countries.end(); ++i)
@@ -40,16 +40,16 @@ Soldier::Soldier(RuleSoldier *rules, Armor *armor, const std::vector<SoldierName
 		UnitStats minStats = rules->getMinStats();
 		UnitStats maxStats = rules->getMaxStats();
 
-		_initialStats.tu = RNG::generate(minStats.tu, maxStats.tu);
-		_initialStats.stamina = RNG::generate(minStats.stamina, maxStats.stamina);
-		_initialStats.health = RNG::generate(minStats.health, maxStats.health);
-		_initialStats.bravery = RNG::generate(minStats.bravery/10, maxStats.bravery/10)*10;
-		_initialStats.reactions = RNG::generate(minStats.reactions, maxStats.reactions);
-		_initialStats.firing = RNG::generate(minStats.firing, maxStats.firing);
-		_initialStats.throwing = RNG::generate(minStats.throwing, maxStats.throwing);
-		_initialStats.strength = RNG::generate(minStats.strength, maxStats.strength);
-		_initialStats.psiStrength = RNG::generate(minStats.psiStrength, maxStats.psiStrength);
-		_initialStats.melee = RNG::generate(minStats.melee, maxStats.melee);
+		_initialStats.tu = RNG::generate(minStats.tu, maxStats.tu, RNG::GEOSCAPE);
+		_initialStats.stamina = RNG::generate(minStats.stamina, maxStats.stamina, RNG::GEOSCAPE);
+		_initialStats.health = RNG::generate(minStats.health, maxStats.health, RNG::GEOSCAPE);
+		_initialStats.bravery = RNG::generate(minStats.bravery/10, maxStats.bravery/10, RNG::GEOSCAPE)*10;
+		_initialStats.reactions = RNG::generate(minStats.reactions, maxStats.reactions, RNG::GEOSCAPE);
+		_initialStats.firing = RNG::generate(minStats.firing, maxStats.firing, RNG::GEOSCAPE);
+		_initialStats.throwing = RNG::generate(minStats.throwing, maxStats.throwing, RNG::GEOSCAPE);
+		_initialStats.strength = RNG::generate(minStats.strength, maxStats.strength, RNG::GEOSCAPE);
+		_initialStats.psiStrength = RNG::generate(minStats.psiStrength, maxStats.psiStrength, RNG::GEOSCAPE);
+		_initialStats.melee = RNG::generate(minStats.melee, maxStats.melee, RNG::GEOSCAPE);
 		_initialStats.psiSkill = 0;
 
 		_currentStats = _initialStats;	
@@ -57,15 +57,15 @@ Soldier::Soldier(RuleSoldier *rules, Armor *armor, const std::vector<SoldierName
 		if (!names->empty())
 		{
 			int gender;
-			_name = names->at(RNG::generate(0, names->size()-1))->genName(&gender);
+			_name = names->at(RNG::generate(0, names->size()-1, RNG::GEOSCAPE))->genName(&gender);
 			_gender = (SoldierGender)gender;
 		}
 		else
 		{
 			_name = L"";
-			_gender = (SoldierGender)RNG::generate(0, 1);
+			_gender = (SoldierGender)RNG::generate(0, 1, RNG::GEOSCAPE);
 		}
-		_look = (SoldierLook)RNG::generate(0, 3);
+		_look = (SoldierLook)RNG::generate(0, 3, RNG::GEOSCAPE);
 	}
 	if (id != 0)
 	{
@@ -17,6 +17,7 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "Tile.h"
+#include "TileGrid.h"
 #include "../Ruleset/MapData.h"
 #include "../Ruleset/MapDataSet.h"
 #include "../Engine/SurfaceSet.h"
@@ -33,8 +34,10 @@ namespace OpenXcom
 /**
 * constructor
 * @param pos Position.
+* @param grid Grid holding the tile's state.
+* @param index Index of the tile in the grid.
 */
-Tile::Tile(const Position& pos): _smoke(0), _fire(0),  _explosive(0), _pos(pos), _unit(0), _animationOffset(0), _markerColor(0)
+Tile::Tile(const Position& pos, TileGrid *grid, int index): _grid(grid), _index(index), _pos(pos), _unit(0), _animationOffset(0), _markerColor(0)
 {
 	for (int i = 0; i < 4; ++i)
 	{
@@ -43,15 +46,6 @@ Tile::Tile(const Position& pos): _smoke(0), _fire(0),  _explosive(0), _pos(pos),
 		_mapDataSetID[i] = -1;
 		_currentFrame[i] = 0;
 	}
-	for (int layer = 0; layer < LIGHTLAYERS; layer++)
-	{
-		_light[layer] = 0;
-		_lastLight[layer] = -1;
-	}
-	for (int i = 0; i < 3; ++i)
-	{
-		_discovered[i] = false;
-	}
 }
 
 /**
@@ -74,11 +68,22 @@ void Tile::load(const YAML::Node &node)
 		node["mapDataID"][i] >> _mapDataID[i];
 		node["mapDataSetID"][i] >> _mapDataSetID[i];
 	}
-	node["fire"] >> _fire;
-	node["smoke"] >> _smoke;
-	node["discovered"][0] >> _discovered[0];
-	node["discovered"][1] >> _discovered[1];
-	node["discovered"][2] >> _discovered[2];
+	node["fire"] >> _grid->getFire()[_index];
+	node["smoke"] >> _grid->getSmoke()[_index];
+	if (getFire())
+		_grid->setActive(TileGrid::ACTIVE_FIRE, _index);
+	if (getSmoke())
+		_grid->setActive(TileGrid::ACTIVE_SMOKE, _index);
+	_grid->getDiscovered()[_index] = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		bool discovered;
+		node["discovered"][i] >> discovered;
+		if (discovered)
+		{
+			_grid->getDiscovered()[_index] |= 1 << i;
+		}
+	}
 }
 
 /**
@@ -93,10 +98,10 @@ void Tile::save(YAML::Emitter &out) const
 	out << YAML::BeginSeq << _mapDataID[0] << _mapDataID[1] << _mapDataID[2] << _mapDataID[3] << YAML::EndSeq;
 	out << YAML::Key << "mapDataSetID" << YAML::Value << YAML::Flow;
 	out << YAML::BeginSeq << _mapDataSetID[0] << _mapDataSetID[1] << _mapDataSetID[2] << _mapDataSetID[3] << YAML::EndSeq;
-	out << YAML::Key << "smoke" << YAML::Value << _smoke;
-	out << YAML::Key << "fire" << YAML::Value << _fire;
+	out << YAML::Key << "smoke" << YAML::Value << getSmoke();
+	out << YAML::Key << "fire" << YAML::Value << getFire();
 	out << YAML::Key << "discovered" << YAML::Value << YAML::Flow;
-	out << YAML::BeginSeq << _discovered[0] << _discovered[1] << _discovered[2] << YAML::EndSeq;
+	out << YAML::BeginSeq << isDiscovered(0) << isDiscovered(1) << isDiscovered(2) << YAML::EndSeq;
 	out << YAML::EndMap;
 }
 
@@ -122,9 +127,18 @@ MapData *Tile::getMapData(int part) const
  */
 void Tile::setMapData(MapData *dat, int mapDataID, int mapDataSetID, int part)
 {
+	if ((_objects[part] && _objects[part]->getLightSource()) || (dat && dat->getLightSource()))
+	{
+		_grid->addLightChange(_index);
+	}
 	_objects[part] = dat;
 	_mapDataID[part] = mapDataID;
 	_mapDataSetID[part] = mapDataSetID;
+	_grid->addDrawChange(_index);
+	if (dat && dat->isAnimated())
+	{
+		_grid->setActive(TileGrid::ACTIVE_ANIMATED, _index);
+	}
 }
 
 /**
@@ -144,7 +158,7 @@ void Tile::getMapData(int *mapDataID, int *mapDataSetID, int part) const
  */
 bool Tile::isVoid() const
 {
-	return _objects[0] == 0 && _objects[1] == 0 && _objects[2] == 0 && _objects[3] == 0 && _smoke == 0;
+	return _objects[0] == 0 && _objects[1] == 0 && _objects[2] == 0 && _objects[3] == 0 && getSmoke() == 0;
 }
 
 /**
@@ -247,6 +261,8 @@ int Tile::openDoor(int part)
 	if (_objects[part]->isUFODoor() && _currentFrame[part] == 0) // ufo door part 0 - door is closed
 	{
 		_currentFrame[part] = 1; // start opening door
+		_grid->setActive(TileGrid::ACTIVE_ANIMATED, _index);
+		_grid->addDrawChange(_index);
 		return 1;
 	}
 	if (_objects[part]->isUFODoor() && _currentFrame[part] != 7) // ufo door != part 7 - door is still opening
@@ -280,6 +296,7 @@ int Tile::closeUfoDoor()
 		if (isUfoDoorOpen(part))
 		{
 			_currentFrame[part] = 0;
+			_grid->addDrawChange(_index);
 			retval = 1;
 		}
 	}
@@ -294,14 +311,18 @@ int Tile::closeUfoDoor()
  */
 void Tile::setDiscovered(bool flag, int part)
 {
-	if (_discovered[part] != flag)
+	Uint8 &discovered = _grid->getDiscovered()[_index];
+	if (isDiscovered(part) != flag)
 	{
-		_discovered[part] = flag;
+		if (flag)
+			discovered |= 1 << part;
+		else
+			discovered &= ~(1 << part);
 		if (part == 2 && flag == true)
 		{
-			_discovered[0] = true;
-			_discovered[1] = true;
+			discovered |= 3;
 		}
+		_grid->addDrawChange(_index);
 		// if light on tile changes, units and objects on it change light too
 		if (_unit != 0)
 		{
@@ -317,7 +338,7 @@ void Tile::setDiscovered(bool flag, int part)
  */
 bool Tile::isDiscovered(int part) const
 {
-	return _discovered[part];
+	return (_grid->getDiscovered()[_index] & (1 << part)) != 0;
 }
 
 
@@ -327,8 +348,9 @@ bool Tile::isDiscovered(int part) const
  */
 void Tile::resetLight(int layer)
 {
-	_light[layer] = 0;
-	_lastLight[layer] = _light[layer];
+	_grid->getLight(layer)[_index] = 0;
+	// the light gets added back right after, possibly all at once
+	_grid->addDrawChange(_index);
 }
 
 /**
@@ -338,8 +360,12 @@ void Tile::resetLight(int layer)
  */
 void Tile::addLight(int light, int layer)
 {
-	if (_light[layer] < light)
-		_light[layer] = light;
+	Uint8 &current = _grid->getLight(layer)[_index];
+	if (current < light)
+	{
+		current = light;
+		_grid->addDrawChange(_index);
+	}
 }
 
 /**
@@ -353,8 +379,8 @@ int Tile::getShade() const
 
 	for (int layer = 0; layer < LIGHTLAYERS; layer++)
 	{
-		if (_light[layer] > light)
-			light = _light[layer];
+		if (_grid->getLight(layer)[_index] > light)
+			light = _grid->getLight(layer)[_index];
 	}
 
 	return 15 - light;
@@ -407,19 +433,24 @@ void Tile::damage(int part, int power)
  */
 void Tile::setExplosive(int power)
 {
-	if (_explosive)
+	int &explosive = _grid->getExplosive()[_index];
+	if (explosive)
 	{
-		_explosive = (_explosive + power) / 2;
+		explosive = (explosive + power) / 2;
 	}
 	else
 	{
-		_explosive = power;
+		explosive = power;
+	}
+	if (explosive)
+	{
+		_grid->setActive(TileGrid::ACTIVE_EXPLOSIVE, _index);
 	}
 }
 
 int Tile::getExplosive() const
 {
-	return _explosive;
+	return _grid->getExplosive()[_index];
 }
 
 /**
@@ -427,8 +458,8 @@ int Tile::getExplosive() const
  */
 void Tile::detonate()
 {
-	int explosive = _explosive;
-	_explosive = 0;
+	int explosive = getExplosive();
+	_grid->getExplosive()[_index] = 0;
 
 	if (explosive)
 	{
@@ -455,7 +486,7 @@ void Tile::detonate()
 		int flam = getFlammability();
 		if (flam <= 20)
 		{
-			if (RNG::generate(0, 20) - flam >= 0)
+			if (RNG::generate(0, 20, RNG::COMBAT) - flam >= 0)
 			{
 				ignite();
 			}
@@ -531,10 +562,36 @@ void Tile::animate()
 				newframe = 0;
 			}
 			_currentFrame[i] = newframe;
+			_grid->addDrawChange(_index);
 		}
 	}
 }
 
+/**
+ * Check if the tile needs animating: it has an object with changing
+ * sprites, or a ufo door that is opening.
+ * @return True if animate() has anything to do.
+ */
+bool Tile::isAnimated() const
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		if (_objects[i])
+		{
+			if (_objects[i]->isUFODoor())
+			{
+				if (_currentFrame[i] != 0 && _currentFrame[i] != 7)
+					return true;
+			}
+			else if (_objects[i]->isAnimated())
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
 /**
  * Get the sprite of a certain part of the tile.
  * @param part
@@ -548,6 +605,19 @@ Surface *Tile::getSprite(int part) const
 	return _objects[part]->getDataset()->getSurfaceset()->getFrame(_objects[part]->getSprite(_currentFrame[part]));
 }
 
+/**
+ * Get the frame number of the sprite of a certain part of the tile, in the surface set of its dataset.
+ * @param part
+ * @return Frame number, or -1 if there is no such part.
+ */
+int Tile::getSpriteFrame(int part) const
+{
+	if (_objects[part] == 0)
+		return -1;
+
+	return _objects[part]->getSprite(_currentFrame[part]);
+}
+
 /**
  * Set a unit on this tile.
  * @param unit
@@ -558,6 +628,11 @@ void Tile::setUnit(BattleUnit *unit)
 	{
 		unit->setTile(this);
 	}
+	if (unit != _unit)
+	{
+		_grid->addUnitChange(_index);
+		_grid->addLightChange(_index);
+	}
 	_unit = unit;
 }
 
@@ -576,8 +651,16 @@ BattleUnit *Tile::getUnit() const
  */
 void Tile::setFire(int fire)
 {
-	_fire = fire;
-	_animationOffset = RNG::generate(0,3);
+	if ((getFire() > 0) != (fire > 0))
+	{
+		_grid->addLightChange(_index);
+	}
+	_grid->getFire()[_index] = fire;
+	if (fire > 0)
+	{
+		_grid->setActive(TileGrid::ACTIVE_FIRE, _index);
+	}
+	_animationOffset = RNG::generate(0,3,RNG::EFFECTS);
 }
 
 /**
@@ -586,7 +669,7 @@ void Tile::setFire(int fire)
  */
 int Tile::getFire() const
 {
-	return _fire;
+	return _grid->getFire()[_index];
 }
 
 /**
@@ -595,9 +678,14 @@ int Tile::getFire() const
  */
 void Tile::addSmoke(int smoke)
 {
-	_smoke += smoke;
-	if (_smoke > 40) _smoke = 40;
-	_animationOffset = RNG::generate(0,3);
+	int &current = _grid->getSmoke()[_index];
+	current += smoke;
+	if (current > 40) current = 40;
+	if (current > 0)
+	{
+		_grid->setActive(TileGrid::ACTIVE_SMOKE, _index);
+	}
+	_animationOffset = RNG::generate(0,3,RNG::EFFECTS);
 }
 
 /**
@@ -606,7 +694,7 @@ void Tile::addSmoke(int smoke)
  */
 int Tile::getSmoke() const
 {
-	return _smoke;
+	return _grid->getSmoke()[_index];
 }
 
 /**
@@ -627,6 +715,11 @@ void Tile::addItem(BattleItem *item)
 {
 	_inventory.push_back(item);
 	item->setTile(this);
+	_grid->addDrawChange(_index);
+	if (item->getRules()->getBattleType() == BT_FLARE)
+	{
+		_grid->addLightChange(_index);
+	}
 }
 
 /**
@@ -644,6 +737,11 @@ void Tile::removeItem(BattleItem *item)
 		}
 	}
 	item->setTile(0);
+	_grid->addDrawChange(_index);
+	if (item->getRules()->getBattleType() == BT_FLARE)
+	{
+		_grid->addLightChange(_index);
+	}
 }
 
 /**
@@ -670,10 +768,12 @@ int Tile::getTopItemSprite()
  */
 void Tile::prepareNewTurn()
 {
-	_smoke--;
-	if (_smoke < 0) _smoke = 0;
+	int &smoke = _grid->getSmoke()[_index];
+	int &fire = _grid->getFire()[_index];
+	smoke--;
+	if (smoke < 0) smoke = 0;
 
-	if (_fire == 1)
+	if (fire == 1)
 	{
 		// fire will be finished in this turn
 		// destroy all objects that burned, and try to ignite again
@@ -693,13 +793,17 @@ void Tile::prepareNewTurn()
 		}
 		else
 		{
-			_fire = 0;
+			fire = 0;
+			_grid->addLightChange(_index);
 		}
 	}
-	else
+	else if (fire > 0)
 	{
-		_fire--;
-		if (_fire < 0) _fire = 0;
+		fire--;
+		if (fire == 0)
+		{
+			_grid->addLightChange(_index);
+		}
 	}
 }
 
@@ -718,7 +822,11 @@ std::vector<BattleItem *> *Tile::getInventory()
  */
 void Tile::setMarkerColor(int color)
 {
-	_markerColor = color;
+	if (_markerColor != color)
+	{
+		_markerColor = color;
+		_grid->addDrawChange(_index);
+	}
 }
 
 /**
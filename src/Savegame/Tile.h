@@ -33,9 +33,11 @@ class Surface;
 class MapData;
 class BattleUnit;
 class BattleItem;
+class TileGrid;
 
 /**
  * Basic element of which a battle map is build.
+ * Light, smoke, fire, explosives and fog of war are stored in the TileGrid.
  * @sa http://www.ufopaedia.org/index.php?title=MAPS
  */
 class Tile
@@ -46,11 +48,8 @@ protected:
 	int _mapDataID[4];
 	int _mapDataSetID[4];
 	int _currentFrame[4];
-	bool _discovered[3];
-	int _light[LIGHTLAYERS], _lastLight[LIGHTLAYERS];
-	int _smoke;
-	int _fire;
-	int _explosive;
+	TileGrid *_grid;
+	int _index;
 	Position _pos;
 	BattleUnit *_unit;
 	std::vector<BattleItem *> _inventory;
@@ -58,7 +57,7 @@ protected:
 	int _markerColor;
 public:
 	/// Creates a tile.
-	Tile(const Position& pos);
+	Tile(const Position& pos, TileGrid *grid, int index);
 	/// Cleans up a tile.
 	~Tile();
 	/// Load the tile to yaml
@@ -113,8 +112,12 @@ public:
 	void detonate();
 	/// Animated the tile parts.
 	void animate();
+	/// Does any tile part need animating?
+	bool isAnimated() const;
 	/// Get object sprites.
 	Surface *getSprite(int part) const;
+	/// Get the frame number of an object sprite.
+	int getSpriteFrame(int part) const;
 	/// Set a unit on this tile.
 	void setUnit(BattleUnit *unit);
 	/// Get the (alive) unit on this tile.
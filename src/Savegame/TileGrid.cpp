@@ -0,0 +1,278 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "TileGrid.h"
+#include <algorithm>
+
+namespace OpenXcom
+{
+
+/**
+ * Creates all tiles of a map, with every field zeroed.
+ * @param width Map width.
+ * @param length Map length.
+ * @param height Map height.
+ */
+TileGrid::TileGrid(int width, int length, int height) : _size(width * length * height)
+{
+	for (int layer = 0; layer < LIGHTLAYERS; ++layer)
+	{
+		_light[layer].assign(_size, 0);
+	}
+	_discovered.assign(_size, 0);
+	_smoke.assign(_size, 0);
+	_fire.assign(_size, 0);
+	_explosive.assign(_size, 0);
+	_activeFlags.assign(_size, 0);
+	_drawFlags.assign(_size, 0);
+
+	// the tiles must never move once created
+	_tiles.reserve(_size);
+	for (int i = 0; i < _size; ++i)
+	{
+		Position pos(i % width, (i / width) % length, i / (width * length));
+		_tiles.push_back(Tile(pos, this, i));
+	}
+}
+
+/**
+ * Deletes the tiles.
+ */
+TileGrid::~TileGrid()
+{
+
+}
+
+/**
+ * Gets the number of tiles on the map.
+ * @return Number of tiles.
+ */
+int TileGrid::getSize() const
+{
+	return _size;
+}
+
+/**
+ * Gets the memory each tile takes up: the tile itself and its entries in the state arrays.
+ * @return Size in bytes.
+ */
+size_t TileGrid::getTileBytes() const
+{
+	return sizeof(Tile) + LIGHTLAYERS * sizeof(Uint8) + sizeof(_discovered[0])
+		+ sizeof(_smoke[0]) + sizeof(_fire[0]) + sizeof(_explosive[0])
+		+ sizeof(_activeFlags[0]) + sizeof(_drawFlags[0]);
+}
+
+/**
+ * Gets a tile.
+ * @param index Tile index.
+ * @return Pointer to the tile.
+ */
+Tile *TileGrid::getTile(int index)
+{
+	return &_tiles[index];
+}
+
+/**
+ * Gets the light levels of all tiles for a light layer.
+ * @param layer Light is separated in 3 layers: Ambient, Static and Dynamic.
+ * @return Pointer to the first tile's light level.
+ */
+Uint8 *TileGrid::getLight(int layer)
+{
+	return &_light[layer][0];
+}
+
+/**
+ * Gets the fog of war flags of all tiles, one bit per part.
+ * @return Pointer to the first tile's flags.
+ */
+Uint8 *TileGrid::getDiscovered()
+{
+	return &_discovered[0];
+}
+
+/**
+ * Gets the turns left of smoke of all tiles.
+ * @return Pointer to the first tile's smoke.
+ */
+int *TileGrid::getSmoke()
+{
+	return &_smoke[0];
+}
+
+/**
+ * Gets the turns left of fire of all tiles.
+ * @return Pointer to the first tile's fire.
+ */
+int *TileGrid::getFire()
+{
+	return &_fire[0];
+}
+
+/**
+ * Gets the pending explosive power of all tiles.
+ * @return Pointer to the first tile's explosive power.
+ */
+int *TileGrid::getExplosive()
+{
+	return &_explosive[0];
+}
+
+/**
+ * Marks a tile as having had a unit step onto or off it,
+ * for anything remembering lines passing through it.
+ * @param index Tile index.
+ */
+void TileGrid::addUnitChange(int index)
+{
+	_unitChanges.push_back(index);
+}
+
+/**
+ * Gets the tiles that had a unit step onto or off them. Whoever
+ * handles the changes clears the list.
+ * @return Pointer to the list of tile indexes.
+ */
+std::vector<int> *TileGrid::getUnitChanges()
+{
+	return &_unitChanges;
+}
+
+/**
+ * Marks a tile as possibly having gained or lost a light source: a lit
+ * object, a fire, a flare or a unit came or went.
+ * @param index Tile index.
+ */
+void TileGrid::addLightChange(int index)
+{
+	_lightChanges.push_back(index);
+}
+
+/**
+ * Gets the tiles that possibly gained or lost a light source. Whoever
+ * handles the changes clears the list.
+ * @return Pointer to the list of tile indexes.
+ */
+std::vector<int> *TileGrid::getLightChanges()
+{
+	return &_lightChanges;
+}
+
+/**
+ * Marks a tile as looking different than when the map was last drawn:
+ * other sprites, light or fog of war. Marking a tile twice does nothing.
+ * @param index Tile index.
+ */
+void TileGrid::addDrawChange(int index)
+{
+	if (!_drawFlags[index])
+	{
+		_drawFlags[index] = 1;
+		_drawChanges.push_back(index);
+	}
+}
+
+/**
+ * Gets the tiles that look different since the changes were last cleared.
+ * @return List of tile indexes.
+ */
+const std::vector<int> &TileGrid::getDrawChanges() const
+{
+	return _drawChanges;
+}
+
+/**
+ * Forgets the tiles that look different, once the map has caught up with them.
+ */
+void TileGrid::clearDrawChanges()
+{
+	for (std::vector<int>::iterator i = _drawChanges.begin(); i != _drawChanges.end(); ++i)
+	{
+		_drawFlags[*i] = 0;
+	}
+	_drawChanges.clear();
+}
+
+
+/**
+ * Adds a tile to a set of active tiles: tiles on fire, in smoke, about to
+ * explode or with animated parts. Those are the only ones the turn and
+ * animation updates visit. Adding a tile twice does nothing.
+ * @param set The set.
+ * @param index Tile index.
+ */
+void TileGrid::setActive(ActiveSet set, int index)
+{
+	if (!(_activeFlags[index] & (1 << set)))
+	{
+		_activeFlags[index] |= 1 << set;
+		_active[set].push_back(index);
+	}
+}
+
+/**
+ * Checks if a tile still belongs to a set of active tiles.
+ * @param set The set.
+ * @param index Tile index.
+ * @return True if the tile is still active.
+ */
+bool TileGrid::isActive(ActiveSet set, int index)
+{
+	switch (set)
+	{
+	case ACTIVE_FIRE:
+		return _fire[index] > 0;
+	case ACTIVE_SMOKE:
+		return _smoke[index] > 0;
+	case ACTIVE_EXPLOSIVE:
+		return _explosive[index] != 0;
+	case ACTIVE_ANIMATED:
+		return _tiles[index].isAnimated();
+	default:
+		return false;
+	}
+}
+
+/**
+ * Gets the tiles of a set that are still active. Tiles that went out
+ * (fire burnt out, smoke faded, ...) are dropped from the set first.
+ * @param set The set.
+ * @return List of tile indexes, in map order.
+ */
+const std::vector<int> &TileGrid::getActive(ActiveSet set)
+{
+	std::vector<int> &active = _active[set];
+	std::vector<int>::iterator last = active.begin();
+	for (std::vector<int>::iterator i = active.begin(); i != active.end(); ++i)
+	{
+		if (isActive(set, *i))
+		{
+			*last++ = *i;
+		}
+		else
+		{
+			_activeFlags[*i] &= ~(1 << set);
+		}
+	}
+	active.erase(last, active.end());
+	std::sort(active.begin(), active.end());
+	return active;
+}
+
+}
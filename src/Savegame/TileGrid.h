@@ -0,0 +1,95 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_TILEGRID_H
+#define OPENXCOM_TILEGRID_H
+
+#include <vector>
+#include <SDL.h>
+#include "Tile.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Storage for all tiles of a battle map. The tiles are allocated in one block,
+ * and the state that gets scanned across the whole map (light, smoke, fire,
+ * explosives, fog of war) is kept in one array per field, in tile index order,
+ * instead of inside each tile. Tile objects read and write their entries.
+ */
+class TileGrid
+{
+public:
+	/// Kinds of tiles that need to be visited regularly.
+	enum ActiveSet { ACTIVE_FIRE, ACTIVE_SMOKE, ACTIVE_EXPLOSIVE, ACTIVE_ANIMATED, ACTIVE_SETS };
+private:
+	static const int LIGHTLAYERS = 3;
+	int _size;
+	std::vector<Tile> _tiles;
+	std::vector<Uint8> _light[LIGHTLAYERS], _discovered;
+	std::vector<int> _smoke, _fire, _explosive;
+	std::vector<int> _unitChanges, _lightChanges;
+	std::vector<Uint8> _drawFlags;
+	std::vector<int> _drawChanges;
+	std::vector<Uint8> _activeFlags;
+	std::vector<int> _active[ACTIVE_SETS];
+	bool isActive(ActiveSet set, int index);
+public:
+	/// Creates the tiles of a map.
+	TileGrid(int width, int length, int height);
+	/// Cleans up the tiles.
+	~TileGrid();
+	/// Gets the number of tiles.
+	int getSize() const;
+	/// Gets the memory each tile takes up.
+	size_t getTileBytes() const;
+	/// Gets a tile.
+	Tile *getTile(int index);
+	/// Gets the light levels of a layer.
+	Uint8 *getLight(int layer);
+	/// Gets the fog of war flags.
+	Uint8 *getDiscovered();
+	/// Gets the smoke turns.
+	int *getSmoke();
+	/// Gets the fire turns.
+	int *getFire();
+	/// Gets the explosive power.
+	int *getExplosive();
+	/// Marks a tile as having had its unit changed.
+	void addUnitChange(int index);
+	/// Gets the tiles that had their unit changed.
+	std::vector<int> *getUnitChanges();
+	/// Marks a tile as possibly having gained or lost a light source.
+	void addLightChange(int index);
+	/// Gets the tiles that possibly gained or lost a light source.
+	std::vector<int> *getLightChanges();
+	/// Marks a tile as looking different.
+	void addDrawChange(int index);
+	/// Gets the tiles that look different.
+	const std::vector<int> &getDrawChanges() const;
+	/// Forgets the tiles that look different.
+	void clearDrawChanges();
+	/// Adds a tile to a set of active tiles.
+	void setActive(ActiveSet set, int index);
+	/// Gets the tiles of a set that are still active.
+	const std::vector<int> &getActive(ActiveSet set);
+};
+
+}
+
+#endif
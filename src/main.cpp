@@ -21,6 +21,7 @@
 #include "Engine/Game.h"
 #include "Engine/Screen.h"
 #include "Engine/Options.h"
+#include "Engine/RNG.h"
 #include "Menu/StartState.h"
 
 /** @mainpage
@@ -49,6 +50,7 @@ int main(int argc, char** args)
 	{
 #endif
 		Options::init(argc, args);
+		RNG::init();
 		game = new Game("OpenXcom " + Options::getVersion(), 320, 200, 8);
 		game->getScreen()->setFullscreen(Options::getBool("fullscreen"));
 		game->getScreen()->setResolution(Options::getInt("displayWidth"), Options::getInt("displayHeight"));
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <exception>
+#include <iostream>
+#include <cstdlib>
+#include <SDL.h>
+#include "Engine/Game.h"
+#include "Engine/Options.h"
+#include "Engine/RNG.h"
+#include "Engine/Benchmark.h"
+#include "Resource/XcomResourcePack.h"
+#include "Ruleset/XcomRuleset.h"
+#include "Savegame/SavedGame.h"
+
+using namespace OpenXcom;
+
+Game *game = 0;
+
+// The openxcom_bench build times the slowest parts of the game on their
+// own, see Benchmark. Takes -samples and -seed besides the usual
+// options; runs with the same seed work on the same data.
+int main(int argc, char** args)
+{
+	int samples = 10, seed = 1;
+	for (int i = 1; i < argc - 1; ++i)
+	{
+		std::string arg = args[i];
+		if (arg == "-samples")
+			samples = atoi(args[i+1]);
+		else if (arg == "-seed")
+			seed = atoi(args[i+1]);
+	}
+	try
+	{
+		Options::init(argc, args);
+		Options::setBool("mute", true);
+		Options::setBool("battleRecord", false);
+		RNG::init(seed);
+		// SDL still needs a display, but it's never shown
+		static char videoDriver[] = "SDL_VIDEODRIVER=dummy";
+		SDL_putenv(videoDriver);
+		game = new Game("OpenXcom " + Options::getVersion(), 320, 200, 8);
+		game->setResourcePack(new XcomResourcePack());
+		game->setRuleset(new XcomRuleset());
+		game->setSavedGame(game->getRuleset()->newSave(DIFF_BEGINNER));
+		Benchmark benchmark(game, samples);
+		benchmark.run(std::cout);
+	}
+	catch (std::exception &e)
+	{
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	delete game;
+	return EXIT_SUCCESS;
+}
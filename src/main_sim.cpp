@@ -0,0 +1,109 @@
+/*
+ * Copyright 2010-2012 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <exception>
+#include <iostream>
+#include <cstdlib>
+#include <SDL.h>
+#include "Engine/Game.h"
+#include "Engine/Screen.h"
+#include "Engine/Options.h"
+#include "Engine/RNG.h"
+#include "Battlescape/BattleSimulator.h"
+#include "Resource/XcomResourcePack.h"
+#include "Ruleset/XcomRuleset.h"
+#include "Savegame/SavedGame.h"
+
+using namespace OpenXcom;
+
+Game *game = 0;
+
+// The openxcom_sim build plays out a battle without a screen,
+// see BattleSimulator. Takes -mission, -texture, -turns and -seed besides
+// the usual options; the same seed plays out the same battle. Battles
+// recorded by the game are replayed with -replay <log>, failing when the
+// replay doesn't end the way the recorded battle did, or shown on screen
+// with -watch <log>.
+int main(int argc, char** args)
+{
+	std::string mission = "STR_TERROR_MISSION", replay = "";
+	int texture = 1, turns = 100, seed = -1;
+	bool watch = false;
+	for (int i = 1; i < argc - 1; ++i)
+	{
+		std::string arg = args[i];
+		if (arg == "-mission")
+			mission = args[i+1];
+		else if (arg == "-texture")
+			texture = atoi(args[i+1]);
+		else if (arg == "-turns")
+			turns = atoi(args[i+1]);
+		else if (arg == "-seed")
+			seed = atoi(args[i+1]);
+		else if (arg == "-replay")
+			replay = args[i+1];
+		else if (arg == "-watch")
+		{
+			replay = args[i+1];
+			watch = true;
+		}
+	}
+	try
+	{
+		Options::init(argc, args);
+		Options::setBool("battleRecord", false);
+		RNG::init(seed);
+		if (!watch)
+		{
+			Options::setBool("mute", true);
+			// SDL still needs a display, but it's never shown
+			static char videoDriver[] = "SDL_VIDEODRIVER=dummy";
+			SDL_putenv(videoDriver);
+		}
+		game = new Game("OpenXcom " + Options::getVersion(), 320, 200, 8);
+		if (watch)
+		{
+			game->getScreen()->setFullscreen(Options::getBool("fullscreen"));
+			game->getScreen()->setResolution(Options::getInt("displayWidth"), Options::getInt("displayHeight"));
+			game->setVolume(Options::getInt("soundVolume"), Options::getInt("musicVolume"));
+		}
+		game->setResourcePack(new XcomResourcePack());
+		game->setRuleset(new XcomRuleset());
+		BattleSimulator simulator(game, mission, texture, turns);
+		if (replay.empty())
+		{
+			game->setSavedGame(game->getRuleset()->newSave(DIFF_BEGINNER));
+			simulator.run(std::cout);
+		}
+		else
+		{
+			if (!simulator.replay(replay, watch, std::cout))
+			{
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+	catch (std::exception &e)
+	{
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	delete game;
+	return EXIT_SUCCESS;
+}